@@ -1,6 +1,8 @@
 @echo off
 setlocal
 
+rem Optional, the engine compiles the sources at runtime and caches the SPIR-V. The binaries this writes are only
+rem used when a source is missing, and are not committed so they cannot go stale against the sources.
 set GLSLC=C:/VulkanSDK/1.4.313.2/Bin/glslc.exe
 
 echo compiling .vert...
@@ -0,0 +1,51 @@
+#version 450
+
+// Model::CompactVertex, the dequantization of the position is folded in push.modelMatrix.
+layout(location = 0) in vec4 positionColor;
+layout(location = 1) in vec2 octNormal;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight {
+	vec4 position; 
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projection;
+	mat4 view;
+	mat4 invView;
+	vec4 ambientLightColor; 
+	PointLight pointLights[10];
+	int numLights;
+} ubo;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+} push;
+
+const float AMBIENT = 0.02;
+
+vec3 DecodeColor(float packedColor) {
+	uint bits = uint(round(packedColor * 65535.0));
+	return vec3(float((bits >> 11) & 31u) / 31.0, float((bits >> 5) & 63u) / 63.0, float(bits & 31u) / 31.0);
+}
+
+vec3 DecodeOctahedral(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	vec4 positionWorld = push.modelMatrix * vec4(positionColor.xyz, 1.0);
+	gl_Position = ubo.projection * ubo.view * positionWorld;
+	fragNormalWorld = normalize(mat3(push.normalMatrix) * DecodeOctahedral(octNormal));
+	fragPosWorld = positionWorld.xyz;
+	fragColor = DecodeColor(positionColor.w);
+}	
\ No newline at end of file
@@ -12,6 +12,12 @@ struct PointLight {
     vec4 color; 
 };
 
+// Set per pipeline by the render system. MAX_LIGHTS bounds the loop so it unrolls, at most the size of pointLights.
+layout (constant_id = 0) const int MAX_LIGHTS = 10;
+// 0 for none, 1 for Blinn-Phong.
+layout (constant_id = 1) const int SPECULAR_MODEL = 1;
+layout (constant_id = 2) const float SPECULAR_EXPONENT = 512.0;
+
 layout(set = 0, binding = 0) uniform GlobalUbo {
 	mat4 projection;
 	mat4 view;
@@ -37,7 +43,10 @@ void main() {
 	vec3 cameraPosWorld = ubo.invView[3].xyz;
 	vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
 
-	for (int i = 0; i < ubo.numLights; i++) {
+	for (int i = 0; i < MAX_LIGHTS; i++) {
+		if (i >= ubo.numLights) {
+			break;
+		}
 		PointLight light = ubo.pointLights[i];
 		vec3 directionToLight = light.position.xyz - fragPosWorld;
 		float attenuation = 1.0 / dot(directionToLight, directionToLight);
@@ -47,11 +56,13 @@ void main() {
 
 		diffuseLight += intensity * cosAngIncidence;
 
-		vec3 halfAngle = normalize(directionToLight + viewDirection);
-		float blinnTerm = dot(surfaceNormal, halfAngle);
-		blinnTerm = clamp(blinnTerm, 0, 1);
-		blinnTerm = pow(blinnTerm, 512.0);
-		specularLight += intensity * blinnTerm;
+		if (SPECULAR_MODEL == 1) {
+			vec3 halfAngle = normalize(directionToLight + viewDirection);
+			float blinnTerm = dot(surfaceNormal, halfAngle);
+			blinnTerm = clamp(blinnTerm, 0, 1);
+			blinnTerm = pow(blinnTerm, SPECULAR_EXPONENT);
+			specularLight += intensity * blinnTerm;
+		}
 	}
 
 	vec3 texColor = texture(texSampler, fragUV).rgb;
@@ -26,6 +26,9 @@
 #include "components/PointLightComponent.h"
 #include "core/Texture.h"
 #include "core/Descriptors.h"
+#include "core/PipelineCache.h"
+#include "core/PipelineBuildQueue.h"
+#include "core/ShaderCompiler.h"
 #include <imgui.h>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_vulkan.h>
@@ -40,6 +43,10 @@ Application::Application()
         .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT * 2)
         .SetPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
 		.Build();
+
+	// 16 byte vertices instead of 44 whenever the compact shaders have been compiled.
+	Model::SetDefaultVertexFormat(RenderSystem::HasCompactShaders() ? Model::VertexFormat::Compact : Model::VertexFormat::Full);
+	m_assetLoader = std::make_unique<AssetLoader>(m_device);
 		
 	LoadGameObjects();
 	
@@ -48,6 +55,7 @@ Application::Application()
 	m_imguiInterface->Initialize();
 	m_imguiInterface->SetViewerEntity(m_viewerEntity);
 	m_imguiInterface->SetParticleEntity(m_particleEntity);
+	m_imguiInterface->SetAssetLoader(m_assetLoader.get());
 }
 
 Application::~Application()
@@ -81,16 +89,16 @@ void Application::Run()
             .Build(globalDescriptorSets[i]);
     }
 
-    static std::unique_ptr<DescriptorSetLayout> textureSetLayout = DescriptorSetLayout::Builder(m_device)
+    // Same bindings as the sets the asset loader allocates, only used to build the pipeline layouts.
+    auto textureSetLayout = DescriptorSetLayout::Builder(m_device)
         .AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
         .Build();
-    static std::unique_ptr<DescriptorPool> texturePool = DescriptorPool::Builder(m_device)
-        .SetMaxSets(100)
-        .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
-        .Build();
 
-    RenderSystem renderSystem{m_device, m_renderer.GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout(), textureSetLayout->GetDescriptorSetLayout(), m_renderer.GetMsaaSamples() };
-    PointLightSystem pointLightSystem{m_device, m_renderer.GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout(), m_renderer.GetMsaaSamples() };
+    // The systems only describe their pipelines, they are all built together once every system exists.
+    PipelineBuildQueue pipelineBuildQueue{ m_device };
+    RenderSystem renderSystem{m_device, pipelineBuildQueue, m_renderer.GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout(), textureSetLayout->GetDescriptorSetLayout(), m_renderer.GetMsaaSamples() };
+    m_imguiInterface->SetRenderStats(&renderSystem.GetStats());
+    PointLightSystem pointLightSystem{m_device, pipelineBuildQueue, m_renderer.GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout(), m_renderer.GetMsaaSamples() };
     
     auto particleSetLayout = DescriptorSetLayout::Builder(m_device)
         .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
@@ -109,6 +117,7 @@ void Application::Run()
     
     ParticleRenderSystem particleSystem(
         m_device,
+        pipelineBuildQueue,
         m_renderer.GetSwapChainRenderPass(),
         particleSetLayout->GetDescriptorSetLayout(),
         m_renderer.GetMsaaSamples(),
@@ -121,13 +130,19 @@ void Application::Run()
     for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) 
     {
         VkDescriptorBufferInfo uboInfo = uboBuffers[i]->DescriptorInfo();
-        VkDescriptorBufferInfo particleBufferInfo = particleSystem.GetParticleBuffer()->DescriptorInfo();
+        VkDescriptorBufferInfo particleBufferInfo = particleSystem.GetParticleBufferInfo(i);
         DescriptorWriter(*particleSetLayout, *m_globalPool)
             .WriteBuffer(0, &uboInfo)
             .WriteBuffer(1, &particleBufferInfo)
             .Build(particleDescriptorSets[i]);
     }
 
+    pipelineBuildQueue.Build();
+    ShaderCompiler::Stats shaders = ShaderCompiler::GetShared().GetStats();
+    std::cout << "Shaders: " << shaders.compiledCount << " compiled in " << shaders.compileTime << " ms, " << shaders.cachedCount << " from cache" << std::endl;
+    // Every startup pipeline exists now, written right away so a crash later still keeps them.
+    m_device.GetPipelineCache().Save();
+
     Camera camera{};
     glm::vec3 cameraPosition = glm::vec3(-1.f, -2.f, -2.f);
     glm::vec3 targetPosition = glm::vec3(0.f, 0.f, 2.5f);
@@ -139,6 +154,9 @@ void Application::Run()
     while (!m_window.ShouldClose())
     {
         glfwPollEvents();
+
+        // Finished loads swap their placeholder before the UI and the frame look at the components.
+        m_assetLoader->Update();
         
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -148,6 +166,9 @@ void Application::Run()
         
         ImGui::Render();
 
+        // Meshes removed from the UI leave holes in the geometry pool, compact them once they waste too much.
+        m_device.GetGeometryPool().Defragment();
+
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
         currentTime = newTime;
@@ -169,7 +190,7 @@ void Application::Run()
         if (auto commandBuffer = m_renderer.BeginFrame()) 
         {
             int frameIndex = m_renderer.GetFrameIndex();
-            FrameInfo frameInfo{ frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], &m_ec };
+            FrameInfo frameInfo{ frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], &m_ec, m_renderer.GetSwapChainExtent() };
 
             GlobalUbo ubo{};
             ubo.projection = camera.GetProjection();
@@ -177,6 +198,7 @@ void Application::Run()
             ubo.inverseView = camera.GetInverseView();
 
             pointLightSystem.Update(frameInfo, ubo);
+            frameInfo.lightCount = ubo.numLights;
 
             uboBuffers[frameIndex]->WriteToBuffer(&ubo, sizeof(GlobalUbo));
             uboBuffers[frameIndex]->Flush(VK_WHOLE_SIZE);
@@ -186,19 +208,27 @@ void Application::Run()
             {
                 auto& particleTransform = m_ec.GetComponent<TransformComponent>(m_particleEntity);
                 auto& particleComponent = m_ec.GetComponent<ParticleSystemComponent>(m_particleEntity);
-                particleSystem.UpdateParticlesWithCompute(frameTime, commandBuffer, particleComponent, particleTransform);
+                particleSystem.UpdateParticlesWithCompute(frameInfo, m_renderer, particleComponent, particleTransform);
             }
 
-            m_renderer.BeginSwapChainRenderPass(commandBuffer);
-            renderSystem.RenderGameObjects(frameInfo);
-            pointLightSystem.Render(frameInfo);
+            renderSystem.CullMeshlets(frameInfo);
+
+            m_renderer.BeginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            renderSystem.RenderGameObjects(frameInfo, m_renderer);
+
+            // The rest of the pass is a handful of draws, recorded here into one more secondary command buffer.
+            FrameInfo overlayFrameInfo = frameInfo;
+            overlayFrameInfo.commandBuffer = m_renderer.BeginSecondaryCommandBuffer(0);
+            pointLightSystem.Render(overlayFrameInfo);
             
             if (m_ec.HasComponent<ParticleSystemComponent>(m_particleEntity))
             {
-                particleSystem.Render(frameInfo, particleDescriptorSets[frameIndex]);
+                particleSystem.Render(overlayFrameInfo, particleDescriptorSets[frameIndex]);
             }
             
-            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), overlayFrameInfo.commandBuffer);
+            m_renderer.EndSecondaryCommandBuffer(overlayFrameInfo.commandBuffer);
+            vkCmdExecuteCommands(commandBuffer, 1, &overlayFrameInfo.commandBuffer);
             
             m_renderer.EndSwapChainRenderPass(commandBuffer);
             m_renderer.EndFrame();
@@ -251,15 +281,7 @@ void Application::LoadGameObjects()
 
     m_ec.AddComponent(m_particleEntity, particleParams);
     
-    static std::unique_ptr<DescriptorSetLayout> textureSetLayout = DescriptorSetLayout::Builder(m_device)
-        .AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-        .Build();
-    static std::unique_ptr<DescriptorPool> texturePool = DescriptorPool::Builder(m_device)
-        .SetMaxSets(100)
-        .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
-        .Build();
-
-    auto model = Model::CreateModelWithTexture(m_device, "models/viking_room.obj", "textures/viking_room.png", *textureSetLayout, *texturePool);
+    auto model = m_assetLoader->LoadModel("models/viking_room.obj", "textures/viking_room.png");
 
     Entity viking = m_ec.CreateEntity();
     m_ec.AddComponent(viking, TransformComponent
@@ -4,6 +4,7 @@
 #include "core/Renderer.h"
 #include "model/Model.h"
 #include "model/GameObject.h"
+#include "model/AssetLoader.h"
 #include <vector>
 #include <stdexcept>
 #include <memory>
@@ -38,6 +39,8 @@ private:
 	Renderer m_renderer { m_window, m_device };
 
 	std::unique_ptr<DescriptorPool> m_globalPool{};
+	// Declared before the entities so the placeholders and texture sets they reference outlive them.
+	std::unique_ptr<AssetLoader> m_assetLoader;
 	EntityComponentSystem m_ec;
 	Entity m_viewerEntity;
 	Entity m_particleEntity;
@@ -3,14 +3,21 @@ extern "C" {
 }
 
 #include "app/Application.h"
+#include "model/ObjParserCheck.h"
 
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 
-int main()
+int main(int _argc, char** _argv)
 {
+	// Parser check only, no window or device.
+	if (_argc > 1 && std::string(_argv[1]) == "--verify-obj")
+		return ObjParserCheck::Run(std::vector<std::string>(_argv + 2, _argv + _argc)) ? EXIT_SUCCESS : EXIT_FAILURE;
+
 	Application app;
 
 	try
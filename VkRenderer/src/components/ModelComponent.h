@@ -4,9 +4,20 @@
 #include <glm/glm.hpp>
 #include "model/Model.h"
 
+// Matches SPECULAR_MODEL in the lit fragment shaders.
+enum class SpecularModel : uint32_t
+{
+    None = 0,
+    BlinnPhong = 1,
+};
+
 struct ModelComponent 
 {
     std::shared_ptr<Model> model;
     VkDescriptorSet textureDescriptorSet = VK_NULL_HANDLE;
     glm::vec3 color{1.0f, 1.0f, 1.0f}; // Default white color
+    // Its pipeline variant is built on demand, the model is drawn without culling until it is ready.
+    bool cullBackFaces = false;
+    // Same, a model without highlights gets a variant with the specular term stripped.
+    SpecularModel specularModel = SpecularModel::BlinnPhong;
 }; 
\ No newline at end of file
@@ -12,4 +12,6 @@ struct ParticleSystemComponent
     glm::vec3 color = glm::vec3(1.0f, 0.3f, 0.0f);
     glm::vec3 colorVariation = glm::vec3(0.2f, 0.2f, 0.2f);
     bool active = true;
+    // Simulate on the async compute queue when the device has one, on the graphics queue otherwise.
+    bool asyncCompute = true;
 }; 
\ No newline at end of file
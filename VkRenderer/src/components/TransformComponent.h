@@ -7,6 +7,39 @@ struct TransformComponent
     glm::vec3 scale{1.f, 1.f, 1.f};
     glm::vec3 rotation{};
 
+    // Inverse of Mat4 for matrices without shear, imported node transforms for instance. A mirroring matrix comes back
+    // with a negative x scale.
+    static TransformComponent FromMatrix(const glm::mat4& _matrix)
+    {
+        glm::vec3 axes[3] = { glm::vec3(_matrix[0]), glm::vec3(_matrix[1]), glm::vec3(_matrix[2]) };
+
+        TransformComponent transform{};
+        transform.translation = glm::vec3(_matrix[3]);
+        transform.scale = { glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2]) };
+        if (glm::determinant(glm::mat3(_matrix)) < 0.0f)
+            transform.scale.x = -transform.scale.x;
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (transform.scale[i] != 0.0f)
+                axes[i] /= transform.scale[i];
+        }
+
+        // Columns of the Y, X, Z rotation built by Mat4, the x angle comes from the z axis height.
+        transform.rotation.x = glm::asin(glm::clamp(-axes[2].y, -1.0f, 1.0f));
+        if (glm::abs(axes[2].y) < 0.9999f)
+        {
+            transform.rotation.y = glm::atan(axes[2].x, axes[2].z);
+            transform.rotation.z = glm::atan(axes[0].y, axes[1].y);
+        }
+        else
+        {
+            // Looking straight up or down, y and z turn around the same axis so z is left at zero.
+            transform.rotation.y = glm::atan(-axes[0].z, axes[0].x);
+        }
+        return transform;
+    }
+
     glm::mat4 Mat4() const {
         const float c3 = glm::cos(rotation.z);
         const float s3 = glm::sin(rotation.z);
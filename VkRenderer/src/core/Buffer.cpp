@@ -1,4 +1,5 @@
 #include "Buffer.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -17,7 +18,7 @@ Buffer::Buffer(Device& _device, VkDeviceSize _instanceSize, uint32_t _instanceCo
     m_alignmentSize = GetAlignment(_instanceSize, _minOffsetAlignment);
     m_bufferSize = m_alignmentSize * _instanceCount;
     VkDeviceSize realAllocSize = 0;
-    _device.CreateBuffer(m_bufferSize, _usageFlags, _memoryPropertyFlags, m_buffer, m_memory, realAllocSize);
+    _device.CreateBuffer(m_bufferSize, _usageFlags, _memoryPropertyFlags, m_buffer, m_allocation, realAllocSize);
     m_allocationSize = realAllocSize;
 }
 
@@ -26,32 +27,54 @@ Buffer::Buffer(Device& _device, VkDeviceSize _instanceSize, uint32_t _instanceCo
 {
 }
 
+Buffer::Buffer(Device& _device, VkDeviceSize _instanceSize, uint32_t _instanceCount, VkBufferUsageFlags _usageFlags, VkMemoryPropertyFlags _memoryPropertyFlags, std::vector<uint32_t> _queueFamilies)
+    : m_device{ _device },  m_instanceSize{ _instanceSize }, m_instanceCount{ _instanceCount }, m_usageFlags{ _usageFlags }, m_memoryPropertyFlags{ _memoryPropertyFlags }
+{
+    m_alignmentSize = _instanceSize;
+    m_bufferSize = m_alignmentSize * _instanceCount;
+
+    std::sort(_queueFamilies.begin(), _queueFamilies.end());
+    _queueFamilies.erase(std::unique(_queueFamilies.begin(), _queueFamilies.end()), _queueFamilies.end());
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_bufferSize;
+    bufferInfo.usage = _usageFlags;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (_queueFamilies.size() > 1)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(_queueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = _queueFamilies.data();
+    }
+
+    _device.CreateBufferWithInfo(bufferInfo, _memoryPropertyFlags, m_buffer, m_allocation);
+    m_allocationSize = m_allocation.size;
+}
+
 Buffer::~Buffer() 
 {
     Unmap();
     vkDestroyBuffer(m_device.GetDevice(), m_buffer, nullptr);
-    vkFreeMemory(m_device.GetDevice(), m_memory, nullptr);
+    m_device.FreeMemory(m_allocation);
 }
 
 
 VkResult Buffer::Map(VkDeviceSize _size, VkDeviceSize _offset)
 {
-    assert(m_buffer && m_memory && "Called map on buffer before create");
-    if (_size == VK_WHOLE_SIZE)
-    {
-        return vkMapMemory(m_device.GetDevice(), m_memory, 0, m_bufferSize, 0, &m_mapped);
-    }
-    return vkMapMemory(m_device.GetDevice(), m_memory, _offset, _size, 0, &m_mapped);
+    assert(m_buffer && m_allocation.memory && "Called map on buffer before create");
+    // Host visible memory is mapped once by the allocator, the block it lives in is shared so it cannot be mapped here.
+    if (!m_allocation.mapped)
+        return VK_ERROR_MEMORY_MAP_FAILED;
+
+    m_mapped = static_cast<char*>(m_allocation.mapped) + (_size == VK_WHOLE_SIZE ? 0 : _offset);
+    return VK_SUCCESS;
 }
 
 
 void Buffer::Unmap()
 {
-    if (m_mapped) 
-    {
-        vkUnmapMemory(m_device.GetDevice(), m_memory);
-        m_mapped = nullptr;
-    }
+    m_mapped = nullptr;
 }
 
 
@@ -72,46 +95,41 @@ void Buffer::WriteToBuffer(void* _data, VkDeviceSize _size, VkDeviceSize _offset
 }
 
 
-VkResult Buffer::Flush(VkDeviceSize _size, VkDeviceSize _offset)
+VkMappedMemoryRange Buffer::GetMappedRange(VkDeviceSize _size, VkDeviceSize _offset) const
 {
-    VkPhysicalDeviceProperties properties;
-    vkGetPhysicalDeviceProperties(m_device.GetPhysicalDevice(), &properties);
-    VkDeviceSize atomSize = properties.limits.nonCoherentAtomSize;
+    // The allocator aligns non coherent allocations to whole atoms, so rounding inside the allocation never touches
+    // a neighbour.
+    VkDeviceSize atomSize = m_device.properties.limits.nonCoherentAtomSize;
+    VkDeviceSize begin = _offset / atomSize * atomSize;
+    VkDeviceSize end = _size == VK_WHOLE_SIZE ? m_allocation.size : (_offset + _size + atomSize - 1) / atomSize * atomSize;
+    if (end > m_allocation.size)
+        end = m_allocation.size;
 
-    if (_size == VK_WHOLE_SIZE || _offset + _size > m_allocationSize) 
-    {
-        _size = m_allocationSize - _offset;
-    }
-    else 
-    {
-        if ((_size % atomSize) != 0)
-        {
-            if ((_offset + _size) != m_allocationSize) 
-            {
-                VkDeviceSize alignedSize = ((_size + atomSize - 1) / atomSize) * atomSize;
-                if (_offset + alignedSize > m_allocationSize) {
-                    alignedSize = m_allocationSize - _offset;
-                }
-                _size = alignedSize;
-            }
-        }
-    }
     VkMappedMemoryRange mappedRange = {};
     mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = m_memory;
-    mappedRange.offset = _offset;
-    mappedRange.size = _size;
+    mappedRange.memory = m_allocation.memory;
+    mappedRange.offset = m_allocation.offset + begin;
+    mappedRange.size = end - begin;
+    return mappedRange;
+}
+
+
+VkResult Buffer::Flush(VkDeviceSize _size, VkDeviceSize _offset)
+{
+    if (m_memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        return VK_SUCCESS;
+
+    VkMappedMemoryRange mappedRange = GetMappedRange(_size, _offset);
     return vkFlushMappedMemoryRanges(m_device.GetDevice(), 1, &mappedRange);
 }
 
 
 VkResult Buffer::Invalidate(VkDeviceSize _size, VkDeviceSize _offset) 
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = m_memory;
-    mappedRange.offset = _offset;
-    mappedRange.size = _size;
+    if (m_memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        return VK_SUCCESS;
+
+    VkMappedMemoryRange mappedRange = GetMappedRange(_size, _offset);
     return vkInvalidateMappedMemoryRanges(m_device.GetDevice(), 1, &mappedRange);
 }
 
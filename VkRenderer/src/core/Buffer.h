@@ -7,6 +7,8 @@ class Buffer
 public:
     Buffer(Device& _device, VkDeviceSize _instanceSize, uint32_t _instanceCount, VkBufferUsageFlags _usageFlags, VkMemoryPropertyFlags _memoryPropertyFlags, VkDeviceSize _minOffsetAlignment = 1);
     Buffer(Device& _device, VkDeviceSize _instanceSize, uint32_t _instanceCount, VkBufferUsageFlags _usageFlags, VkMemoryPropertyFlags _memoryPropertyFlags, VkDeviceSize _minOffsetAlignment, VkDeviceSize allocationSize);
+    // Shared between _queueFamilies without ownership transfers, exclusive when they are all the same family.
+    Buffer(Device& _device, VkDeviceSize _instanceSize, uint32_t _instanceCount, VkBufferUsageFlags _usageFlags, VkMemoryPropertyFlags _memoryPropertyFlags, std::vector<uint32_t> _queueFamilies);
     ~Buffer();
 
     Buffer(const Buffer&) = delete;
@@ -37,11 +39,13 @@ public:
 
 private:
     static VkDeviceSize GetAlignment(VkDeviceSize _instanceSize, VkDeviceSize _minOffsetAlignment);
+    // Range of the shared device memory covering [_offset, _offset + _size) of the buffer, widened to whole atoms.
+    VkMappedMemoryRange GetMappedRange(VkDeviceSize _size, VkDeviceSize _offset) const;
 
     Device& m_device;
     void* m_mapped = nullptr;
     VkBuffer m_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    MemoryAllocation m_allocation{};
 
     VkDeviceSize m_bufferSize;
     uint32_t m_instanceCount;
@@ -0,0 +1,56 @@
+#include "core/DeletionQueue.h"
+
+DeletionQueue::DeletionQueue(Device& _device) : m_device{ _device }
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    // Destroying may release more, the owners of a buffer for instance.
+    for (bool empty = false; !empty;)
+    {
+        empty = true;
+        for (std::vector<Entry>& frame : m_frames)
+        {
+            std::vector<Entry> entries = std::move(frame);
+            frame.clear();
+            for (Entry& entry : entries)
+            {
+                entry.destroy();
+                empty = false;
+            }
+        }
+    }
+}
+
+void DeletionQueue::Push(std::function<void()> _destroy)
+{
+    m_frames[m_currentFrame].push_back({ m_device.GetStagingRing().GetToken(), std::move(_destroy) });
+}
+
+void DeletionQueue::BeginFrame(int _frameIndex)
+{
+    m_currentFrame = _frameIndex;
+
+    StagingRing& stagingRing = m_device.GetStagingRing();
+    std::vector<Entry> entries = std::move(m_frames[_frameIndex]);
+    m_frames[_frameIndex].clear();
+    for (Entry& entry : entries)
+    {
+        // Copies still pending, checked again the next time the slot comes around.
+        if (stagingRing.IsComplete(entry.token))
+            entry.destroy();
+        else
+            m_frames[_frameIndex].push_back(std::move(entry));
+    }
+}
+
+size_t DeletionQueue::GetPendingCount() const
+{
+    size_t count = 0;
+    for (const std::vector<Entry>& frame : m_frames)
+    {
+        count += frame.size();
+    }
+    return count;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "core/Device.h"
+#include "core/SwapChain.h"
+#include "core/StagingRing.h"
+#include <array>
+#include <functional>
+#include <vector>
+
+// Destroys GPU resources once no frame in flight can use them, instead of waiting for the device to go idle. What is
+// released while frame N is recorded, or after it is submitted, goes with frame N and is destroyed when the renderer
+// begins the next frame of the same slot, right after waiting on frame N's fence. Resources whose uploads are still
+// waiting in the staging ring also wait for their batch.
+// Render thread only.
+class DeletionQueue
+{
+public:
+    DeletionQueue(Device& _device);
+    // Runs everything left, the device must be idle.
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    // _destroy must only capture handles or own what it releases, the objects it came from are usually gone when it runs.
+    void Push(std::function<void()> _destroy);
+
+    // Once the fence of the last frame of this slot has signaled.
+    void BeginFrame(int _frameIndex);
+
+    size_t GetPendingCount() const;
+
+private:
+    struct Entry
+    {
+        StagingRing::Token token = 0;
+        std::function<void()> destroy;
+    };
+
+    Device& m_device;
+    std::array<std::vector<Entry>, SwapChain::MAX_FRAMES_IN_FLIGHT> m_frames{};
+    int m_currentFrame = 0;
+};
@@ -1,4 +1,10 @@
 #include "Device.h"
+#include "GeometryPool.h"
+#include "StagingRing.h"
+#include "DeletionQueue.h"
+#include "PipelineCache.h"
+#include "PipelineLibrary.h"
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -34,10 +40,26 @@ Device::Device(Window &_window) : m_window { _window }
     SelectPhysicalDevice();
     CreateLogicalDevice();
     CreateCommandPool();
+    m_memoryAllocator = std::make_unique<MemoryAllocator>(m_device, m_physicalDevice);
+    m_stagingRing = std::make_unique<StagingRing>(*this);
+    m_geometryPool = std::make_unique<GeometryPool>(*this);
+    m_deletionQueue = std::make_unique<DeletionQueue>(*this);
+    m_pipelineCache = std::make_unique<PipelineCache>(m_device, m_physicalDevice);
+    m_pipelineLibrary = std::make_unique<PipelineLibrary>(*this);
 }
 
 Device::~Device()
 {
+    // Frees ranges of the pool and memory of the allocator.
+    m_deletionQueue.reset();
+    // Waits for the copies still in flight into the pool.
+    m_stagingRing.reset();
+    m_geometryPool.reset();
+    m_memoryAllocator.reset();
+    // Waits for the pipeline builds still running, they create through the cache.
+    m_pipelineLibrary.reset();
+    // Writes the cache back to disk.
+    m_pipelineCache.reset();
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
     vkDestroyDevice(m_device, nullptr);
     if (enableValidationLayers) {
@@ -122,16 +144,22 @@ void Device::CreateLogicalDevice()
     QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value(), indices.computeFamily.value() };
 
-    float queuePriority = 1.0f;
+    float queuePriorities[] = { 1.0f, 1.0f, 1.0f };
     for (uint32_t queueFamily : uniqueQueueFamilies) 
     {
+        uint32_t queueCount = 1;
+        if (queueFamily == indices.transferFamily.value())
+            queueCount = std::max(queueCount, indices.transferQueueIndex + 1);
+        if (queueFamily == indices.computeFamily.value())
+            queueCount = std::max(queueCount, indices.computeQueueIndex + 1);
+
         VkDeviceQueueCreateInfo queueCreateInfo = {};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueCount = queueCount;
+        queueCreateInfo.pQueuePriorities = queuePriorities;
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
@@ -161,6 +189,15 @@ void Device::CreateLogicalDevice()
 
     vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
+    vkGetDeviceQueue(m_device, indices.transferFamily.value(), indices.transferQueueIndex, &m_transferQueue);
+    vkGetDeviceQueue(m_device, indices.computeFamily.value(), indices.computeQueueIndex, &m_computeQueue);
+
+    if (indices.transferFamily != indices.graphicsFamily)
+        std::cout << "Uploads on transfer queue family " << indices.transferFamily.value() << std::endl;
+    else if (indices.transferQueueIndex != 0)
+        std::cout << "Uploads on a second graphics queue" << std::endl;
+    if (HasAsyncComputeQueue())
+        std::cout << "Async compute on queue family " << indices.computeFamily.value() << std::endl;
 }
 
 void Device::CreateCommandPool() 
@@ -336,6 +373,46 @@ QueueFamilyIndices Device::FindQueueFamilies(VkPhysicalDevice _device)
     
         i++;
     }
+
+    if (!indices.graphicsFamily.has_value())
+        return indices;
+
+    // Spare queues of the graphics family are handed out after queue 0, which graphics and present use.
+    uint32_t graphicsQueueCount = queueFamilies[indices.graphicsFamily.value()].queueCount;
+    uint32_t nextGraphicsQueue = 1;
+
+    // Dedicated DMA engines expose transfer only families, copies there run alongside rendering.
+    for (uint32_t family = 0; family < queueFamilyCount; family++)
+    {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+        {
+            indices.transferFamily = family;
+            break;
+        }
+    }
+    if (!indices.transferFamily.has_value())
+    {
+        indices.transferFamily = indices.graphicsFamily;
+        if (nextGraphicsQueue < graphicsQueueCount)
+            indices.transferQueueIndex = nextGraphicsQueue++;
+    }
+
+    for (uint32_t family = 0; family < queueFamilyCount; family++)
+    {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.computeFamily = family;
+            break;
+        }
+    }
+    if (!indices.computeFamily.has_value())
+    {
+        indices.computeFamily = indices.graphicsFamily;
+        if (nextGraphicsQueue < graphicsQueueCount)
+            indices.computeQueueIndex = nextGraphicsQueue++;
+    }
     
     return indices;
 }
@@ -394,7 +471,7 @@ uint32_t Device::FindMemoryType(uint32_t _typeFilter, VkMemoryPropertyFlags _pro
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void Device::CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, VkDeviceMemory& _bufferMemory, VkDeviceSize& _allocationSize)
+void Device::CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, MemoryAllocation& _bufferMemory, VkDeviceSize& _allocationSize)
 {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -410,18 +487,24 @@ void Device::CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemor
     vkGetBufferMemoryRequirements(m_device, _buffer, &memRequirements);
     _allocationSize = memRequirements.size;
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, _properties);
+    _bufferMemory = m_memoryAllocator->Allocate(memRequirements, _properties, MemoryAllocator::ResourceKind::Linear);
+    vkBindBufferMemory(m_device, _buffer, _bufferMemory.memory, _bufferMemory.offset);
+}
 
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &_bufferMemory) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate vertex buffer memory");
+void Device::CreateBufferWithInfo(const VkBufferCreateInfo& _bufferInfo, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, MemoryAllocation& _bufferMemory)
+{
+    if (vkCreateBuffer(m_device, &_bufferInfo, nullptr, &_buffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to create buffer");
 
-    vkBindBufferMemory(m_device, _buffer, _bufferMemory, 0);
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device, _buffer, &memRequirements);
+
+    _bufferMemory = m_memoryAllocator->Allocate(memRequirements, _properties, MemoryAllocator::ResourceKind::Linear);
+    if (vkBindBufferMemory(m_device, _buffer, _bufferMemory.memory, _bufferMemory.offset) != VK_SUCCESS)
+        throw std::runtime_error("failed to bind buffer memory");
 }
 
-void Device::CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, VkDeviceMemory& _bufferMemory)
+void Device::CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, MemoryAllocation& _bufferMemory)
 {
     VkDeviceSize dummyAllocSize;
     CreateBuffer(_size, _usage, _properties, _buffer, _bufferMemory, dummyAllocSize);
@@ -429,40 +512,17 @@ void Device::CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemor
 
 VkCommandBuffer Device::BeginSingleTimeCommands() 
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = m_commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    return commandBuffer;
+    return m_stagingRing->GetCommandBuffer();
 }
 
 void Device::EndSingleTimeCommands(VkCommandBuffer _commandBuffer)
 {
-    vkEndCommandBuffer(_commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &_commandBuffer;
-
-    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(m_graphicsQueue);
-
-    vkFreeCommandBuffers(m_device, m_commandPool, 1, &_commandBuffer);
+    // Everything recorded into the batch since the last submit goes with it, not only _commandBuffer's own commands.
+    m_stagingRing->Wait(m_stagingRing->Submit());
 }
 
 void Device::CopyBuffer(VkBuffer _srcBuffer, VkBuffer _dstBuffer, VkDeviceSize _size) {
-    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = m_stagingRing->GetCommandBuffer();
 
     VkBufferCopy copyRegion{};
     copyRegion.srcOffset = 0; 
@@ -470,13 +530,11 @@ void Device::CopyBuffer(VkBuffer _srcBuffer, VkBuffer _dstBuffer, VkDeviceSize _
     copyRegion.size = _size;
 
     vkCmdCopyBuffer(commandBuffer, _srcBuffer, _dstBuffer, 1, &copyRegion);
-
-    EndSingleTimeCommands(commandBuffer);
 }
 
 void Device::CopyBufferToImage( VkBuffer _buffer, VkImage _image, uint32_t _width, uint32_t _height, uint32_t _layerCount) 
 {
-    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = m_stagingRing->GetCommandBuffer();
 
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
@@ -490,11 +548,9 @@ void Device::CopyBufferToImage( VkBuffer _buffer, VkImage _image, uint32_t _widt
     region.imageExtent = { _width, _height, 1 };
 
     vkCmdCopyBufferToImage(commandBuffer, _buffer, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    EndSingleTimeCommands(commandBuffer);
 }
 
-void Device::CreateImageWithInfo(const VkImageCreateInfo& _imageInfo, VkMemoryPropertyFlags _properties,VkImage& _image, VkDeviceMemory& _imageMemory) 
+void Device::CreateImageWithInfo(const VkImageCreateInfo& _imageInfo, VkMemoryPropertyFlags _properties,VkImage& _image, MemoryAllocation& _imageMemory) 
 {
     if (vkCreateImage(m_device, &_imageInfo, nullptr, &_image) != VK_SUCCESS) 
         throw std::runtime_error("faild to create image");
@@ -503,16 +559,10 @@ void Device::CreateImageWithInfo(const VkImageCreateInfo& _imageInfo, VkMemoryPr
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_device, _image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, _properties);
-
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &_imageMemory) != VK_SUCCESS) 
-        throw std::runtime_error("failed to allocate image memory");
-    
+    MemoryAllocator::ResourceKind kind = _imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? MemoryAllocator::ResourceKind::Optimal : MemoryAllocator::ResourceKind::Linear;
+    _imageMemory = m_memoryAllocator->Allocate(memRequirements, _properties, kind);
 
-    if (vkBindImageMemory(m_device, _image, _imageMemory, 0) != VK_SUCCESS) 
+    if (vkBindImageMemory(m_device, _image, _imageMemory.memory, _imageMemory.offset) != VK_SUCCESS) 
         throw std::runtime_error("failed to bind image memory");
 
 }
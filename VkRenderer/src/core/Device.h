@@ -1,14 +1,30 @@
 #pragma once
 #include "window/Window.h"
+#include "core/MemoryAllocator.h"
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <string>
 #include <optional>
+#include <memory>
+
+class GeometryPool;
+class StagingRing;
+class DeletionQueue;
+class PipelineCache;
+class PipelineLibrary;
 
 struct QueueFamilyIndices 
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Uploads go to a transfer only family when the device has one, to a second queue of the graphics family
+    // otherwise, and to the graphics queue itself as a last resort.
+    std::optional<uint32_t> transferFamily;
+    uint32_t transferQueueIndex = 0;
+    // Compute only family, or a spare queue of the graphics family. Falls back to the graphics queue, which runs the
+    // compute work inline with the frame.
+    std::optional<uint32_t> computeFamily;
+    uint32_t computeQueueIndex = 0;
 
     bool isComplete()  {    return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
@@ -42,22 +58,44 @@ public:
     VkSurfaceKHR GetSurface() { return m_surface; }
     VkQueue GetGraphicsQueue() { return m_graphicsQueue; }
     VkQueue GetPresentQueue() { return m_presentQueue; }
+    VkQueue GetTransferQueue() { return m_transferQueue; }
+    VkQueue GetComputeQueue() { return m_computeQueue; }
+    bool HasAsyncComputeQueue() const { return m_computeQueue != m_graphicsQueue; }
     VkInstance GetInstance() const { return m_instance; }
     VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+    // Shared vertex and index buffers of every model, released before the device.
+    GeometryPool& GetGeometryPool() { return *m_geometryPool; }
+    // Backs every buffer and image created through the device.
+    MemoryAllocator& GetMemoryAllocator() { return *m_memoryAllocator; }
+    // Upload memory for every transfer to device local resources, submitted by the renderer once per frame.
+    StagingRing& GetStagingRing() { return *m_stagingRing; }
+    // Resources a frame in flight may still use are released through it, never with a device wide wait.
+    DeletionQueue& GetDeletionQueue() { return *m_deletionQueue; }
+    // Loaded from disk with the device, every pipeline is created through it.
+    PipelineCache& GetPipelineCache() { return *m_pipelineCache; }
+    // Graphics pipelines, shader modules and pipeline layouts shared by every system.
+    PipelineLibrary& GetPipelineLibrary() { return *m_pipelineLibrary; }
 
     SwapChainSupportDetails GetSwapChainSupport() { return QuerySwapChainSupport(m_physicalDevice); }
     uint32_t FindMemoryType(uint32_t _typeFilter, VkMemoryPropertyFlags _properties);
     QueueFamilyIndices FindPhysicalQueueFamilies() { return FindQueueFamilies(m_physicalDevice); }
     VkFormat FindSupportedFormat(const std::vector<VkFormat>& _candidates, VkImageTiling _tiling, VkFormatFeatureFlags _features);
 
-    void CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, VkDeviceMemory& _bufferMemory);
-    void CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, VkDeviceMemory& _bufferMemory, VkDeviceSize& _allocationSize);
+    // Memory comes from the allocator, release it with FreeMemory once the buffer or image is destroyed.
+    void CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, MemoryAllocation& _bufferMemory);
+    void CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, MemoryAllocation& _bufferMemory, VkDeviceSize& _allocationSize);
+    // For sharing modes and queue family lists the other overloads do not expose.
+    void CreateBufferWithInfo(const VkBufferCreateInfo& _bufferInfo, VkMemoryPropertyFlags _properties, VkBuffer& _buffer, MemoryAllocation& _bufferMemory);
+    void FreeMemory(MemoryAllocation& _memory) { m_memoryAllocator->Free(_memory); }
+    // Records into the staging ring batch, End submits it and waits for its fence. Only for work that must be done
+    // before returning, uploads should record into the ring and let the renderer submit it.
     VkCommandBuffer BeginSingleTimeCommands();
     void EndSingleTimeCommands(VkCommandBuffer _commandBuffer);
+    // Recorded into the staging ring batch, run before the next frame.
     void CopyBuffer(VkBuffer _srcBuffer, VkBuffer _dstBuffer, VkDeviceSize _size);
     void CopyBufferToImage(VkBuffer _buffer, VkImage _image, uint32_t _width, uint32_t _height, uint32_t _layerCount);
 
-    void CreateImageWithInfo( const VkImageCreateInfo& _imageInfo, VkMemoryPropertyFlags _properties, VkImage& _image, VkDeviceMemory& _imageMemory);
+    void CreateImageWithInfo( const VkImageCreateInfo& _imageInfo, VkMemoryPropertyFlags _properties, VkImage& _image, MemoryAllocation& _imageMemory);
 
     VkPhysicalDeviceProperties properties;
      VkSampleCountFlagBits  GetMaxUsableSampleCount();
@@ -91,6 +129,15 @@ private:
     VkSurfaceKHR m_surface;
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
+    VkQueue m_transferQueue;
+    VkQueue m_computeQueue;
+
+    std::unique_ptr<MemoryAllocator> m_memoryAllocator;
+    std::unique_ptr<StagingRing> m_stagingRing;
+    std::unique_ptr<GeometryPool> m_geometryPool;
+    std::unique_ptr<DeletionQueue> m_deletionQueue;
+    std::unique_ptr<PipelineCache> m_pipelineCache;
+    std::unique_ptr<PipelineLibrary> m_pipelineLibrary;
 
     const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
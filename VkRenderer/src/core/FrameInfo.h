@@ -30,5 +30,8 @@ struct FrameInfo
 	VkDescriptorSet globalDescriptorSet;
 	// GameObject::Map& gameObjects;
 	EntityComponentSystem* ec = nullptr;
+	VkExtent2D extent{};
+	// Point lights in the global ubo.
+	int lightCount = 0;
 };
 
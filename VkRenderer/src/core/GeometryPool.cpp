@@ -0,0 +1,257 @@
+#include "core/GeometryPool.h"
+#include "core/StagingRing.h"
+#include "core/DeletionQueue.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+GeometryPool::GeometryPool(Device& _device) : m_device{ _device }
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+uint32_t GeometryPool::FindArena(VkBufferUsageFlags _usage, uint32_t _elementSize)
+{
+    for (uint32_t i = 0; i < m_arenas.size(); i++)
+    {
+        if (m_arenas[i].usage == _usage && m_arenas[i].elementSize == _elementSize)
+            return i;
+    }
+
+    Arena arena{};
+    arena.usage = _usage;
+    arena.elementSize = _elementSize;
+    if (_usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+    {
+        VkDeviceSize storageAlignment = std::max<VkDeviceSize>(m_device.properties.limits.minStorageBufferOffsetAlignment, sizeof(uint32_t));
+        // In elements, the first multiple of the element size that is also a multiple of the storage alignment.
+        arena.alignment = std::lcm<VkDeviceSize>(storageAlignment, _elementSize) / _elementSize;
+        assert((arena.alignment & (arena.alignment - 1)) == 0 && "Geometry pool alignment must be a power of two");
+    }
+    arena.allocator = std::make_unique<RangeAllocator>(0);
+
+    m_arenas.push_back(std::move(arena));
+    return static_cast<uint32_t>(m_arenas.size() - 1);
+}
+
+GeometryPool::Handle GeometryPool::AllocateVertices(const void* _vertices, uint32_t _vertexSize, uint32_t _vertexCount)
+{
+    VkDeviceSize dataSize = static_cast<VkDeviceSize>(_vertexSize) * _vertexCount;
+    return AllocateVertices(_vertexSize, _vertexCount, [&](void* _destination) { std::memcpy(_destination, _vertices, dataSize); });
+}
+
+GeometryPool::Handle GeometryPool::AllocateIndices(const void* _indices, VkIndexType _indexType, uint32_t _indexCount)
+{
+    VkDeviceSize dataSize = static_cast<VkDeviceSize>(_indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t)) * _indexCount;
+    return AllocateIndices(_indexType, _indexCount, [&](void* _destination) { std::memcpy(_destination, _indices, dataSize); });
+}
+
+GeometryPool::Handle GeometryPool::AllocateVertices(uint32_t _vertexSize, uint32_t _vertexCount, const Writer& _write)
+{
+    uint32_t arena = FindArena(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _vertexSize);
+    return Allocate(arena, static_cast<VkDeviceSize>(_vertexSize) * _vertexCount, _vertexCount, _write);
+}
+
+GeometryPool::Handle GeometryPool::AllocateIndices(VkIndexType _indexType, uint32_t _indexCount, const Writer& _write)
+{
+    uint32_t indexSize = _indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    // The meshlet culling pass reads the indices as a storage buffer.
+    uint32_t arena = FindArena(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, indexSize);
+
+    // Even count so shaders reading 16-bit indices as 32-bit words stay in the range.
+    uint64_t allocatedCount = _indexType == VK_INDEX_TYPE_UINT16 ? (uint64_t(_indexCount) + 1) & ~1ull : _indexCount;
+    return Allocate(arena, static_cast<VkDeviceSize>(indexSize) * _indexCount, allocatedCount, _write);
+}
+
+GeometryPool::Handle GeometryPool::Allocate(uint32_t _arena, VkDeviceSize _dataSize, uint64_t _count, const Writer& _write)
+{
+    uint64_t offset = m_arenas[_arena].allocator->Allocate(_count, m_arenas[_arena].alignment);
+    if (offset == RangeAllocator::INVALID_OFFSET)
+    {
+        // Compact first, the free space may only be scattered, and double the buffer until the range fits.
+        const RangeAllocator& allocator = *m_arenas[_arena].allocator;
+        uint64_t capacity = std::max<uint64_t>(allocator.GetSize(), INITIAL_BUFFER_SIZE / m_arenas[_arena].elementSize);
+        while (capacity - allocator.GetUsedSize() < _count + m_arenas[_arena].alignment)
+        {
+            capacity *= 2;
+        }
+
+        while (offset == RangeAllocator::INVALID_OFFSET)
+        {
+            Reallocate(_arena, capacity);
+            offset = m_arenas[_arena].allocator->Allocate(_count, m_arenas[_arena].alignment);
+            capacity *= 2;
+        }
+    }
+
+    Arena& arena = m_arenas[_arena];
+    arena.allocationCount++;
+
+    Handle handle;
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        m_allocations.emplace_back();
+        handle = static_cast<Handle>(m_allocations.size() - 1);
+    }
+    m_allocations[handle] = { _arena, offset, _count, true };
+
+    if (_dataSize > 0)
+    {
+        StagingRing& stagingRing = m_device.GetStagingRing();
+        StagingRing::Allocation staging = stagingRing.Allocate(_dataSize);
+        _write(staging.data);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = staging.offset;
+        copyRegion.dstOffset = offset * arena.elementSize;
+        copyRegion.size = _dataSize;
+        // The pool buffers are shared with the transfer family, the semaphore between the batch halves is the only
+        // ordering the graphics queue needs.
+        vkCmdCopyBuffer(stagingRing.GetTransferCommandBuffer(), staging.buffer, arena.buffer->GetBuffer(), 1, &copyRegion);
+    }
+
+    return handle;
+}
+
+void GeometryPool::Free(Handle _handle)
+{
+    assert(_handle < m_allocations.size() && m_allocations[_handle].live && "Invalid geometry pool handle");
+
+    Allocation& allocation = m_allocations[_handle];
+    m_arenas[allocation.arena].allocator->Free(allocation.offset);
+    m_arenas[allocation.arena].allocationCount--;
+    m_arenas[allocation.arena].fragmented = true;
+    allocation.live = false;
+    m_freeHandles.push_back(_handle);
+}
+
+void GeometryPool::Reallocate(uint32_t _arena, uint64_t _capacity)
+{
+    Arena& arena = m_arenas[_arena];
+
+    std::vector<Handle> handles{};
+    for (Handle handle = 0; handle < m_allocations.size(); handle++)
+    {
+        if (m_allocations[handle].live && m_allocations[handle].arena == _arena)
+            handles.push_back(handle);
+    }
+    std::sort(handles.begin(), handles.end(), [&](Handle _a, Handle _b) { return m_allocations[_a].offset < m_allocations[_b].offset; });
+
+    // A fresh allocator hands out its single free block front to back, so re-allocating in offset order packs the ranges.
+    auto allocator = std::make_unique<RangeAllocator>(_capacity);
+    std::vector<VkBufferCopy> copyRegions{};
+    copyRegions.reserve(handles.size());
+    for (Handle handle : handles)
+    {
+        Allocation& allocation = m_allocations[handle];
+        uint64_t offset = allocator->Allocate(allocation.count, arena.alignment);
+        if (offset == RangeAllocator::INVALID_OFFSET)
+            throw std::runtime_error("failed to compact geometry pool buffer");
+
+        copyRegions.push_back({ allocation.offset * arena.elementSize, offset * arena.elementSize, allocation.count * arena.elementSize });
+        allocation.offset = offset;
+    }
+
+    // Concurrent, uploads write ranges from the transfer queue while the graphics queue draws from the rest.
+    QueueFamilyIndices queueFamilies = m_device.FindPhysicalQueueFamilies();
+    auto buffer = std::make_unique<Buffer>(m_device, arena.elementSize, static_cast<uint32_t>(_capacity),
+        arena.usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        std::vector<uint32_t>{ queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value() });
+
+    if (!copyRegions.empty())
+    {
+        // Uploads into the old buffer still waiting in the staging ring must land before it is copied, the barrier
+        // closing their batch orders them.
+        StagingRing& stagingRing = m_device.GetStagingRing();
+        stagingRing.Submit();
+
+        vkCmdCopyBuffer(stagingRing.GetCommandBuffer(), arena.buffer->GetBuffer(), buffer->GetBuffer(), static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+        // Queued ahead of the next frame, which already draws from the new buffer.
+        stagingRing.SubmitForGraphics();
+    }
+
+    if (arena.buffer)
+    {
+        // The frames in flight and the copy still read the old buffer.
+        std::shared_ptr<Buffer> oldBuffer = std::move(arena.buffer);
+        m_device.GetDeletionQueue().Push([oldBuffer]() mutable { oldBuffer.reset(); });
+    }
+
+    arena.buffer = std::move(buffer);
+    arena.allocator = std::move(allocator);
+    arena.fragmented = false;
+}
+
+void GeometryPool::Defragment(bool _force)
+{
+    for (uint32_t i = 0; i < m_arenas.size(); i++)
+    {
+        // Alignment padding also shows up as free blocks, only ranges freed since the last pass are worth a copy.
+        if (!m_arenas[i].fragmented)
+            continue;
+
+        // Free space outside the largest block is what allocations may fail to use.
+        const RangeAllocator& allocator = *m_arenas[i].allocator;
+        uint64_t scatteredCount = allocator.GetSize() - allocator.GetUsedSize() - allocator.GetLargestFreeBlockSize();
+        if (_force || scatteredCount * DEFRAGMENT_FRACTION >= allocator.GetSize())
+        {
+            Reallocate(i, allocator.GetSize());
+        }
+    }
+}
+
+uint32_t GeometryPool::GetFirstElement(Handle _handle) const
+{
+    assert(_handle < m_allocations.size() && m_allocations[_handle].live && "Invalid geometry pool handle");
+    return static_cast<uint32_t>(m_allocations[_handle].offset);
+}
+
+VkBuffer GeometryPool::GetBuffer(Handle _handle) const
+{
+    assert(_handle < m_allocations.size() && m_allocations[_handle].live && "Invalid geometry pool handle");
+    return m_arenas[m_allocations[_handle].arena].buffer->GetBuffer();
+}
+
+VkDescriptorBufferInfo GeometryPool::GetDescriptorInfo(Handle _handle) const
+{
+    assert(_handle < m_allocations.size() && m_allocations[_handle].live && "Invalid geometry pool handle");
+    const Allocation& allocation = m_allocations[_handle];
+    const Arena& arena = m_arenas[allocation.arena];
+    return VkDescriptorBufferInfo{ arena.buffer->GetBuffer(), allocation.offset * arena.elementSize, allocation.count * arena.elementSize };
+}
+
+void GeometryPool::BindVertexBuffer(VkCommandBuffer _commandBuffer, Handle _handle) const
+{
+    VkBuffer buffers[] = { GetBuffer(_handle) };
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(_commandBuffer, 0, 1, buffers, offsets);
+}
+
+void GeometryPool::BindIndexBuffer(VkCommandBuffer _commandBuffer, Handle _handle) const
+{
+    const Arena& arena = m_arenas[m_allocations[_handle].arena];
+    vkCmdBindIndexBuffer(_commandBuffer, GetBuffer(_handle), 0, arena.elementSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+}
+
+GeometryPool::Stats GeometryPool::GetStats() const
+{
+    Stats stats{};
+    for (const Arena& arena : m_arenas)
+    {
+        stats.capacity += arena.allocator->GetSize() * arena.elementSize;
+        stats.usedSize += arena.allocator->GetUsedSize() * arena.elementSize;
+        stats.allocationCount += arena.allocationCount;
+        stats.freeBlockCount += arena.allocator->GetFreeBlockCount();
+    }
+    return stats;
+}
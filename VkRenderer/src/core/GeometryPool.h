@@ -0,0 +1,95 @@
+#pragma once
+#include "core/Device.h"
+#include "core/Buffer.h"
+#include "core/RangeAllocator.h"
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Device local buffers shared by every mesh. Vertices of one size live in one vertex buffer and indices of one type in
+// one index buffer, each suballocated with a RangeAllocator, so a mesh is a pair of ranges and draws only rebind
+// buffers when the vertex format or the index type changes.
+// Ranges are reached through handles because they move when a buffer is compacted.
+class GeometryPool
+{
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = ~0u;
+    // Fills the whole range in the mapped staging memory, for data converted on the fly instead of copied.
+    using Writer = std::function<void(void* _destination)>;
+
+    struct Stats
+    {
+        VkDeviceSize capacity = 0;
+        VkDeviceSize usedSize = 0;
+        uint32_t allocationCount = 0;
+        uint32_t freeBlockCount = 0;
+    };
+
+    GeometryPool(Device& _device);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // All upload through the staging ring, the copies run with its next submit.
+    Handle AllocateVertices(const void* _vertices, uint32_t _vertexSize, uint32_t _vertexCount);
+    Handle AllocateIndices(const void* _indices, VkIndexType _indexType, uint32_t _indexCount);
+    Handle AllocateVertices(uint32_t _vertexSize, uint32_t _vertexCount, const Writer& _write);
+    Handle AllocateIndices(VkIndexType _indexType, uint32_t _indexCount, const Writer& _write);
+    // Only returns the range. The holes left by unloaded meshes are compacted by Defragment, or when an allocation
+    // does not fit anymore, never from here since meshes may be destroyed while a frame is being recorded.
+    void Free(Handle _handle);
+
+    // Packs the live ranges of every buffer that lost some since the last compaction into a fresh one, handles stay
+    // valid. Without _force only buffers whose free space is scattered over more than 1 / DEFRAGMENT_FRACTION of them
+    // are packed. The copy is queued ahead of the next frame and the old buffer retired through the deletion queue,
+    // so call it between frames.
+    void Defragment(bool _force = false);
+
+    // vertexOffset or firstIndex of the range in draw commands.
+    uint32_t GetFirstElement(Handle _handle) const;
+    VkBuffer GetBuffer(Handle _handle) const;
+    // Index ranges start on minStorageBufferOffsetAlignment so shaders can read them as storage buffers.
+    VkDescriptorBufferInfo GetDescriptorInfo(Handle _handle) const;
+
+    void BindVertexBuffer(VkCommandBuffer _commandBuffer, Handle _handle) const;
+    void BindIndexBuffer(VkCommandBuffer _commandBuffer, Handle _handle) const;
+
+    Stats GetStats() const;
+
+private:
+    static constexpr VkDeviceSize INITIAL_BUFFER_SIZE = 8 * 1024 * 1024;
+    static constexpr uint64_t DEFRAGMENT_FRACTION = 4;
+
+    struct Arena
+    {
+        VkBufferUsageFlags usage = 0;
+        uint32_t elementSize = 0;
+        // In elements, as every offset and size of the allocator.
+        uint64_t alignment = 1;
+        std::unique_ptr<Buffer> buffer;
+        std::unique_ptr<RangeAllocator> allocator;
+        uint32_t allocationCount = 0;
+        bool fragmented = false;
+    };
+
+    struct Allocation
+    {
+        uint32_t arena = 0;
+        uint64_t offset = 0;
+        uint64_t count = 0;
+        bool live = false;
+    };
+
+    uint32_t FindArena(VkBufferUsageFlags _usage, uint32_t _elementSize);
+    Handle Allocate(uint32_t _arena, VkDeviceSize _dataSize, uint64_t _count, const Writer& _write);
+    // Moves the live ranges of the arena, packed in offset order, into a new buffer of _capacity elements.
+    void Reallocate(uint32_t _arena, uint64_t _capacity);
+
+    Device& m_device;
+    std::vector<Arena> m_arenas{};
+    std::vector<Allocation> m_allocations{};
+    std::vector<Handle> m_freeHandles{};
+};
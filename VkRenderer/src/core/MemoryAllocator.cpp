@@ -0,0 +1,217 @@
+#include "core/MemoryAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+MemoryAllocator::MemoryAllocator(VkDevice _device, VkPhysicalDevice _physicalDevice) : m_device{ _device }
+{
+    vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+    // With a granularity of 1 nothing can alias, both kinds share the blocks.
+    m_separateOptimal = properties.limits.bufferImageGranularity > 1;
+
+    m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < m_pools.size(); i++)
+    {
+        uint32_t memoryTypeIndex = i / 2;
+        VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+        // Small heaps, the 256 MB host visible window of discrete GPUs for instance, get smaller blocks so a few
+        // half empty ones cannot take the whole heap.
+        m_pools[i].memoryTypeIndex = memoryTypeIndex;
+        m_pools[i].blockSize = std::min(DEFAULT_BLOCK_SIZE, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+    }
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    for (Pool& pool : m_pools)
+    {
+        for (Block& block : pool.blocks)
+        {
+            if (block.memory != VK_NULL_HANDLE)
+            {
+                assert(block.allocationCount == 0 && "Device memory still allocated when the allocator is destroyed");
+                vkFreeMemory(m_device, block.memory, nullptr);
+            }
+        }
+    }
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t _typeFilter, VkMemoryPropertyFlags _properties) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        if ((_typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & _properties) == _properties)
+            return i;
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceMemory MemoryAllocator::AllocateMemory(uint32_t _memoryTypeIndex, VkDeviceSize _size, void** _mapped)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = _size;
+    allocInfo.memoryTypeIndex = _memoryTypeIndex;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+
+    *_mapped = nullptr;
+    if (m_memoryProperties.memoryTypes[_memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, _mapped) != VK_SUCCESS)
+        {
+            vkFreeMemory(m_device, memory, nullptr);
+            return VK_NULL_HANDLE;
+        }
+    }
+    return memory;
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements& _requirements, VkMemoryPropertyFlags _properties, ResourceKind _kind)
+{
+    uint32_t memoryTypeIndex = FindMemoryType(_requirements.memoryTypeBits, _properties);
+    VkMemoryPropertyFlags typeFlags = m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+    VkDeviceSize size = _requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(_requirements.alignment, 1);
+    if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+    {
+        // Flushed ranges are whole atoms, they must not spill over a neighbour that another thread may be writing.
+        alignment = std::max(alignment, m_nonCoherentAtomSize);
+        size = (size + m_nonCoherentAtomSize - 1) / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+    }
+
+    uint32_t poolIndex = memoryTypeIndex * 2 + (m_separateOptimal && _kind == ResourceKind::Optimal ? 1 : 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Pool& pool = m_pools[poolIndex];
+
+    MemoryAllocation allocation{};
+    allocation.pool = poolIndex;
+    allocation.size = size;
+
+    if (size > pool.blockSize / 2)
+    {
+        void* mapped = nullptr;
+        allocation.memory = AllocateMemory(memoryTypeIndex, size, &mapped);
+        if (allocation.memory == VK_NULL_HANDLE)
+            throw std::runtime_error("failed to allocate device memory");
+
+        allocation.mapped = mapped;
+        allocation.block = DEDICATED_BLOCK;
+        m_dedicatedCount++;
+        m_dedicatedSize += size;
+        return allocation;
+    }
+
+    for (uint32_t i = 0; i < pool.blocks.size(); i++)
+    {
+        Block& block = pool.blocks[i];
+        if (block.memory == VK_NULL_HANDLE)
+            continue;
+
+        uint64_t offset = block.allocator->Allocate(size, alignment);
+        if (offset != RangeAllocator::INVALID_OFFSET)
+        {
+            block.allocationCount++;
+            allocation.memory = block.memory;
+            allocation.offset = offset;
+            allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+            allocation.block = i;
+            return allocation;
+        }
+    }
+
+    Block block{};
+    block.memory = AllocateMemory(memoryTypeIndex, pool.blockSize, &block.mapped);
+    if (block.memory == VK_NULL_HANDLE)
+        throw std::runtime_error("failed to allocate device memory block");
+    block.allocator = std::make_unique<RangeAllocator>(pool.blockSize);
+    block.allocationCount = 1;
+
+    // Cannot fail, the range is at most half the block and offset 0 satisfies any alignment.
+    allocation.memory = block.memory;
+    allocation.offset = block.allocator->Allocate(size, alignment);
+    allocation.mapped = block.mapped;
+
+    auto freeSlot = std::find_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& _block) { return _block.memory == VK_NULL_HANDLE; });
+    allocation.block = static_cast<uint32_t>(freeSlot - pool.blocks.begin());
+    if (freeSlot != pool.blocks.end())
+        *freeSlot = std::move(block);
+    else
+        pool.blocks.push_back(std::move(block));
+
+    return allocation;
+}
+
+void MemoryAllocator::Free(MemoryAllocation& _allocation)
+{
+    if (_allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (_allocation.block == DEDICATED_BLOCK)
+    {
+        vkFreeMemory(m_device, _allocation.memory, nullptr);
+        m_dedicatedCount--;
+        m_dedicatedSize -= _allocation.size;
+        _allocation = {};
+        return;
+    }
+
+    Pool& pool = m_pools[_allocation.pool];
+    Block& block = pool.blocks[_allocation.block];
+    assert(block.memory == _allocation.memory && "Allocation does not belong to this block");
+
+    block.allocator->Free(_allocation.offset);
+    block.allocationCount--;
+
+    // One empty block is kept per pool so a resource recreated every frame does not allocate a block each time.
+    if (block.allocationCount == 0)
+    {
+        bool otherEmptyBlock = std::any_of(pool.blocks.begin(), pool.blocks.end(), [&](const Block& _other)
+            {
+                return &_other != &block && _other.memory != VK_NULL_HANDLE && _other.allocationCount == 0;
+            });
+        if (otherEmptyBlock)
+        {
+            vkFreeMemory(m_device, block.memory, nullptr);
+            block = {};
+        }
+    }
+
+    _allocation = {};
+}
+
+MemoryAllocator::Stats MemoryAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats stats{};
+    stats.reservedSize = m_dedicatedSize;
+    stats.usedSize = m_dedicatedSize;
+    stats.dedicatedCount = m_dedicatedCount;
+    stats.allocationCount = m_dedicatedCount;
+    for (const Pool& pool : m_pools)
+    {
+        for (const Block& block : pool.blocks)
+        {
+            if (block.memory == VK_NULL_HANDLE)
+                continue;
+
+            stats.blockCount++;
+            stats.reservedSize += block.allocator->GetSize();
+            stats.usedSize += block.allocator->GetUsedSize();
+            stats.allocationCount += block.allocationCount;
+        }
+    }
+    return stats;
+}
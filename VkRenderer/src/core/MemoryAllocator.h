@@ -0,0 +1,95 @@
+#pragma once
+#include "core/RangeAllocator.h"
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Range of device memory bound to one buffer or image. Several allocations share one VkDeviceMemory, so the memory
+// must never be freed, mapped or unmapped directly, only through the allocator.
+struct MemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Start of the range when the memory is host visible, null otherwise. Stays valid until the allocation is freed.
+    void* mapped = nullptr;
+
+    // Allocator bookkeeping.
+    uint32_t pool = 0;
+    uint32_t block = 0;
+};
+
+// Suballocates device memory out of large blocks instead of one vkAllocateMemory per resource: drivers cap the number
+// of live allocations (maxMemoryAllocationCount, 4096 on most) and each call is slow. Every memory type gets its own
+// blocks, carved with a RangeAllocator, and resources larger than half a block get their own memory.
+// Buffers and linear images never share a block with optimal images, which keeps them bufferImageGranularity apart
+// without padding every allocation. Host visible blocks are mapped once for their whole life.
+// Thread safe.
+class MemoryAllocator
+{
+public:
+    // Decides which resources may sit next to each other in a block, see bufferImageGranularity.
+    enum class ResourceKind
+    {
+        Linear,
+        Optimal
+    };
+
+    struct Stats
+    {
+        VkDeviceSize reservedSize = 0;
+        VkDeviceSize usedSize = 0;
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    MemoryAllocator(VkDevice _device, VkPhysicalDevice _physicalDevice);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    // Throws std::runtime_error when no memory type matches or the heap is exhausted.
+    MemoryAllocation Allocate(const VkMemoryRequirements& _requirements, VkMemoryPropertyFlags _properties, ResourceKind _kind);
+    // Resets _allocation, does nothing for an empty one. The resource bound to it must be destroyed first.
+    void Free(MemoryAllocation& _allocation);
+
+    Stats GetStats() const;
+
+private:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+    static constexpr uint32_t DEDICATED_BLOCK = ~0u;
+
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        std::unique_ptr<RangeAllocator> allocator;
+        uint32_t allocationCount = 0;
+    };
+
+    struct Pool
+    {
+        uint32_t memoryTypeIndex = 0;
+        VkDeviceSize blockSize = 0;
+        // Slots of released blocks stay empty so allocations keep their block index.
+        std::vector<Block> blocks{};
+    };
+
+    uint32_t FindMemoryType(uint32_t _typeFilter, VkMemoryPropertyFlags _properties) const;
+    // Null memory when the heap is exhausted.
+    VkDeviceMemory AllocateMemory(uint32_t _memoryTypeIndex, VkDeviceSize _size, void** _mapped);
+
+    VkDevice m_device;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_nonCoherentAtomSize = 1;
+    bool m_separateOptimal = true;
+
+    mutable std::mutex m_mutex;
+    // Indexed by memory type, then by ResourceKind when optimal images need their own blocks.
+    std::vector<Pool> m_pools{};
+    uint32_t m_dedicatedCount = 0;
+    VkDeviceSize m_dedicatedSize = 0;
+};
@@ -1,67 +1,50 @@
 #include "core/Pipeline.h"
 #include "core/Device.h"
+#include "core/PipelineCache.h"
 #include "model/Model.h"
-#include <fstream>
 #include <stdexcept>
 #include <iostream>
 #include <cassert>
 
-Pipeline::Pipeline(Device& _device, const std::string& _vertFilePath, const std::string& _fragFilePath, const PipelineConfigInfo& _configInfo) : m_device{ _device }
-{ 
-	CreateGraphicsPipeline(_vertFilePath, _fragFilePath, _configInfo);
-}
-
-Pipeline::~Pipeline()
+Pipeline::Pipeline(Device& _device) : m_device{ _device }
 {
-	vkDestroyShaderModule(m_device.GetDevice(), m_fragShaderModule,nullptr);
-	vkDestroyShaderModule(m_device.GetDevice(), m_vertShaderModule,nullptr);
-	vkDestroyPipeline(m_device.GetDevice(), m_graphicsPipeline, nullptr);
 }
 
-std::vector<char> Pipeline::ReadFile(const std::string& _filePath)
+Pipeline::~Pipeline()
 {
-	std::ifstream file(_filePath, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open())
-	{
-		throw std::runtime_error("failed to open file" + _filePath);
-	}
-
-	size_t fileSize = static_cast<size_t>(file.tellg());
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-
-	file.close();
-	return buffer;
+	if (m_pendingBuild.valid())
+		m_pendingBuild.wait();
 
+	vkDestroyPipeline(m_device.GetDevice(), m_graphicsPipeline, nullptr);
 }
 
-void Pipeline::CreateGraphicsPipeline(const std::string& _vertFilePath, const std::string& _fragFilePath, const PipelineConfigInfo& _configInfo)
+void Pipeline::Create(VkShaderModule _vertShaderModule, VkShaderModule _fragShaderModule, const PipelineConfigInfo& _configInfo)
 {
-	auto vertCode = ReadFile(_vertFilePath);
-	auto fragCode = ReadFile(_fragFilePath);
+	assert(!IsCreated() && "Pipeline already created");
 
-	CreateShaderModule(vertCode, &m_vertShaderModule);
-	CreateShaderModule(fragCode, &m_fragShaderModule);
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(_configInfo.specializationEntries.size());
+	specializationInfo.pMapEntries = _configInfo.specializationEntries.data();
+	specializationInfo.dataSize = _configInfo.specializationData.size();
+	specializationInfo.pData = _configInfo.specializationData.data();
+	const VkSpecializationInfo* stageSpecializationInfo = _configInfo.specializationEntries.empty() ? nullptr : &specializationInfo;
 
 	VkPipelineShaderStageCreateInfo shaderStages[2];
 	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	shaderStages[0].module = m_vertShaderModule;
+	shaderStages[0].module = _vertShaderModule;
 	shaderStages[0].pName = "main";
 	shaderStages[0].flags = 0;
 	shaderStages[0].pNext = nullptr;
-	shaderStages[0].pSpecializationInfo = nullptr;
+	shaderStages[0].pSpecializationInfo = stageSpecializationInfo;
 
 	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	shaderStages[1].module = m_fragShaderModule;
+	shaderStages[1].module = _fragShaderModule;
 	shaderStages[1].pName = "main";
 	shaderStages[1].flags = 0;
 	shaderStages[1].pNext = nullptr;
-	shaderStages[1].pSpecializationInfo = nullptr;
+	shaderStages[1].pSpecializationInfo = stageSpecializationInfo;
 
 
 	auto& bindingDescs = _configInfo.bindingDescriptions;
@@ -103,20 +86,11 @@ void Pipeline::CreateGraphicsPipeline(const std::string& _vertFilePath, const st
 	pipelineInfo.basePipelineIndex = -1;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-	if (vkCreateGraphicsPipelines(m_device.GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS)
+	if (m_device.GetPipelineCache().CreateGraphicsPipeline(pipelineInfo, &m_graphicsPipeline) != VK_SUCCESS)
 		throw std::runtime_error("failed to create graphics pipelines");
 
-}
-
-void Pipeline::CreateShaderModule(const std::vector<char>& _code, VkShaderModule* _shaderModule)
-{
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = _code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(_code.data());
+	m_created.store(true, std::memory_order_release);
 
-	if (vkCreateShaderModule(m_device.GetDevice(), &createInfo, nullptr, _shaderModule) != VK_SUCCESS)
-		throw std::runtime_error("failed to create shader module");
 }
 
 
@@ -216,7 +190,15 @@ void Pipeline::EnableFireParticleBlending(PipelineConfigInfo& _configInfo)
 	_configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 }
 
+Pipeline* Pipeline::GetReady()
+{
+	if (IsCreated())
+		return this;
+	return m_fallback ? m_fallback->GetReady() : nullptr;
+}
+
 void Pipeline::Bind(VkCommandBuffer _commandBuffer)
 {
+	assert(IsCreated() && "Pipeline bound before it was built");
 	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
 }
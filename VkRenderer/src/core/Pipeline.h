@@ -1,4 +1,7 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -23,6 +26,9 @@ struct PipelineConfigInfo
 	VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
 	std::vector<VkDynamicState> dynamicStateEnables;
 	VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+	// Given to both stages, a stage ignores the constants it does not declare. Filled by AddSpecializationConstant.
+	std::vector<VkSpecializationMapEntry> specializationEntries{};
+	std::vector<uint8_t> specializationData{};
 	VkPipelineLayout pipelineLayout = nullptr;
 	VkRenderPass renderPass = nullptr;
 	uint32_t subpass = 0;
@@ -32,30 +38,60 @@ class Pipeline
 {
 public:
 
-	Pipeline (Device& _device, const std::string& _vertFilePath, const std::string& _fragFilePath, const PipelineConfigInfo& _configInfo);
+	// Empty until Create, PipelineLibrary hands these out before PipelineBuildQueue builds them.
+	explicit Pipeline(Device& _device);
 	~Pipeline();
 
 	Pipeline(const Pipeline&) = delete;
 	Pipeline& operator =(const Pipeline&) = delete;
 
 	void Bind(VkCommandBuffer _commandBuffer);
+	// Thread safe for different pipelines. The modules belong to the caller and may be destroyed once this returns.
+	void Create(VkShaderModule _vertShaderModule, VkShaderModule _fragShaderModule, const PipelineConfigInfo& _configInfo);
+	// Thread safe, Create may run on a worker.
+	bool IsCreated() const { return m_created.load(std::memory_order_acquire); }
+	// Set by the build queue when Create or loading its shaders threw, the library then replaces the pipeline on the
+	// next request for it so the build is retried. Thread safe.
+	bool HasFailed() const { return m_failed.load(std::memory_order_acquire); }
+	void SetFailed() { m_failed.store(true, std::memory_order_release); }
+
+	// Drawn with instead while this one is still being created.
+	void SetFallback(Pipeline* _fallback) { m_fallback = _fallback; }
+	// This pipeline once created, else its fallback when that one is, else null and the draw is skipped. Thread safe.
+	Pipeline* GetReady();
+	// The destructor waits for it, the build writes into the pipeline.
+	void SetPendingBuild(std::future<void> _build) { m_pendingBuild = std::move(_build); }
 
 	static void DefaultPipelineConfigInfo(PipelineConfigInfo& _configInfo);
 	static void EnableAlphaBlending(PipelineConfigInfo& _configInfo);
 	static void EnableFireParticleBlending(PipelineConfigInfo& _configInfo);
+	// Sets the constant_id of the shaders, booleans as VkBool32.
+	template <typename T>
+	static void AddSpecializationConstant(PipelineConfigInfo& _configInfo, uint32_t _constantId, T _value)
+	{
+		static_assert(sizeof(T) == 4, "specialization constants are 32 bit");
 
-private:
-	static std::vector<char> ReadFile(const std::string& _filePath);
+		VkSpecializationMapEntry entry{};
+		entry.constantID = _constantId;
+		entry.offset = static_cast<uint32_t>(_configInfo.specializationData.size());
+		entry.size = sizeof(T);
+		_configInfo.specializationEntries.push_back(entry);
 
-	void CreateGraphicsPipeline(const std::string& _vertFilePath, const std::string& _fragFilePath, const PipelineConfigInfo& _configInfo);
-	void CreateShaderModule(const std::vector<char>& _code, VkShaderModule* _shaderModule);
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&_value);
+		_configInfo.specializationData.insert(_configInfo.specializationData.end(), bytes, bytes + sizeof(T));
+	}
+
+private:
 
 	Device& m_device;
 	//std::shared_ptr<Device> m_device;
 
-	VkPipeline m_graphicsPipeline;
-	VkShaderModule m_vertShaderModule;
-	VkShaderModule m_fragShaderModule;
+	VkPipeline m_graphicsPipeline = VK_NULL_HANDLE;
+
+	std::atomic<bool> m_created{ false };
+	std::atomic<bool> m_failed{ false };
+	Pipeline* m_fallback = nullptr;
+	std::future<void> m_pendingBuild;
 
 };
 
@@ -0,0 +1,144 @@
+#include "core/PipelineBuildQueue.h"
+#include "core/PipelineLibrary.h"
+#include "core/ThreadPool.h"
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+PipelineBuildQueue::PipelineBuildQueue(Device& _device) : m_device{ _device }, m_pendingCount{ std::make_shared<std::atomic<uint32_t>>(0) }
+{
+}
+
+PipelineConfigInfo& PipelineBuildQueue::Add(std::shared_ptr<Pipeline>& _pipeline, const std::string& _vertFilePath, const std::string& _fragFilePath, Pipeline* _fallback)
+{
+    auto request = std::make_shared<Request>();
+    request->vertFilePath = _vertFilePath;
+    request->fragFilePath = _fragFilePath;
+    request->slot = &_pipeline;
+    request->fallback = _fallback;
+    m_requests.push_back(std::move(request));
+    return m_requests.back()->config;
+}
+
+void PipelineBuildQueue::Resolve()
+{
+    PipelineLibrary& library = m_device.GetPipelineLibrary();
+
+    std::vector<std::shared_ptr<Request>> toCreate{};
+    for (std::shared_ptr<Request>& request : m_requests)
+    {
+        bool inserted = false;
+        *request->slot = library.FindOrInsert(request->config, request->vertFilePath, request->fragFilePath, inserted);
+        if (!inserted)
+            continue;
+
+        request->pipeline = request->slot->get();
+        request->pipeline->SetFallback(request->fallback);
+        toCreate.push_back(std::move(request));
+    }
+    m_requests = std::move(toCreate);
+}
+
+void PipelineBuildQueue::Build()
+{
+    if (m_requests.empty())
+        return;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t requestCount = m_requests.size();
+    Resolve();
+
+    PipelineLibrary& library = m_device.GetPipelineLibrary();
+    std::unordered_set<std::string> uniqueFiles{};
+    for (const auto& request : m_requests)
+    {
+        uniqueFiles.insert(request->vertFilePath);
+        uniqueFiles.insert(request->fragFilePath);
+    }
+    std::vector<std::string> shaderFiles(uniqueFiles.begin(), uniqueFiles.end());
+
+    // ParallelFor jobs must not throw, errors are kept and the first one is thrown once everything finished.
+    std::vector<std::exception_ptr> readErrors(shaderFiles.size());
+    ThreadPool& pool = ThreadPool::GetShared();
+    pool.ParallelFor(shaderFiles.size(), [&](size_t _i)
+        {
+            try
+            {
+                library.GetShaderModule(shaderFiles[_i]);
+            }
+            catch (...)
+            {
+                readErrors[_i] = std::current_exception();
+            }
+        });
+    for (const std::exception_ptr& error : readErrors)
+    {
+        if (error)
+        {
+            for (const auto& request : m_requests)
+            {
+                request->pipeline->SetFailed();
+            }
+            m_requests.clear();
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::vector<std::exception_ptr> buildErrors(m_requests.size());
+    pool.ParallelFor(m_requests.size(), [&](size_t _i)
+        {
+            const Request& request = *m_requests[_i];
+            try
+            {
+                request.pipeline->Create(library.GetShaderModule(request.vertFilePath), library.GetShaderModule(request.fragFilePath), request.config);
+            }
+            catch (...)
+            {
+                request.pipeline->SetFailed();
+                buildErrors[_i] = std::current_exception();
+            }
+        });
+
+    size_t pipelineCount = m_requests.size();
+    m_requests.clear();
+    for (const std::exception_ptr& error : buildErrors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Built " << pipelineCount << " pipelines for " << requestCount << " requests from " << shaderFiles.size() << " shader files in " << milliseconds << " ms" << std::endl;
+}
+
+void PipelineBuildQueue::BuildAsync()
+{
+    Resolve();
+
+    PipelineLibrary* library = &m_device.GetPipelineLibrary();
+    for (std::shared_ptr<Request>& request : m_requests)
+    {
+        m_pendingCount->fetch_add(1);
+        std::shared_ptr<std::atomic<uint32_t>> pendingCount = m_pendingCount;
+
+        // The pipeline waits for the job before it is destroyed, and the library destroys its pipelines before its
+        // modules. The request is kept alive by the job itself.
+        Pipeline* pipeline = request->pipeline;
+        pipeline->SetPendingBuild(ThreadPool::GetShared().Submit([request, pendingCount, library]()
+            {
+                try
+                {
+                    request->pipeline->Create(library->GetShaderModule(request->vertFilePath), library->GetShaderModule(request->fragFilePath), request->config);
+                }
+                catch (const std::exception& _error)
+                {
+                    request->pipeline->SetFailed();
+                    std::cout << "Pipeline build failed, " << request->vertFilePath << ": " << _error.what() << std::endl;
+                }
+                pendingCount->fetch_sub(1);
+            }));
+    }
+    m_requests.clear();
+}
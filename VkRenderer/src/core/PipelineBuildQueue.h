@@ -0,0 +1,59 @@
+#pragma once
+#include "core/Device.h"
+#include "core/Pipeline.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Collects the graphics pipelines of the systems while they are constructed, then Build creates them all at once on
+// the shared thread pool, against the device pipeline cache. Pipelines come from the device pipeline library, a config
+// that is already resident, or requested twice, is shared instead of built again, and shader modules are created
+// once each however many pipelines use them.
+// Pipelines needed once frames are running go through BuildAsync instead, which never blocks the frame.
+// Render thread only, the builds do the threading.
+class PipelineBuildQueue
+{
+public:
+    PipelineBuildQueue(Device& _device);
+
+    PipelineBuildQueue(const PipelineBuildQueue&) = delete;
+    PipelineBuildQueue& operator=(const PipelineBuildQueue&) = delete;
+
+    // _pipeline is assigned by Build or BuildAsync, which look the config up, so it must stay at the same address until
+    // then. Fill the returned config in place, DefaultPipelineConfigInfo points it into itself, it stays in the queue
+    // until the build.
+    // _fallback is drawn with until _pipeline is created, see Pipeline::GetReady. A shared pipeline keeps the fallback
+    // it was first requested with.
+    PipelineConfigInfo& Add(std::shared_ptr<Pipeline>& _pipeline, const std::string& _vertFilePath, const std::string& _fragFilePath, Pipeline* _fallback = nullptr);
+
+    // Blocks until every pipeline added so far is created. Throws std::runtime_error when a shader cannot be read or a
+    // pipeline fails, once all the jobs are done.
+    void Build();
+    // Starts a job per pipeline added so far and returns. A pipeline that fails is logged and stays on its fallback.
+    void BuildAsync();
+
+    // Asynchronous builds not finished yet.
+    uint32_t GetPendingCount() const { return m_pendingCount->load(); }
+
+private:
+    struct Request
+    {
+        std::string vertFilePath;
+        std::string fragFilePath;
+        PipelineConfigInfo config{};
+        std::shared_ptr<Pipeline>* slot = nullptr;
+        Pipeline* fallback = nullptr;
+        // Set by the lookup, null when the library already had the pipeline.
+        Pipeline* pipeline = nullptr;
+    };
+
+    // Assigns every slot and keeps only the requests whose pipeline has to be created.
+    void Resolve();
+
+    Device& m_device;
+    // Pointers, the configs must not move. Shared with the asynchronous jobs.
+    std::vector<std::shared_ptr<Request>> m_requests{};
+    // Shared with the jobs, which may outlive the queue.
+    std::shared_ptr<std::atomic<uint32_t>> m_pendingCount;
+};
@@ -0,0 +1,184 @@
+#include "core/PipelineCache.h"
+#include "core/Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+    const uint32_t PIPELINE_CACHE_MAGIC = 0x43505656; // "VVPC"
+
+    // Written before the driver data. The size and hash catch truncated or corrupted files, which some drivers crash on.
+    struct PipelineCacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t driverVersion;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    // Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE, at the start of the driver data.
+    struct DriverCacheHeader
+    {
+        uint32_t headerSize;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    };
+}
+
+PipelineCache::PipelineCache(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::string& _path) : m_device{ _device }, m_path{ _path }
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+    m_driverVersion = properties.driverVersion;
+
+    std::string data{};
+    m_warm = Load(properties, data);
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = m_warm ? data.size() : 0;
+    cacheInfo.pInitialData = m_warm ? data.data() : nullptr;
+
+    if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline cache");
+
+    std::cout << "Pipeline cache: " << (m_warm ? "warm, " + std::to_string(data.size() / 1024) + " KB loaded" : std::string("cold")) << std::endl;
+}
+
+PipelineCache::~PipelineCache()
+{
+    Save();
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+}
+
+bool PipelineCache::Load(const VkPhysicalDeviceProperties& _properties, std::string& _data) const
+{
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::string contents{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    if (contents.size() < sizeof(PipelineCacheFileHeader) + sizeof(DriverCacheHeader))
+        return false;
+
+    PipelineCacheFileHeader fileHeader{};
+    std::memcpy(&fileHeader, contents.data(), sizeof(fileHeader));
+    if (fileHeader.magic != PIPELINE_CACHE_MAGIC || fileHeader.driverVersion != _properties.driverVersion ||
+        fileHeader.dataSize != contents.size() - sizeof(fileHeader))
+    {
+        std::cout << "Pipeline cache: stale file, starting cold" << std::endl;
+        return false;
+    }
+
+    const char* data = contents.data() + sizeof(fileHeader);
+    if (Utils::HashBytes(data, fileHeader.dataSize) != fileHeader.dataHash)
+    {
+        std::cout << "Pipeline cache: corrupted file, starting cold" << std::endl;
+        return false;
+    }
+
+    DriverCacheHeader driverHeader{};
+    std::memcpy(&driverHeader, data, sizeof(driverHeader));
+    if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || driverHeader.vendorID != _properties.vendorID ||
+        driverHeader.deviceID != _properties.deviceID || std::memcmp(driverHeader.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        std::cout << "Pipeline cache: written by another device or driver, starting cold" << std::endl;
+        return false;
+    }
+
+    _data.assign(data, static_cast<size_t>(fileHeader.dataSize));
+    return true;
+}
+
+VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& _pipelineInfo, VkPipeline* _pipeline)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    VkResult result = vkCreateGraphicsPipelines(m_device, m_cache, 1, &_pipelineInfo, nullptr, _pipeline);
+    RecordCreation(start);
+    return result;
+}
+
+VkResult PipelineCache::CreateComputePipeline(const VkComputePipelineCreateInfo& _pipelineInfo, VkPipeline* _pipeline)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    VkResult result = vkCreateComputePipelines(m_device, m_cache, 1, &_pipelineInfo, nullptr, _pipeline);
+    RecordCreation(start);
+    return result;
+}
+
+void PipelineCache::RecordCreation(std::chrono::high_resolution_clock::time_point _start)
+{
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - _start).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_createdCount++;
+    m_creationTime += milliseconds;
+    m_longestCreationTime = std::max(m_longestCreationTime, milliseconds);
+}
+
+double PipelineCache::GetLongestCreationTime() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_longestCreationTime;
+}
+
+void PipelineCache::Save()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_createdCount == 0)
+            return;
+
+        std::cout << "Pipeline cache (" << (m_warm ? "warm" : "cold") << "): " << m_createdCount << " pipelines created in " << m_creationTime << " ms" << std::endl;
+        m_createdCount = 0;
+        m_creationTime = 0.0;
+    }
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return;
+    std::string data(size, '\0');
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS)
+        return;
+    data.resize(size);
+
+    PipelineCacheFileHeader fileHeader{};
+    fileHeader.magic = PIPELINE_CACHE_MAGIC;
+    fileHeader.driverVersion = m_driverVersion;
+    fileHeader.dataSize = data.size();
+    fileHeader.dataHash = Utils::HashBytes(data.data(), data.size());
+
+    std::error_code error{};
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), error);
+
+    // Written aside then renamed, a crash mid-write must not leave a truncated file behind.
+    std::string tempPath = m_path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "Could not write pipeline cache: " << m_path << std::endl;
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good())
+        {
+            file.close();
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(tempPath, m_path, error);
+    if (error)
+        std::filesystem::remove(tempPath, error);
+}
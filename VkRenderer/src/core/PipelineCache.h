@@ -0,0 +1,53 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Device wide VkPipelineCache, loaded from disk when the device is created and written back by Save and on
+// destruction. Data written by another vendor, device or driver is dropped and the cache starts cold, drivers do not
+// all reject it themselves.
+// Thread safe.
+class PipelineCache
+{
+public:
+    PipelineCache(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::string& _path = DEFAULT_PATH);
+    // Saves, the pipelines created from the cache may be destroyed already.
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    // Create through the cache and time the creation, Save logs it to compare cold and warm starts.
+    VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& _pipelineInfo, VkPipeline* _pipeline);
+    VkResult CreateComputePipeline(const VkComputePipelineCreateInfo& _pipelineInfo, VkPipeline* _pipeline);
+
+    // For pipelines created elsewhere, ImGui's for instance.
+    VkPipelineCache GetCache() const { return m_cache; }
+    // Whether valid data was loaded from disk.
+    bool IsWarm() const { return m_warm; }
+    // Slowest creation since startup, in milliseconds.
+    double GetLongestCreationTime() const;
+
+    // Writes the cache when pipelines were created since the last call and logs their creation time. Call it once
+    // startup created its pipelines, a crash later on then still keeps them.
+    void Save();
+
+private:
+    static constexpr const char* DEFAULT_PATH = "cache/pipeline_cache.bin";
+
+    bool Load(const VkPhysicalDeviceProperties& _properties, std::string& _data) const;
+    void RecordCreation(std::chrono::high_resolution_clock::time_point _start);
+
+    VkDevice m_device;
+    std::string m_path;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    bool m_warm = false;
+    uint32_t m_driverVersion = 0;
+
+    mutable std::mutex m_mutex;
+    uint32_t m_createdCount = 0;
+    double m_creationTime = 0.0;
+    double m_longestCreationTime = 0.0;
+};
@@ -0,0 +1,216 @@
+#include "core/PipelineLibrary.h"
+#include "core/ShaderCompiler.h"
+#include <stdexcept>
+
+namespace
+{
+    // Only for plain structs without padding, the Vulkan enums and flags are all 32 bits.
+    template <typename T>
+    void AppendValue(std::string& _key, const T& _value)
+    {
+        _key.append(reinterpret_cast<const char*>(&_value), sizeof(T));
+    }
+
+    template <typename T>
+    void AppendVector(std::string& _key, const std::vector<T>& _values)
+    {
+        AppendValue(_key, _values.size());
+        if (!_values.empty())
+            _key.append(reinterpret_cast<const char*>(_values.data()), _values.size() * sizeof(T));
+    }
+
+    void AppendString(std::string& _key, const std::string& _value)
+    {
+        AppendValue(_key, _value.size());
+        _key.append(_value);
+    }
+}
+
+PipelineLibrary::PipelineLibrary(Device& _device) : m_device{ _device }
+{
+}
+
+PipelineLibrary::~PipelineLibrary()
+{
+    m_pipelines.clear();
+
+    for (VkShaderModule shaderModule : m_createdShaderModules)
+    {
+        vkDestroyShaderModule(m_device.GetDevice(), shaderModule, nullptr);
+    }
+    for (const auto& [key, pipelineLayout] : m_pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(m_device.GetDevice(), pipelineLayout, nullptr);
+    }
+}
+
+std::string PipelineLibrary::MakeKey(const PipelineConfigInfo& _config, const std::string& _vertFilePath, const std::string& _fragFilePath)
+{
+    std::string key{};
+    key.reserve(512);
+    AppendString(key, _vertFilePath);
+    AppendString(key, _fragFilePath);
+
+    AppendVector(key, _config.bindingDescriptions);
+    AppendVector(key, _config.attributeDescriptions);
+
+    AppendValue(key, _config.inputAssemblyInfo.topology);
+    AppendValue(key, _config.inputAssemblyInfo.primitiveRestartEnable);
+
+    const VkPipelineRasterizationStateCreateInfo& rasterization = _config.rasterizationInfo;
+    AppendValue(key, rasterization.depthClampEnable);
+    AppendValue(key, rasterization.rasterizerDiscardEnable);
+    AppendValue(key, rasterization.polygonMode);
+    AppendValue(key, rasterization.cullMode);
+    AppendValue(key, rasterization.frontFace);
+    AppendValue(key, rasterization.depthBiasEnable);
+    AppendValue(key, rasterization.depthBiasConstantFactor);
+    AppendValue(key, rasterization.depthBiasClamp);
+    AppendValue(key, rasterization.depthBiasSlopeFactor);
+    AppendValue(key, rasterization.lineWidth);
+
+    const VkPipelineMultisampleStateCreateInfo& multisample = _config.multisampleInfo;
+    AppendValue(key, multisample.rasterizationSamples);
+    AppendValue(key, multisample.sampleShadingEnable);
+    AppendValue(key, multisample.minSampleShading);
+    AppendValue(key, multisample.alphaToCoverageEnable);
+    AppendValue(key, multisample.alphaToOneEnable);
+
+    AppendValue(key, _config.colorBlendAttachment);
+    AppendValue(key, _config.colorBlendInfo.logicOpEnable);
+    AppendValue(key, _config.colorBlendInfo.logicOp);
+    AppendValue(key, _config.colorBlendInfo.blendConstants);
+
+    const VkPipelineDepthStencilStateCreateInfo& depthStencil = _config.depthStencilInfo;
+    AppendValue(key, depthStencil.depthTestEnable);
+    AppendValue(key, depthStencil.depthWriteEnable);
+    AppendValue(key, depthStencil.depthCompareOp);
+    AppendValue(key, depthStencil.depthBoundsTestEnable);
+    AppendValue(key, depthStencil.stencilTestEnable);
+    AppendValue(key, depthStencil.front);
+    AppendValue(key, depthStencil.back);
+    AppendValue(key, depthStencil.minDepthBounds);
+    AppendValue(key, depthStencil.maxDepthBounds);
+
+    AppendVector(key, _config.dynamicStateEnables);
+    AppendValue(key, _config.specializationEntries.size());
+    for (const VkSpecializationMapEntry& entry : _config.specializationEntries)
+    {
+        AppendValue(key, entry.constantID);
+        AppendValue(key, entry.offset);
+        AppendValue(key, entry.size);
+    }
+    AppendVector(key, _config.specializationData);
+    AppendValue(key, _config.pipelineLayout);
+    AppendValue(key, _config.renderPass);
+    AppendValue(key, _config.subpass);
+    return key;
+}
+
+std::shared_ptr<Pipeline> PipelineLibrary::FindOrInsert(const PipelineConfigInfo& _config, const std::string& _vertFilePath, const std::string& _fragFilePath, bool& _inserted)
+{
+    std::string key = MakeKey(_config, _vertFilePath, _fragFilePath);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<Pipeline>& pipeline = m_pipelines[key];
+    // A failed build is dropped here rather than by the job that failed, which may hold the last reference.
+    _inserted = pipeline == nullptr || pipeline->HasFailed();
+    if (_inserted)
+        pipeline = std::make_shared<Pipeline>(m_device);
+    else
+        m_sharedCount++;
+    return pipeline;
+}
+
+VkShaderModule PipelineLibrary::GetShaderModule(const std::string& _filePath)
+{
+    std::promise<VkShaderModule> promise{};
+    std::shared_future<VkShaderModule> shaderModule{};
+    bool load = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto entry = m_shaderModules.find(_filePath);
+        if (entry != m_shaderModules.end())
+        {
+            shaderModule = entry->second;
+        }
+        else
+        {
+            shaderModule = promise.get_future().share();
+            m_shaderModules.emplace(_filePath, shaderModule);
+            load = true;
+        }
+    }
+
+    // Read outside of the lock, the other threads asking for the same file wait on the future.
+    if (load)
+    {
+        try
+        {
+            std::vector<char> code = ShaderCompiler::GetShared().LoadSpirv(_filePath);
+
+            VkShaderModuleCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            createInfo.codeSize = code.size();
+            createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+            VkShaderModule created = VK_NULL_HANDLE;
+            if (vkCreateShaderModule(m_device.GetDevice(), &createInfo, nullptr, &created) != VK_SUCCESS)
+                throw std::runtime_error("failed to create shader module " + _filePath);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_createdShaderModules.push_back(created);
+            }
+            promise.set_value(created);
+        }
+        catch (...)
+        {
+            // The threads already waiting get the error, the next request loads the file again.
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_shaderModules.erase(_filePath);
+            }
+            promise.set_exception(std::current_exception());
+        }
+    }
+
+    return shaderModule.get();
+}
+
+VkPipelineLayout PipelineLibrary::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& _setLayouts, const std::vector<VkPushConstantRange>& _pushConstantRanges)
+{
+    std::string key{};
+    AppendVector(key, _setLayouts);
+    AppendVector(key, _pushConstantRanges);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    VkPipelineLayout& pipelineLayout = m_pipelineLayouts[key];
+    if (pipelineLayout == VK_NULL_HANDLE)
+    {
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(_setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = _setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(_pushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = _pushConstantRanges.data();
+
+        if (vkCreatePipelineLayout(m_device.GetDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            m_pipelineLayouts.erase(key);
+            throw std::runtime_error("failed to create pipeline layout");
+        }
+    }
+    return pipelineLayout;
+}
+
+PipelineLibrary::Stats PipelineLibrary::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats{};
+    stats.pipelineCount = static_cast<uint32_t>(m_pipelines.size());
+    stats.sharedCount = m_sharedCount;
+    stats.shaderModuleCount = static_cast<uint32_t>(m_createdShaderModules.size());
+    stats.pipelineLayoutCount = static_cast<uint32_t>(m_pipelineLayouts.size());
+    return stats;
+}
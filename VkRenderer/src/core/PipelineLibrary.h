@@ -0,0 +1,62 @@
+#pragma once
+#include "core/Device.h"
+#include "core/Pipeline.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shares graphics pipelines, shader modules and pipeline layouts between every system. Pipelines are keyed by the bytes
+// of their config and their shader paths, shader modules by path, asking twice for the same one returns the same
+// pipeline. A shader edited on disk is not picked up until restart. Everything stays resident until the device is
+// destroyed.
+// Thread safe.
+class PipelineLibrary
+{
+public:
+    struct Stats
+    {
+        uint32_t pipelineCount = 0;
+        // Requests answered by a resident pipeline.
+        uint32_t sharedCount = 0;
+        uint32_t shaderModuleCount = 0;
+        uint32_t pipelineLayoutCount = 0;
+    };
+
+    PipelineLibrary(Device& _device);
+    // Waits for the builds still running.
+    ~PipelineLibrary();
+
+    PipelineLibrary(const PipelineLibrary&) = delete;
+    PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+
+    // The pipeline built from the same config and shaders, or a new empty one when there is none yet or its build
+    // failed. _inserted tells the caller it has to Create it.
+    std::shared_ptr<Pipeline> FindOrInsert(const PipelineConfigInfo& _config, const std::string& _vertFilePath, const std::string& _fragFilePath, bool& _inserted);
+
+    // Compiled or read and created on first use, once even when several threads ask at the same time, see
+    // ShaderCompiler. Throws std::runtime_error when the shader cannot be loaded, and loads it again on the next call.
+    VkShaderModule GetShaderModule(const std::string& _filePath);
+    VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& _setLayouts, const std::vector<VkPushConstantRange>& _pushConstantRanges);
+
+    Stats GetStats() const;
+
+    // Every field that ends up in the pipeline, the viewport and scissor excepted since they are dynamic.
+    static std::string MakeKey(const PipelineConfigInfo& _config, const std::string& _vertFilePath, const std::string& _fragFilePath);
+
+private:
+    Device& m_device;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Pipeline>> m_pipelines{};
+    std::unordered_map<std::string, std::shared_future<VkShaderModule>> m_shaderModules{};
+    // Only the modules whose creation succeeded, for the destructor.
+    std::vector<VkShaderModule> m_createdShaderModules{};
+    // Keyed by the set layout handles and push constant ranges.
+    std::unordered_map<std::string, VkPipelineLayout> m_pipelineLayouts{};
+    uint32_t m_sharedCount = 0;
+};
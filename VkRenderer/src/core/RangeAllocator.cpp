@@ -0,0 +1,253 @@
+#include "core/RangeAllocator.h"
+#include <cassert>
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    uint32_t FindLowestBit(uint64_t _mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, _mask);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(_mask));
+#endif
+    }
+
+    uint32_t FindHighestBit(uint64_t _mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, _mask);
+        return index;
+#else
+        return 63u - static_cast<uint32_t>(__builtin_clzll(_mask));
+#endif
+    }
+}
+
+RangeAllocator::RangeAllocator(uint64_t _size) : m_size{ _size }
+{
+    for (auto& lists : m_freeLists)
+    {
+        for (auto& head : lists)
+            head = NO_BLOCK;
+    }
+
+    if (m_size > 0)
+    {
+        uint32_t block = CreateBlock();
+        m_blocks[block].size = m_size;
+        InsertFreeBlock(block);
+    }
+}
+
+void RangeAllocator::Mapping(uint64_t _size, uint32_t& _fl, uint32_t& _sl)
+{
+    // Sizes below SL_COUNT get one exact class each, above that every power of two is split in SL_COUNT classes.
+    if (_size < SL_COUNT)
+    {
+        _fl = 0;
+        _sl = static_cast<uint32_t>(_size);
+        return;
+    }
+
+    uint32_t msb = FindHighestBit(_size);
+    _fl = msb - SL_BITS + 1;
+    _sl = static_cast<uint32_t>(_size >> (msb - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t RangeAllocator::FindFreeBlock(uint64_t _size) const
+{
+    // Round up to the next class boundary so any block of the class found is large enough.
+    if (_size >= SL_COUNT)
+    {
+        _size += (1ull << (FindHighestBit(_size) - SL_BITS)) - 1;
+    }
+
+    uint32_t fl, sl;
+    Mapping(_size, fl, sl);
+    if (fl >= FL_COUNT)
+        return NO_BLOCK;
+
+    uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        uint64_t flMap = fl + 1 < 64 ? m_flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0)
+            return NO_BLOCK;
+
+        fl = FindLowestBit(flMap);
+        slMap = m_slBitmaps[fl];
+    }
+
+    return m_freeLists[fl][FindLowestBit(slMap)];
+}
+
+void RangeAllocator::InsertFreeBlock(uint32_t _block)
+{
+    uint32_t fl, sl;
+    Mapping(m_blocks[_block].size, fl, sl);
+
+    Block& block = m_blocks[_block];
+    block.free = true;
+    block.prevFree = NO_BLOCK;
+    block.nextFree = m_freeLists[fl][sl];
+    if (block.nextFree != NO_BLOCK)
+        m_blocks[block.nextFree].prevFree = _block;
+
+    m_freeLists[fl][sl] = _block;
+    m_slBitmaps[fl] |= 1u << sl;
+    m_flBitmap |= 1ull << fl;
+    m_freeBlockCount++;
+}
+
+void RangeAllocator::RemoveFreeBlock(uint32_t _block)
+{
+    uint32_t fl, sl;
+    Mapping(m_blocks[_block].size, fl, sl);
+
+    Block& block = m_blocks[_block];
+    if (block.prevFree != NO_BLOCK)
+        m_blocks[block.prevFree].nextFree = block.nextFree;
+    else
+        m_freeLists[fl][sl] = block.nextFree;
+    if (block.nextFree != NO_BLOCK)
+        m_blocks[block.nextFree].prevFree = block.prevFree;
+
+    if (m_freeLists[fl][sl] == NO_BLOCK)
+    {
+        m_slBitmaps[fl] &= ~(1u << sl);
+        if (m_slBitmaps[fl] == 0)
+            m_flBitmap &= ~(1ull << fl);
+    }
+
+    block.free = false;
+    block.prevFree = NO_BLOCK;
+    block.nextFree = NO_BLOCK;
+    m_freeBlockCount--;
+}
+
+uint32_t RangeAllocator::CreateBlock()
+{
+    if (!m_unusedBlocks.empty())
+    {
+        uint32_t block = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+        m_blocks[block] = Block{};
+        return block;
+    }
+
+    m_blocks.push_back(Block{});
+    return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+uint32_t RangeAllocator::SplitFront(uint32_t _block, uint64_t _size)
+{
+    uint32_t front = CreateBlock();
+
+    Block& block = m_blocks[_block];
+    m_blocks[front].offset = block.offset;
+    m_blocks[front].size = _size;
+    m_blocks[front].prevPhysical = block.prevPhysical;
+    m_blocks[front].nextPhysical = _block;
+    if (block.prevPhysical != NO_BLOCK)
+        m_blocks[block.prevPhysical].nextPhysical = front;
+
+    block.offset += _size;
+    block.size -= _size;
+    block.prevPhysical = front;
+    return front;
+}
+
+void RangeAllocator::MergeWithNext(uint32_t _block)
+{
+    uint32_t next = m_blocks[_block].nextPhysical;
+
+    m_blocks[_block].size += m_blocks[next].size;
+    m_blocks[_block].nextPhysical = m_blocks[next].nextPhysical;
+    if (m_blocks[next].nextPhysical != NO_BLOCK)
+        m_blocks[m_blocks[next].nextPhysical].prevPhysical = _block;
+
+    m_unusedBlocks.push_back(next);
+}
+
+uint64_t RangeAllocator::Allocate(uint64_t _size, uint64_t _alignment)
+{
+    assert(_alignment > 0 && (_alignment & (_alignment - 1)) == 0 && "Alignment must be a power of two");
+    _size = _size > 0 ? _size : 1;
+
+    // Worst case padding, so whatever block comes back can be aligned.
+    uint32_t block = FindFreeBlock(_size + _alignment - 1);
+    if (block == NO_BLOCK)
+        return INVALID_OFFSET;
+
+    RemoveFreeBlock(block);
+
+    uint64_t padding = ((m_blocks[block].offset + _alignment - 1) & ~(_alignment - 1)) - m_blocks[block].offset;
+    if (padding > 0)
+    {
+        InsertFreeBlock(SplitFront(block, padding));
+    }
+
+    if (m_blocks[block].size > _size)
+    {
+        // The allocation keeps the front, the tail goes back to the free lists.
+        uint32_t used = SplitFront(block, _size);
+        InsertFreeBlock(block);
+        block = used;
+    }
+
+    m_usedSize += m_blocks[block].size;
+    m_allocations[m_blocks[block].offset] = block;
+    return m_blocks[block].offset;
+}
+
+void RangeAllocator::Free(uint64_t _offset)
+{
+    auto allocation = m_allocations.find(_offset);
+    if (allocation == m_allocations.end())
+        throw std::runtime_error("failed to free range, offset was not allocated");
+
+    uint32_t block = allocation->second;
+    m_allocations.erase(allocation);
+    m_usedSize -= m_blocks[block].size;
+
+    uint32_t next = m_blocks[block].nextPhysical;
+    if (next != NO_BLOCK && m_blocks[next].free)
+    {
+        RemoveFreeBlock(next);
+        MergeWithNext(block);
+    }
+
+    uint32_t prev = m_blocks[block].prevPhysical;
+    if (prev != NO_BLOCK && m_blocks[prev].free)
+    {
+        RemoveFreeBlock(prev);
+        MergeWithNext(prev);
+        block = prev;
+    }
+
+    InsertFreeBlock(block);
+}
+
+uint64_t RangeAllocator::GetLargestFreeBlockSize() const
+{
+    if (m_flBitmap == 0)
+        return 0;
+
+    // The largest block is in the highest non empty class, whose blocks only differ below the class granularity.
+    uint32_t fl = FindHighestBit(m_flBitmap);
+    uint32_t sl = FindHighestBit(m_slBitmaps[fl]);
+    uint64_t largestSize = 0;
+    for (uint32_t block = m_freeLists[fl][sl]; block != NO_BLOCK; block = m_blocks[block].nextFree)
+    {
+        if (m_blocks[block].size > largestSize)
+            largestSize = m_blocks[block].size;
+    }
+    return largestSize;
+}
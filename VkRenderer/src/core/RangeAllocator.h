@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Two level segregated fit (TLSF) allocator over an abstract [0, size) range, used to suballocate big GPU buffers.
+// Free blocks are binned by size class with one bitmap per level, so Allocate and Free run in constant time and
+// neighbouring free blocks merge back on Free. Offsets and sizes are in whatever unit the owner picks.
+class RangeAllocator
+{
+public:
+    static constexpr uint64_t INVALID_OFFSET = ~0ull;
+
+    explicit RangeAllocator(uint64_t _size);
+
+    RangeAllocator(const RangeAllocator&) = delete;
+    RangeAllocator& operator=(const RangeAllocator&) = delete;
+
+    // _alignment must be a power of two. Returns INVALID_OFFSET when no free block is large enough.
+    uint64_t Allocate(uint64_t _size, uint64_t _alignment = 1);
+    void Free(uint64_t _offset);
+
+    uint64_t GetSize() const { return m_size; }
+    uint64_t GetUsedSize() const { return m_usedSize; }
+    uint32_t GetFreeBlockCount() const { return m_freeBlockCount; }
+    uint64_t GetLargestFreeBlockSize() const;
+
+private:
+    static constexpr uint32_t SL_BITS = 5;
+    static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+    static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+    static constexpr uint32_t NO_BLOCK = ~0u;
+
+    struct Block
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t prevPhysical = NO_BLOCK;
+        uint32_t nextPhysical = NO_BLOCK;
+        uint32_t prevFree = NO_BLOCK;
+        uint32_t nextFree = NO_BLOCK;
+        bool free = false;
+    };
+
+    static void Mapping(uint64_t _size, uint32_t& _fl, uint32_t& _sl);
+    uint32_t FindFreeBlock(uint64_t _size) const;
+    void InsertFreeBlock(uint32_t _block);
+    void RemoveFreeBlock(uint32_t _block);
+    // Cuts [offset, offset + _size) off the front of _block into a new block, which is returned.
+    uint32_t SplitFront(uint32_t _block, uint64_t _size);
+    // Absorbs the physical successor of _block, both must be out of the free lists.
+    void MergeWithNext(uint32_t _block);
+    uint32_t CreateBlock();
+
+    std::vector<Block> m_blocks{};
+    std::vector<uint32_t> m_unusedBlocks{};
+    std::unordered_map<uint64_t, uint32_t> m_allocations{};
+
+    uint64_t m_flBitmap = 0;
+    uint32_t m_slBitmaps[FL_COUNT] = {};
+    uint32_t m_freeLists[FL_COUNT][SL_COUNT];
+
+    uint64_t m_size = 0;
+    uint64_t m_usedSize = 0;
+    uint32_t m_freeBlockCount = 0;
+};
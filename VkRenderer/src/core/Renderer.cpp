@@ -1,4 +1,7 @@
 #include "Renderer.h"
+#include "StagingRing.h"
+#include "DeletionQueue.h"
+#include "ThreadPool.h"
 #include <array>
 #include <cassert>
 #include <stdexcept>
@@ -22,7 +25,6 @@ void Renderer::RecreateSwapChain()
         extent = m_window.GetExtent();
         glfwWaitEvents();
     }
-    vkDeviceWaitIdle(m_device.GetDevice());
 
     if (m_swapChain == nullptr)
     {
@@ -35,29 +37,55 @@ void Renderer::RecreateSwapChain()
 
         if (!oldSwapChain->CompareSwapFormats(*m_swapChain.get())) 
             throw std::runtime_error("swap chain image(or depth) format has changed");
+
+        // The frames in flight still render into its images, the new swap chain took over their fences.
+        m_device.GetDeletionQueue().Push([oldSwapChain]() mutable { oldSwapChain.reset(); });
     }
 }
 
 void Renderer::CreateCommandBuffers() 
 {
-    m_commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    // One slot per worker of the shared pool, plus the render thread which takes part in ParallelFor.
+    const uint32_t slotCount = ThreadPool::GetShared().GetThreadCount() + 1;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_device.FindPhysicalQueueFamilies().graphicsFamily.value();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = m_device.GetCommandPool();
-    allocInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
+    for (FrameCommands& frame : m_frames)
+    {
+        frame.slots.resize(slotCount);
+        for (RecordingSlot& slot : frame.slots)
+        {
+            if (vkCreateCommandPool(m_device.GetDevice(), &poolInfo, nullptr, &slot.commandPool) != VK_SUCCESS)
+                throw std::runtime_error("failed to create frame command pool");
+        }
 
-    if (vkAllocateCommandBuffers(m_device.GetDevice(), &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) 
-        throw std::runtime_error("failed to allocate command buffers!");
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = frame.slots[0].commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(m_device.GetDevice(), &allocInfo, &frame.commandBuffer) != VK_SUCCESS) 
+            throw std::runtime_error("failed to allocate command buffers!");
+    }
 }
 
 
 void Renderer::FreeCommandBuffers() 
 {
-    vkFreeCommandBuffers(m_device.GetDevice(), m_device.GetCommandPool(), static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-
-    m_commandBuffers.clear();
+    // Destroying the pools frees their command buffers.
+    for (FrameCommands& frame : m_frames)
+    {
+        for (RecordingSlot& slot : frame.slots)
+        {
+            vkDestroyCommandPool(m_device.GetDevice(), slot.commandPool, nullptr);
+        }
+        frame.slots.clear();
+        frame.commandBuffer = VK_NULL_HANDLE;
+    }
 }
 
 VkCommandBuffer Renderer::BeginFrame()
@@ -76,10 +104,21 @@ VkCommandBuffer Renderer::BeginFrame()
         throw std::runtime_error("failed to aquire swap chain image");
 
     m_isFrameStarted = true;
+    // Acquiring waited on the fence of the last frame of this slot.
+    m_device.GetDeletionQueue().BeginFrame(m_currentFrameIndex);
+
+    // One reset per pool instead of one per command buffer.
+    for (RecordingSlot& slot : m_frames[m_currentFrameIndex].slots)
+    {
+        if (vkResetCommandPool(m_device.GetDevice(), slot.commandPool, 0) != VK_SUCCESS)
+            throw std::runtime_error("failed to reset frame command pool");
+        slot.usedCount = 0;
+    }
 
     auto commandBuffer = GetCurrentCommandBuffer();
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) 
         throw std::runtime_error("failed to begin recordind command buffer");
@@ -95,7 +134,12 @@ void Renderer::EndFrame()
         throw std::runtime_error("fiailed to record command buffer");
     
 
-    auto result = m_swapChain->SubmitCommandBuffers(&commandBuffer, &m_currentImageIndex);
+    // Uploads recorded while building the frame run before it.
+    m_device.GetStagingRing().Submit();
+    auto result = m_swapChain->SubmitCommandBuffers(&commandBuffer, &m_currentImageIndex, m_waitSemaphores, m_waitStages, m_signalSemaphores);
+    m_waitSemaphores.clear();
+    m_waitStages.clear();
+    m_signalSemaphores.clear();
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window.WasWindowResized())
     { 
@@ -111,7 +155,20 @@ void Renderer::EndFrame()
     m_currentFrameIndex = (m_currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void Renderer::BeginSwapChainRenderPass(VkCommandBuffer _commandBuffer)
+void Renderer::AddWaitSemaphore(VkSemaphore _semaphore, VkPipelineStageFlags _stage)
+{
+    assert(m_isFrameStarted && "Can't add a wait semaphore when frame not in progress");
+    m_waitSemaphores.push_back(_semaphore);
+    m_waitStages.push_back(_stage);
+}
+
+void Renderer::AddSignalSemaphore(VkSemaphore _semaphore)
+{
+    assert(m_isFrameStarted && "Can't add a signal semaphore when frame not in progress");
+    m_signalSemaphores.push_back(_semaphore);
+}
+
+void Renderer::BeginSwapChainRenderPass(VkCommandBuffer _commandBuffer, VkSubpassContents _contents)
 {
     assert(m_isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
     assert( _commandBuffer == GetCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
@@ -130,8 +187,15 @@ void Renderer::BeginSwapChainRenderPass(VkCommandBuffer _commandBuffer)
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(_commandBuffer, &renderPassInfo, _contents);
+
+    // Secondary command buffers do not inherit dynamic state, they set their own.
+    if (_contents == VK_SUBPASS_CONTENTS_INLINE)
+        SetViewportAndScissor(_commandBuffer);
+}
 
+void Renderer::SetViewportAndScissor(VkCommandBuffer _commandBuffer)
+{
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -152,4 +216,49 @@ void Renderer::EndSwapChainRenderPass(VkCommandBuffer _commandBuffer)
     assert(_commandBuffer == GetCurrentCommandBuffer() && "Can't end render pass on command buffer from a different frame");
 
     vkCmdEndRenderPass(_commandBuffer);
-}
\ No newline at end of file
+}
+
+VkCommandBuffer Renderer::BeginSecondaryCommandBuffer(uint32_t _slot)
+{
+    assert(m_isFrameStarted && "Can't begin a secondary command buffer when frame not in progress");
+    assert(_slot < GetRecordingSlotCount() && "Recording slot out of range");
+
+    RecordingSlot& slot = m_frames[m_currentFrameIndex].slots[_slot];
+    if (slot.usedCount == slot.secondaryCommandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool = slot.commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(m_device.GetDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate secondary command buffer");
+        slot.secondaryCommandBuffers.push_back(commandBuffer);
+    }
+    VkCommandBuffer commandBuffer = slot.secondaryCommandBuffers[slot.usedCount++];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = m_swapChain->GetRenderPass();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = m_swapChain->GetFrameBuffer(m_currentImageIndex);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin secondary command buffer");
+
+    SetViewportAndScissor(commandBuffer);
+    return commandBuffer;
+}
+
+void Renderer::EndSecondaryCommandBuffer(VkCommandBuffer _commandBuffer)
+{
+    if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to record secondary command buffer");
+}
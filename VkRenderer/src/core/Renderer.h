@@ -3,6 +3,7 @@
 #include "core/Device.h"
 #include "core/SwapChain.h"
 #include <vulkan/vulkan.h>
+#include <array>
 #include <cassert>
 #include <memory>
 #include <vector>
@@ -19,11 +20,12 @@ public:
     VkRenderPass GetSwapChainRenderPass() const { return m_swapChain->GetRenderPass(); }
     bool IsFrameInProgress() const { return m_isFrameStarted; }
     float GetAspectRatio() const { return m_swapChain->GetExtentAspectRatio(); };
+    VkExtent2D GetSwapChainExtent() const { return m_swapChain->GetSwapChainExtent(); }
 
     VkCommandBuffer GetCurrentCommandBuffer() const 
     {
         assert(m_isFrameStarted && "Cannot get command buffer when frame not in progress");
-        return m_commandBuffers[m_currentFrameIndex];
+        return m_frames[m_currentFrameIndex].commandBuffer;
     }
 
     int GetFrameIndex() const 
@@ -33,23 +35,53 @@ public:
     }
 
     VkCommandBuffer BeginFrame();
+    // Only for the frame in progress, the submission of EndFrame waits on or signals the semaphore.
+    void AddWaitSemaphore(VkSemaphore _semaphore, VkPipelineStageFlags _stage);
+    void AddSignalSemaphore(VkSemaphore _semaphore);
 
     void EndFrame();
-    void BeginSwapChainRenderPass(VkCommandBuffer _commandBuffer);
+    // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS every command of the pass goes through secondary command buffers.
+    void BeginSwapChainRenderPass(VkCommandBuffer _commandBuffer, VkSubpassContents _contents = VK_SUBPASS_CONTENTS_INLINE);
     void EndSwapChainRenderPass(VkCommandBuffer _commandBuffer);
+
+    // Each frame records from one command pool per slot, all reset when the frame begins. A slot must only be used by
+    // one thread at a time, slot 0 also holds the primary command buffer and belongs to the render thread.
+    uint32_t GetRecordingSlotCount() const { return static_cast<uint32_t>(m_frames[0].slots.size()); }
+    // Continues the swap chain render pass, with the viewport and scissor set. Between BeginSwapChainRenderPass and
+    // EndSwapChainRenderPass, the primary command buffer then executes it.
+    VkCommandBuffer BeginSecondaryCommandBuffer(uint32_t _slot);
+    void EndSecondaryCommandBuffer(VkCommandBuffer _commandBuffer);
     VkSampleCountFlagBits GetMsaaSamples() const { return m_swapChain->GetMsaaSamples(); }
 
 private:
+    struct RecordingSlot
+    {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        // Kept across frames, the pool reset returns them to the initial state.
+        std::vector<VkCommandBuffer> secondaryCommandBuffers{};
+        uint32_t usedCount = 0;
+    };
+
+    struct FrameCommands
+    {
+        std::vector<RecordingSlot> slots{};
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
     void CreateCommandBuffers();
     void FreeCommandBuffers();
     void RecreateSwapChain();
+    void SetViewportAndScissor(VkCommandBuffer _commandBuffer);
 
     Window& m_window;
     Device& m_device;
 
 
     std::unique_ptr<SwapChain> m_swapChain;
-    std::vector<VkCommandBuffer> m_commandBuffers;
+    std::array<FrameCommands, SwapChain::MAX_FRAMES_IN_FLIGHT> m_frames{};
+    std::vector<VkSemaphore> m_waitSemaphores;
+    std::vector<VkPipelineStageFlags> m_waitStages;
+    std::vector<VkSemaphore> m_signalSemaphores;
 
     uint32_t m_currentImageIndex;
     int m_currentFrameIndex;
@@ -0,0 +1,350 @@
+#include "core/ShaderCompiler.h"
+#include "core/Utils.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace
+{
+    const uint32_t SPIRV_CACHE_MAGIC = 0x43565053; // "SPVC"
+    // Bumped when the cache file layout or the way the key is built changes.
+    const uint32_t SPIRV_CACHE_VERSION = 2;
+
+    // Compile options, hashed into the cache key along with the compiler identity.
+    const shaderc_target_env TARGET_ENV = shaderc_target_env_vulkan;
+    const shaderc_env_version TARGET_ENV_VERSION = shaderc_env_version_vulkan_1_0;
+    const shaderc_optimization_level OPTIMIZATION_LEVEL = shaderc_optimization_level_performance;
+
+    // Written before the SPIR-V, the size and hash catch truncated or corrupted files.
+    struct SpirvCacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    struct ShaderStage
+    {
+        const char* suffix;
+        const char* extension;
+        shaderc_shader_kind kind;
+    };
+
+    // Naming used by compile.bat.
+    const ShaderStage SHADER_STAGES[] = {
+        { "_vert.spv", ".vert", shaderc_vertex_shader },
+        { "_frag.spv", ".frag", shaderc_fragment_shader },
+        { "_comp.spv", ".comp", shaderc_compute_shader },
+    };
+
+    // Empty when the binary has no source to compile from.
+    std::string FindSource(const std::string& _spirvPath, shaderc_shader_kind& _kind)
+    {
+        for (const ShaderStage& stage : SHADER_STAGES)
+        {
+            std::string suffix = stage.suffix;
+            if (_spirvPath.size() <= suffix.size() || _spirvPath.compare(_spirvPath.size() - suffix.size(), suffix.size(), suffix) != 0)
+                continue;
+
+            std::string sourcePath = _spirvPath.substr(0, _spirvPath.size() - suffix.size()) + stage.extension;
+            if (!std::filesystem::exists(sourcePath))
+                return {};
+
+            _kind = stage.kind;
+            return sourcePath;
+        }
+        return {};
+    }
+
+    bool ReadText(const std::string& _path, std::string& _text)
+    {
+        std::ifstream file(_path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        std::ostringstream stream{};
+        stream << file.rdbuf();
+        _text = stream.str();
+        return true;
+    }
+
+    // The shaderc library the process loaded, or the executable when it is linked in statically. Empty when unknown.
+    std::string GetCompilerLibraryPath()
+    {
+#ifdef _WIN32
+        HMODULE module = GetModuleHandleA("shaderc_shared.dll");
+        char path[MAX_PATH];
+        DWORD length = GetModuleFileNameA(module, path, MAX_PATH);
+        return length > 0 && length < MAX_PATH ? std::string(path, length) : std::string{};
+#else
+        Dl_info info{};
+        if (dladdr(reinterpret_cast<void*>(&shaderc_compiler_initialize), &info) == 0 || !info.dli_fname)
+            return {};
+        return info.dli_fname;
+#endif
+    }
+
+    // shaderc only reports the SPIR-V version it emits, which an SDK update changing the code generation keeps. The
+    // size and modification time of the loaded library tell its builds apart.
+    uint64_t HashCompilerIdentity()
+    {
+        unsigned int spirvVersion = 0;
+        unsigned int spirvRevision = 0;
+        shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+
+        uint64_t hash = Utils::HashBytes(&spirvVersion, sizeof(spirvVersion));
+        hash = Utils::HashBytes(&spirvRevision, sizeof(spirvRevision), hash);
+
+        std::string libraryPath = GetCompilerLibraryPath();
+        std::error_code error{};
+        uint64_t librarySize = libraryPath.empty() ? 0 : std::filesystem::file_size(libraryPath, error);
+        auto libraryTime = libraryPath.empty() ? 0 : std::filesystem::last_write_time(libraryPath, error).time_since_epoch().count();
+        hash = Utils::HashBytes(libraryPath.data(), libraryPath.size(), hash);
+        hash = Utils::HashBytes(&librarySize, sizeof(librarySize), hash);
+        hash = Utils::HashBytes(&libraryTime, sizeof(libraryTime), hash);
+        return hash;
+    }
+
+    std::string ResolveInclude(const std::string& _requestingPath, const std::string& _requestedPath)
+    {
+        return (std::filesystem::path(_requestingPath).parent_path() / _requestedPath).generic_string();
+    }
+
+    // Hashes the files the source includes, recursively. Scans for #include lines rather than preprocessing, an
+    // include behind an #if is hashed whether it is used or not, which only costs a spurious recompile.
+    void HashIncludes(uint64_t& _hash, const std::string& _path, const std::string& _source, std::unordered_set<std::string>& _visited)
+    {
+        std::istringstream lines(_source);
+        std::string line{};
+        while (std::getline(lines, line))
+        {
+            size_t directive = line.find_first_not_of(" \t");
+            if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+                continue;
+
+            size_t open = line.find('"', directive);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (close == std::string::npos)
+                continue;
+
+            std::string includePath = ResolveInclude(_path, line.substr(open + 1, close - open - 1));
+            if (!_visited.insert(includePath).second)
+                continue;
+
+            std::string include{};
+            ReadText(includePath, include);
+            _hash = Utils::HashBytes(includePath.data(), includePath.size(), _hash);
+            _hash = Utils::HashBytes(include.data(), include.size(), _hash);
+            HashIncludes(_hash, includePath, include, _visited);
+        }
+    }
+
+    struct IncludeResult
+    {
+        std::string sourceName;
+        std::string content;
+        shaderc_include_result result;
+    };
+
+    shaderc_include_result* ResolveIncludeCallback(void* _userData, const char* _requestedSource, int _type, const char* _requestingSource, size_t _includeDepth)
+    {
+        auto* include = new IncludeResult{};
+        std::string path = ResolveInclude(_requestingSource, _requestedSource);
+        if (ReadText(path, include->content))
+            include->sourceName = path;
+        else
+            include->content = "cannot open include " + path;
+
+        // An empty source name tells shaderc the include failed, the content is then the error.
+        include->result.source_name = include->sourceName.data();
+        include->result.source_name_length = include->sourceName.size();
+        include->result.content = include->content.data();
+        include->result.content_length = include->content.size();
+        include->result.user_data = include;
+        return &include->result;
+    }
+
+    void ReleaseIncludeCallback(void* _userData, shaderc_include_result* _result)
+    {
+        delete static_cast<IncludeResult*>(_result->user_data);
+    }
+}
+
+ShaderCompiler::ShaderCompiler(const std::string& _cacheDirectory) : m_cacheDirectory{ _cacheDirectory }
+{
+    m_compiler = shaderc_compiler_initialize();
+    if (!m_compiler)
+        throw std::runtime_error("failed to initialize shader compiler");
+
+    m_compilerKey = HashCompilerIdentity();
+    m_compilerKey = Utils::HashBytes(&TARGET_ENV, sizeof(TARGET_ENV), m_compilerKey);
+    m_compilerKey = Utils::HashBytes(&TARGET_ENV_VERSION, sizeof(TARGET_ENV_VERSION), m_compilerKey);
+    m_compilerKey = Utils::HashBytes(&OPTIMIZATION_LEVEL, sizeof(OPTIMIZATION_LEVEL), m_compilerKey);
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+    shaderc_compiler_release(m_compiler);
+}
+
+ShaderCompiler& ShaderCompiler::GetShared()
+{
+    static ShaderCompiler compiler{};
+    return compiler;
+}
+
+bool ShaderCompiler::Exists(const std::string& _spirvPath)
+{
+    shaderc_shader_kind kind{};
+    return !FindSource(_spirvPath, kind).empty() || std::filesystem::exists(_spirvPath);
+}
+
+std::vector<char> ShaderCompiler::LoadSpirv(const std::string& _spirvPath, const Defines& _defines)
+{
+    shaderc_shader_kind kind{};
+    std::string sourcePath = FindSource(_spirvPath, kind);
+    std::string source{};
+    if (sourcePath.empty() || !ReadText(sourcePath, source))
+        return Utils::ReadFile(_spirvPath);
+
+    uint64_t key = Utils::HashBytes(&SPIRV_CACHE_VERSION, sizeof(SPIRV_CACHE_VERSION));
+    key = Utils::HashBytes(&m_compilerKey, sizeof(m_compilerKey), key);
+    key = Utils::HashBytes(&kind, sizeof(kind), key);
+    key = Utils::HashBytes(source.data(), source.size(), key);
+    std::unordered_set<std::string> visited{};
+    HashIncludes(key, sourcePath, source, visited);
+    for (const auto& [name, value] : _defines)
+    {
+        key = Utils::HashBytes(name.data(), name.size() + 1, key);
+        key = Utils::HashBytes(value.data(), value.size() + 1, key);
+    }
+
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "%016llx.spv", static_cast<unsigned long long>(key));
+    std::string cachePath = m_cacheDirectory + "/" + fileName;
+
+    std::vector<char> spirv{};
+    if (LoadCached(cachePath, key, spirv))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.cachedCount++;
+        return spirv;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    spirv = Compile(sourcePath, source, kind, _defines);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    SaveCached(cachePath, key, spirv);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.compiledCount++;
+        m_stats.compileTime += milliseconds;
+    }
+    return spirv;
+}
+
+std::vector<char> ShaderCompiler::Compile(const std::string& _sourcePath, const std::string& _source, shaderc_shader_kind _kind, const Defines& _defines)
+{
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_target_env(options, TARGET_ENV, TARGET_ENV_VERSION);
+    shaderc_compile_options_set_optimization_level(options, OPTIMIZATION_LEVEL);
+    shaderc_compile_options_set_include_callbacks(options, ResolveIncludeCallback, ReleaseIncludeCallback, nullptr);
+    for (const auto& [name, value] : _defines)
+    {
+        shaderc_compile_options_add_macro_definition(options, name.data(), name.size(), value.data(), value.size());
+    }
+
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(m_compiler, _source.data(), _source.size(), _kind, _sourcePath.c_str(), "main", options);
+    shaderc_compile_options_release(options);
+
+    if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
+    {
+        std::string message = shaderc_result_get_error_message(result);
+        shaderc_result_release(result);
+        throw std::runtime_error("failed to compile shader " + _sourcePath + "\n" + message);
+    }
+
+    const char* bytes = shaderc_result_get_bytes(result);
+    std::vector<char> spirv(bytes, bytes + shaderc_result_get_length(result));
+    shaderc_result_release(result);
+    return spirv;
+}
+
+bool ShaderCompiler::LoadCached(const std::string& _path, uint64_t _key, std::vector<char>& _spirv) const
+{
+    std::ifstream file(_path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    SpirvCacheFileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (header.magic != SPIRV_CACHE_MAGIC || header.version != SPIRV_CACHE_VERSION || header.key != _key || header.dataSize == 0 || header.dataSize % 4 != 0)
+        return false;
+
+    _spirv.resize(static_cast<size_t>(header.dataSize));
+    if (!file.read(_spirv.data(), static_cast<std::streamsize>(_spirv.size())))
+        return false;
+    return Utils::HashBytes(_spirv.data(), _spirv.size()) == header.dataHash;
+}
+
+void ShaderCompiler::SaveCached(const std::string& _path, uint64_t _key, const std::vector<char>& _spirv) const
+{
+    SpirvCacheFileHeader header{};
+    header.magic = SPIRV_CACHE_MAGIC;
+    header.version = SPIRV_CACHE_VERSION;
+    header.key = _key;
+    header.dataSize = _spirv.size();
+    header.dataHash = Utils::HashBytes(_spirv.data(), _spirv.size());
+
+    std::error_code error{};
+    std::filesystem::create_directories(m_cacheDirectory, error);
+
+    // Written aside then renamed, as the pipeline cache. Per thread, two threads may compile the same source.
+    std::string tempPath = _path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "Could not write shader cache: " << _path << std::endl;
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(_spirv.data(), static_cast<std::streamsize>(_spirv.size()));
+        if (!file.good())
+        {
+            file.close();
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(tempPath, _path, error);
+    if (error)
+        std::filesystem::remove(tempPath, error);
+}
+
+ShaderCompiler::Stats ShaderCompiler::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
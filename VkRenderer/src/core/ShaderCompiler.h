@@ -0,0 +1,58 @@
+#pragma once
+#include <shaderc/shaderc.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Compiles the GLSL sources next to the shader binaries with shaderc when they are loaded, so editing a shader needs no
+// offline step. #include "file" is resolved relative to the including file.
+// The SPIR-V is cached in cache/shaders, keyed by a hash of the source, its includes, the defines, the compile options
+// and the loaded shaderc library file, so a warm start reads it back without compiling anything. Shaders shipped without their source load the
+// prebuilt binary.
+// Thread safe, compilations run in parallel on the calling threads.
+class ShaderCompiler
+{
+public:
+    using Defines = std::vector<std::pair<std::string, std::string>>;
+
+    struct Stats
+    {
+        uint32_t compiledCount = 0;
+        uint32_t cachedCount = 0;
+        double compileTime = 0.0;
+    };
+
+    ShaderCompiler(const std::string& _cacheDirectory = "cache/shaders");
+    ~ShaderCompiler();
+
+    ShaderCompiler(const ShaderCompiler&) = delete;
+    ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+    // Process wide compiler, shared by every pipeline.
+    static ShaderCompiler& GetShared();
+
+    // _spirvPath is the binary compile.bat writes, shaders/name_frag.spv for shaders/name.frag. Throws
+    // std::runtime_error with the compiler log when the source does not compile, or when there is neither a source
+    // nor a binary.
+    std::vector<char> LoadSpirv(const std::string& _spirvPath, const Defines& _defines = {});
+    // The source or the binary.
+    static bool Exists(const std::string& _spirvPath);
+
+    Stats GetStats() const;
+
+private:
+    std::vector<char> Compile(const std::string& _sourcePath, const std::string& _source, shaderc_shader_kind _kind, const Defines& _defines);
+    bool LoadCached(const std::string& _path, uint64_t _key, std::vector<char>& _spirv) const;
+    void SaveCached(const std::string& _path, uint64_t _key, const std::vector<char>& _spirv) const;
+
+    // shaderc compilers may be used from several threads at once, options are created per compilation.
+    shaderc_compiler_t m_compiler = nullptr;
+    // Compiler build and compile options, the part of the cache key shared by every shader.
+    uint64_t m_compilerKey = 0;
+    std::string m_cacheDirectory;
+
+    mutable std::mutex m_mutex;
+    Stats m_stats{};
+};
@@ -0,0 +1,387 @@
+#include "core/StagingRing.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+StagingRing::StagingRing(Device& _device, VkDeviceSize _size) : m_device{ _device }, m_size{ _size }
+{
+    m_buffer = std::make_unique<Buffer>(m_device, m_size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_buffer->Map();
+
+    QueueFamilyIndices indices = m_device.FindPhysicalQueueFamilies();
+    m_graphicsFamily = indices.graphicsFamily.value();
+    m_transferFamily = indices.transferFamily.value();
+    m_graphicsQueue = m_device.GetGraphicsQueue();
+    m_transferQueue = m_device.GetTransferQueue();
+
+    if (HasSeparateTransferQueue())
+    {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = m_transferFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        if (vkCreateCommandPool(m_device.GetDevice(), &poolInfo, nullptr, &m_transferCommandPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create transfer command pool");
+    }
+
+    for (Batch& batch : m_batches)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_device.GetCommandPool();
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(m_device.GetDevice(), &allocInfo, &batch.commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate staging command buffer");
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_device.GetDevice(), &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS)
+            throw std::runtime_error("failed to create staging fence");
+
+        if (!HasSeparateTransferQueue())
+        {
+            batch.transferCommandBuffer = batch.commandBuffer;
+            continue;
+        }
+
+        allocInfo.commandPool = m_transferCommandPool;
+        if (vkAllocateCommandBuffers(m_device.GetDevice(), &allocInfo, &batch.transferCommandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate transfer command buffer");
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateFence(m_device.GetDevice(), &fenceInfo, nullptr, &batch.transferFence) != VK_SUCCESS ||
+            vkCreateSemaphore(m_device.GetDevice(), &semaphoreInfo, nullptr, &batch.transferSemaphore) != VK_SUCCESS)
+            throw std::runtime_error("failed to create transfer synchronization objects");
+    }
+}
+
+StagingRing::~StagingRing()
+{
+    Flush();
+    for (Batch& batch : m_batches)
+    {
+        vkFreeCommandBuffers(m_device.GetDevice(), m_device.GetCommandPool(), 1, &batch.commandBuffer);
+        vkDestroyFence(m_device.GetDevice(), batch.fence, nullptr);
+        if (HasSeparateTransferQueue())
+        {
+            vkDestroyFence(m_device.GetDevice(), batch.transferFence, nullptr);
+            vkDestroySemaphore(m_device.GetDevice(), batch.transferSemaphore, nullptr);
+        }
+    }
+
+    // Also frees the transfer command buffers.
+    if (m_transferCommandPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(m_device.GetDevice(), m_transferCommandPool, nullptr);
+}
+
+bool StagingRing::TryReserve(VkDeviceSize _size, VkDeviceSize _alignment, VkDeviceSize& _offset)
+{
+    // Nothing in flight, start over at the beginning so a range as large as the ring fits.
+    const Batch& oldest = m_batches[m_oldestBatch];
+    if (m_head == m_tail && !oldest.transferring && !oldest.submitted)
+    {
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    uint64_t position = (m_head + _alignment - 1) & ~(_alignment - 1);
+    VkDeviceSize offset = position % m_size;
+    // Ranges never wrap, the end of the buffer is skipped instead.
+    if (offset + _size > m_size)
+    {
+        position += m_size - offset;
+        offset = 0;
+    }
+
+    if (position + _size - m_tail > m_size)
+        return false;
+
+    m_head = position + _size;
+    _offset = offset;
+    return true;
+}
+
+StagingRing::Allocation StagingRing::Allocate(VkDeviceSize _size, VkDeviceSize _alignment)
+{
+    if (_size > m_size)
+    {
+        auto buffer = std::make_unique<Buffer>(m_device, _size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        buffer->Map();
+
+        Allocation allocation{ buffer->GetMappedMemory(), buffer->GetBuffer(), 0 };
+        GetCommandBuffer();
+        m_batches[m_currentBatch].oversizedBuffers.push_back(std::move(buffer));
+        return allocation;
+    }
+
+    Reclaim(false);
+
+    VkDeviceSize offset = 0;
+    while (!TryReserve(_size, _alignment, offset))
+    {
+        // The space only comes back once the batches holding it have run.
+        Submit();
+        Reclaim(true);
+    }
+
+    GetCommandBuffer();
+    return { static_cast<char*>(m_buffer->GetMappedMemory()) + offset, m_buffer->GetBuffer(), offset };
+}
+
+void StagingRing::UploadToBuffer(VkBuffer _destination, VkDeviceSize _destinationOffset, const void* _data, VkDeviceSize _size)
+{
+    // Quarter ring chunks keep large uploads flowing while earlier chunks are still being copied.
+    const char* source = static_cast<const char*>(_data);
+    while (_size > 0)
+    {
+        VkDeviceSize chunkSize = std::min(_size, m_size / 4);
+        Allocation allocation = Allocate(chunkSize);
+        std::memcpy(allocation.data, source, static_cast<size_t>(chunkSize));
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = allocation.offset;
+        copyRegion.dstOffset = _destinationOffset;
+        copyRegion.size = chunkSize;
+        vkCmdCopyBuffer(GetTransferCommandBuffer(), allocation.buffer, _destination, 1, &copyRegion);
+        TransferBufferOwnership(_destination, _destinationOffset, chunkSize);
+
+        source += chunkSize;
+        _destinationOffset += chunkSize;
+        _size -= chunkSize;
+    }
+}
+
+VkCommandBuffer StagingRing::GetTransferCommandBuffer()
+{
+    if (!m_batches[m_currentBatch].recording)
+        BeginBatch();
+    return m_batches[m_currentBatch].transferCommandBuffer;
+}
+
+VkCommandBuffer StagingRing::GetCommandBuffer()
+{
+    if (!m_batches[m_currentBatch].recording)
+        BeginBatch();
+    return m_batches[m_currentBatch].commandBuffer;
+}
+
+void StagingRing::TransferBufferOwnership(VkBuffer _buffer, VkDeviceSize _offset, VkDeviceSize _size)
+{
+    if (m_transferFamily == m_graphicsFamily)
+        return;
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = m_transferFamily;
+    barrier.dstQueueFamilyIndex = m_graphicsFamily;
+    barrier.buffer = _buffer;
+    barrier.offset = _offset;
+    barrier.size = _size;
+
+    // The release ignores the destination scope and the acquire the source one, which the semaphore wait covers.
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(GetTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void StagingRing::TransferImageOwnership(VkImage _image, VkImageLayout _layout, uint32_t _mipLevels)
+{
+    if (m_transferFamily == m_graphicsFamily)
+        return;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = _layout;
+    barrier.newLayout = _layout;
+    barrier.srcQueueFamilyIndex = m_transferFamily;
+    barrier.dstQueueFamilyIndex = m_graphicsFamily;
+    barrier.image = _image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = _mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(GetTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void StagingRing::BeginBatch()
+{
+    Batch& batch = m_batches[m_currentBatch];
+    // Every slot is in flight, this one is the oldest.
+    while (batch.transferring || batch.submitted)
+    {
+        Reclaim(true);
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetFences(m_device.GetDevice(), 1, &batch.fence);
+    if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin staging command buffer");
+
+    if (HasSeparateTransferQueue())
+    {
+        vkResetFences(m_device.GetDevice(), 1, &batch.transferFence);
+        if (vkBeginCommandBuffer(batch.transferCommandBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("failed to begin transfer command buffer");
+    }
+
+    batch.recording = true;
+}
+
+bool StagingRing::IsComplete(Token _token)
+{
+    if (_token > m_completedToken)
+        Reclaim(false);
+    return _token <= m_completedToken;
+}
+
+void StagingRing::Wait(Token _token)
+{
+    if (_token > m_submittedToken)
+        Submit();
+    // Nothing was recorded since the last submit, the token had no work of its own.
+    _token = std::min(_token, m_submittedToken);
+
+    while (m_completedToken < _token)
+    {
+        Reclaim(true);
+    }
+}
+
+StagingRing::Token StagingRing::Submit()
+{
+    Batch& batch = m_batches[m_currentBatch];
+    if (batch.recording)
+    {
+        // Buffers have no layout to transition, one barrier makes every copy of the batch visible to later submissions.
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to record staging command buffer");
+
+        batch.recording = false;
+        batch.end = m_head;
+        batch.token = ++m_submittedToken;
+
+        if (HasSeparateTransferQueue())
+        {
+            if (vkEndCommandBuffer(batch.transferCommandBuffer) != VK_SUCCESS)
+                throw std::runtime_error("failed to record transfer command buffer");
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &batch.transferSemaphore;
+            if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, batch.transferFence) != VK_SUCCESS)
+                throw std::runtime_error("failed to submit transfer copies");
+
+            batch.transferring = true;
+        }
+        else
+        {
+            SubmitGraphicsHalf(batch);
+        }
+
+        m_currentBatch = (m_currentBatch + 1) % BATCH_COUNT;
+    }
+
+    Reclaim(false);
+    return m_submittedToken;
+}
+
+StagingRing::Token StagingRing::SubmitForGraphics()
+{
+    Token token = Submit();
+
+    for (uint32_t i = 0; i < BATCH_COUNT; i++)
+    {
+        Batch& batch = m_batches[(m_oldestBatch + i) % BATCH_COUNT];
+        if (batch.transferring)
+            SubmitGraphicsHalf(batch);
+    }
+
+    return token;
+}
+
+void StagingRing::SubmitGraphicsHalf(Batch& _batch)
+{
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &_batch.commandBuffer;
+    if (_batch.transferring)
+    {
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &_batch.transferSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+    }
+    if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, _batch.fence) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit staging commands");
+
+    _batch.transferring = false;
+    _batch.submitted = true;
+}
+
+void StagingRing::Flush()
+{
+    Wait(GetToken());
+}
+
+void StagingRing::Reclaim(bool _wait)
+{
+    // Graphics halves go in batch order, each once its copies are done. When waiting they all go right away, the
+    // semaphore then holds them back on the GPU instead.
+    for (uint32_t i = 0; i < BATCH_COUNT; i++)
+    {
+        Batch& batch = m_batches[(m_oldestBatch + i) % BATCH_COUNT];
+        if (batch.submitted)
+            continue;
+        if (!batch.transferring)
+            break;
+        if (!_wait && vkGetFenceStatus(m_device.GetDevice(), batch.transferFence) != VK_SUCCESS)
+            break;
+        SubmitGraphicsHalf(batch);
+    }
+
+    while (m_batches[m_oldestBatch].submitted)
+    {
+        Batch& batch = m_batches[m_oldestBatch];
+        if (_wait)
+        {
+            vkWaitForFences(m_device.GetDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            _wait = false;
+        }
+        else if (vkGetFenceStatus(m_device.GetDevice(), batch.fence) != VK_SUCCESS)
+        {
+            break;
+        }
+
+        m_tail = batch.end;
+        m_completedToken = batch.token;
+        batch.oversizedBuffers.clear();
+        batch.submitted = false;
+        m_oldestBatch = (m_oldestBatch + 1) % BATCH_COUNT;
+    }
+}
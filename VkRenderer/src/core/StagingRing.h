@@ -0,0 +1,129 @@
+#pragma once
+#include "core/Device.h"
+#include "core/Buffer.h"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <memory>
+#include <vector>
+
+// Persistently mapped upload memory shared by every transfer to device local resources. Uploads take a range of the
+// ring, write into it and record their copies into the command buffers of the current batch. The batch is submitted
+// once per frame, or earlier when the ring runs out of space, and its ranges are reused once its fence signals, so
+// uploads never allocate, map or wait on the queue unless the ring is full.
+// A batch has two halves. Copies run on the transfer queue, concurrently with rendering when the device has a separate
+// one, then the graphics half acquires what they wrote and runs the graphics only work, mip blits for instance. The
+// graphics half is only submitted once the transfer queue is done, so frames never wait behind a copy.
+// Batches are numbered by tokens, what a batch wrote may only be used once its token is complete.
+// Render thread only.
+class StagingRing
+{
+public:
+    // Batches complete in order, so a token is complete once the completed token is at least as large.
+    using Token = uint64_t;
+
+    struct Allocation
+    {
+        void* data = nullptr;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+    };
+
+    StagingRing(Device& _device, VkDeviceSize _size = DEFAULT_SIZE);
+    ~StagingRing();
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // Submits the current batch and waits for older ones when the ring is full. Ranges larger than the ring get a
+    // temporary buffer released with their batch. The copies reading the range must be recorded into the batch before
+    // the next Allocate, which may submit it. The graphics half suits resources the transfer family may not touch.
+    Allocation Allocate(VkDeviceSize _size, VkDeviceSize _alignment = 16);
+    // Copies _data to the buffer through the ring, in several ranges when it is larger than the ring, and hands the
+    // range over to the graphics queue.
+    void UploadToBuffer(VkBuffer _destination, VkDeviceSize _destinationOffset, const void* _data, VkDeviceSize _size);
+
+    // Transfer half of the current batch, opened on demand. Copies only, and the graphics half must acquire what they
+    // write to exclusive resources through the Transfer*Ownership calls.
+    VkCommandBuffer GetTransferCommandBuffer();
+    // Graphics half of the current batch, runs after the transfer half.
+    VkCommandBuffer GetCommandBuffer();
+
+    // Releases the range from the transfer queue family and acquires it on the graphics one. Nothing to record when
+    // both queues belong to the same family.
+    void TransferBufferOwnership(VkBuffer _buffer, VkDeviceSize _offset, VkDeviceSize _size);
+    // The image keeps _layout.
+    void TransferImageOwnership(VkImage _image, VkImageLayout _layout, uint32_t _mipLevels);
+
+    // Complete once everything recorded so far has run. That is the batch being recorded, which only completes after
+    // it is submitted, by the renderer at the end of the frame or by Wait, or the last submitted one when none is.
+    Token GetToken() const { return m_batches[m_currentBatch].recording ? m_submittedToken + 1 : m_submittedToken; }
+    bool IsComplete(Token _token);
+    // Submits the batch first when the token is the one being recorded. Waits on its fence, not on the queue.
+    void Wait(Token _token);
+
+    // Submits the commands recorded since the last call and returns their token, and hands the batches whose copies
+    // are done to the graphics queue.
+    Token Submit();
+    // Submits, then hands every graphics half to the queue without waiting for its copies, the semaphores hold them
+    // back on the GPU instead. What the batches wrote is then ordered before the next graphics submissions, for
+    // resources used right away rather than once their token completes.
+    Token SubmitForGraphics();
+    // Submits and waits for every batch.
+    void Flush();
+
+    VkDeviceSize GetSize() const { return m_size; }
+    // Bytes of the batch being recorded and of the ones the GPU may still be reading.
+    VkDeviceSize GetUsedSize() const { return m_head - m_tail; }
+    bool HasSeparateTransferQueue() const { return m_transferQueue != m_graphicsQueue; }
+
+private:
+    static constexpr VkDeviceSize DEFAULT_SIZE = 32 * 1024 * 1024;
+    static constexpr uint32_t BATCH_COUNT = 4;
+
+    struct Batch
+    {
+        VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        // Only with a separate transfer queue. The semaphore orders the halves on the GPU, the fence tells when the
+        // graphics half can be submitted without stalling the frames behind it.
+        VkFence transferFence = VK_NULL_HANDLE;
+        VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        bool recording = false;
+        // The transfer half is submitted, the graphics half is not yet.
+        bool transferring = false;
+        bool submitted = false;
+        Token token = 0;
+        // Ring position after the last range of the batch, the tail moves there once the fence signals.
+        uint64_t end = 0;
+        std::vector<std::unique_ptr<Buffer>> oversizedBuffers{};
+    };
+
+    bool TryReserve(VkDeviceSize _size, VkDeviceSize _alignment, VkDeviceSize& _offset);
+    void BeginBatch();
+    void SubmitGraphicsHalf(Batch& _batch);
+    // Submits the graphics halves whose copies are done and releases the batches whose fence signaled. With _wait,
+    // submits every graphics half and waits for the oldest batch.
+    void Reclaim(bool _wait);
+
+    Device& m_device;
+    VkDeviceSize m_size;
+    std::unique_ptr<Buffer> m_buffer;
+
+    VkQueue m_graphicsQueue = VK_NULL_HANDLE;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+    uint32_t m_graphicsFamily = 0;
+    uint32_t m_transferFamily = 0;
+    VkCommandPool m_transferCommandPool = VK_NULL_HANDLE;
+
+    // Positions only grow, the offset in the buffer is the position modulo the size.
+    uint64_t m_head = 0;
+    uint64_t m_tail = 0;
+
+    std::array<Batch, BATCH_COUNT> m_batches{};
+    uint32_t m_currentBatch = 0;
+    // Batches go through the slots in order, this is the oldest one still in flight.
+    uint32_t m_oldestBatch = 0;
+    Token m_submittedToken = 0;
+    Token m_completedToken = 0;
+};
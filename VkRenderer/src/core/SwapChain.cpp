@@ -39,9 +39,7 @@ SwapChain::~SwapChain()
     if (m_colorImage != VK_NULL_HANDLE) {
         vkDestroyImage(m_device.GetDevice(), m_colorImage, nullptr);
     }
-    if (m_colorImageMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_device.GetDevice(), m_colorImageMemory, nullptr);
-    }
+    m_device.FreeMemory(m_colorImageMemory);
     for (auto imageView : m_swapChainImageViews) 
     {
         vkDestroyImageView(m_device.GetDevice(), imageView, nullptr);
@@ -58,7 +56,7 @@ SwapChain::~SwapChain()
     {
         vkDestroyImageView(m_device.GetDevice(), m_depthImageViews[i], nullptr);
         vkDestroyImage(m_device.GetDevice(), m_depthImages[i], nullptr);
-        vkFreeMemory(m_device.GetDevice(), m_depthImageMemorys[i], nullptr);
+        m_device.FreeMemory(m_depthImageMemorys[i]);
     }
 
     for (auto framebuffer : m_swapChainFramebuffers) 
@@ -78,7 +76,8 @@ SwapChain::~SwapChain()
         vkDestroySemaphore(m_device.GetDevice(), m_renderFinishedSemaphores[i], nullptr);
     }
     
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) 
+    // Empty once a newer swap chain took them over.
+    for (size_t i = 0; i < m_inFlightFences.size(); i++) 
     {
         vkDestroyFence(m_device.GetDevice(), m_inFlightFences[i], nullptr);
     }
@@ -92,7 +91,7 @@ VkResult SwapChain::AcquireNextImage(uint32_t* _imageIndex)
     return result;
 }
 
-VkResult SwapChain::SubmitCommandBuffers( const VkCommandBuffer* buffers, uint32_t* imageIndex) 
+VkResult SwapChain::SubmitCommandBuffers( const VkCommandBuffer* buffers, uint32_t* imageIndex, const std::vector<VkSemaphore>& _waitSemaphores, const std::vector<VkPipelineStageFlags>& _waitStages, const std::vector<VkSemaphore>& _signalSemaphores) 
 {
 
     if (m_imagesInFlight[*imageIndex] != VK_NULL_HANDLE)
@@ -104,17 +103,21 @@ VkResult SwapChain::SubmitCommandBuffers( const VkCommandBuffer* buffers, uint32
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
+    std::vector<VkSemaphore> waitSemaphores = { m_imageAvailableSemaphores[m_currentFrame] };
+    waitSemaphores.insert(waitSemaphores.end(), _waitSemaphores.begin(), _waitSemaphores.end());
 
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    waitStages.insert(waitStages.end(), _waitStages.begin(), _waitStages.end());
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = buffers;
-    VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[*imageIndex] };
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    // Present only waits on the first one.
+    std::vector<VkSemaphore> signalSemaphores = { m_renderFinishedSemaphores[*imageIndex] };
+    signalSemaphores.insert(signalSemaphores.end(), _signalSemaphores.begin(), _signalSemaphores.end());
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
 
     vkResetFences(m_device.GetDevice(), 1, &m_inFlightFences[m_currentFrame]);
 
@@ -126,7 +129,7 @@ VkResult SwapChain::SubmitCommandBuffers( const VkCommandBuffer* buffers, uint32
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = signalSemaphores.data();
     presentInfo.swapchainCount = 1;
 
     VkSwapchainKHR swapChains[] = { m_swapChain };
@@ -404,7 +407,6 @@ void SwapChain::CreateSyncObjects()
     // Create semaphores for each swapchain image
     m_imageAvailableSemaphores.resize(GetImageCount());
     m_renderFinishedSemaphores.resize(GetImageCount());
-    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
     m_imagesInFlight.resize(GetImageCount(), VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -424,7 +426,17 @@ void SwapChain::CreateSyncObjects()
         }
     }
 
+    // Frames submitted with the previous swap chain may still run, the next frames of their slots wait on them.
+    if (m_oldSwapChain)
+    {
+        m_inFlightFences = std::move(m_oldSwapChain->m_inFlightFences);
+        m_oldSwapChain->m_inFlightFences.clear();
+        m_currentFrame = m_oldSwapChain->m_currentFrame;
+        return;
+    }
+
     // Create fences for frame synchronization
+    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) 
     {
         if (vkCreateFence(m_device.GetDevice(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) 
@@ -11,6 +11,7 @@ public:
 	static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
     SwapChain(Device& _device, VkExtent2D _extent);
+    // Takes over the frame fences of _previous, the frames it submitted keep being waited on.
     SwapChain(Device& _device, VkExtent2D _extent, std::shared_ptr<SwapChain> _previous);
     ~SwapChain();
 
@@ -30,7 +31,8 @@ public:
     VkFormat FindDepthFormat();
 
     VkResult AcquireNextImage(uint32_t* _imageIndex);
-    VkResult SubmitCommandBuffers(const VkCommandBuffer* _buffers, uint32_t* _imageIndex);
+    // The extra semaphores synchronize the frame with work submitted to other queues, the async compute for instance.
+    VkResult SubmitCommandBuffers(const VkCommandBuffer* _buffers, uint32_t* _imageIndex, const std::vector<VkSemaphore>& _waitSemaphores = {}, const std::vector<VkPipelineStageFlags>& _waitStages = {}, const std::vector<VkSemaphore>& _signalSemaphores = {});
 
     bool CompareSwapFormats(const SwapChain& _swapChain) const { return _swapChain.m_swapChainDepthFormat == m_swapChainDepthFormat &&  _swapChain.m_swapChainImageFormat == m_swapChainImageFormat;}
 
@@ -58,7 +60,7 @@ private:
     VkRenderPass m_renderPass;
 
     std::vector<VkImage> m_depthImages;
-    std::vector<VkDeviceMemory> m_depthImageMemorys;
+    std::vector<MemoryAllocation> m_depthImageMemorys;
     std::vector<VkImageView> m_depthImageViews;
     std::vector<VkImage> m_swapChainImages;
     std::vector<VkImageView> m_swapChainImageViews;
@@ -77,7 +79,7 @@ private:
 
     VkSampleCountFlagBits m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
     VkImage m_colorImage = VK_NULL_HANDLE;
-    VkDeviceMemory m_colorImageMemory = VK_NULL_HANDLE;
+    MemoryAllocation m_colorImageMemory{};
     VkImageView m_colorImageView = VK_NULL_HANDLE;
 };
 
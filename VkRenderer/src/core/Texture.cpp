@@ -1,6 +1,8 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "Texture.h"
+#include "StagingRing.h"
+#include "DeletionQueue.h"
 #include <stdexcept>
 #include <cstring>
 #include <algorithm>
@@ -8,38 +10,71 @@
 
 Texture::Texture() {}
 
-Texture::~Texture() {}
+Texture::~Texture()
+{
+    if (m_device)
+        Cleanup(*m_device);
+}
 
-bool Texture::LoadFromFile(const std::string& _filename, Device& _device, VkQueue _graphicsQueue)
+namespace
+{
+    Texture::ImageData TakePixels(stbi_uc* _pixels, int _width, int _height)
+    {
+        Texture::ImageData image{};
+        image.width = static_cast<uint32_t>(_width);
+        image.height = static_cast<uint32_t>(_height);
+        image.pixels.assign(_pixels, _pixels + static_cast<size_t>(image.width) * image.height * 4);
+
+        stbi_image_free(_pixels);
+        return image;
+    }
+}
+
+Texture::ImageData Texture::DecodeFile(const std::string& _filename)
 {
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(_filename.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     if (!pixels)
         throw std::runtime_error("failed to load texture image");
-    m_width = static_cast<uint32_t>(texWidth);
-    m_height = static_cast<uint32_t>(texHeight);
-    m_mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(m_width, m_height)))) + 1;
-    VkDeviceSize imageSize = m_width * m_height * 4;
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    _device.CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    return TakePixels(pixels, texWidth, texHeight);
+}
+
+Texture::ImageData Texture::DecodeMemory(const uint8_t* _data, size_t _size)
+{
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load_from_memory(_data, static_cast<int>(_size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels)
+        throw std::runtime_error("failed to decode texture image");
 
-    void* data;
-    vkMapMemory(_device.GetDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(_device.GetDevice(), stagingBufferMemory);
+    return TakePixels(pixels, texWidth, texHeight);
+}
+
+bool Texture::LoadFromFile(const std::string& _filename, Device& _device, VkQueue _graphicsQueue)
+{
+    return LoadFromPixels(DecodeFile(_filename), _device, _graphicsQueue);
+}
 
-    stbi_image_free(pixels);
+bool Texture::LoadFromPixels(const ImageData& _image, Device& _device, VkQueue _graphicsQueue)
+{
+    m_device = &_device;
+    m_width = _image.width;
+    m_height = _image.height;
+    m_mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(m_width, m_height)))) + 1;
+    VkDeviceSize imageSize = m_width * m_height * 4;
 
     CreateImage(_device, m_width, m_height, m_mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_imageMemory);
 
-    TransitionImageLayout(_device, _graphicsQueue, m_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
-    CopyBufferToImage(_device, _graphicsQueue, stagingBuffer, m_image, m_width, m_height);
-    GenerateMipmaps(_device, m_image, VK_FORMAT_R8G8B8A8_SRGB, m_width, m_height, m_mipLevels);
+    StagingRing& stagingRing = _device.GetStagingRing();
+    StagingRing::Allocation staging = stagingRing.Allocate(imageSize);
+    memcpy(staging.data, _image.pixels.data(), static_cast<size_t>(imageSize));
 
-    vkDestroyBuffer(_device.GetDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(_device.GetDevice(), stagingBufferMemory, nullptr);
+    // The copy runs on the transfer queue, the blits need the graphics one.
+    VkCommandBuffer transferCommandBuffer = stagingRing.GetTransferCommandBuffer();
+    TransitionImageLayout(transferCommandBuffer, m_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
+    CopyBufferToImage(transferCommandBuffer, staging.buffer, staging.offset, m_image, m_width, m_height);
+    stagingRing.TransferImageOwnership(m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
+    GenerateMipmaps(_device, stagingRing.GetCommandBuffer(), m_image, VK_FORMAT_R8G8B8A8_SRGB, m_width, m_height, m_mipLevels);
 
     CreateImageView(_device, m_image, VK_FORMAT_R8G8B8A8_SRGB, m_mipLevels);
     CreateSampler(_device);
@@ -47,7 +82,7 @@ bool Texture::LoadFromFile(const std::string& _filename, Device& _device, VkQueu
     return true;
 }
 
-void Texture::CreateImage(Device& _device, uint32_t _width, uint32_t _height, uint32_t _mipLevels, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags _properties, VkImage& _image, VkDeviceMemory& _imageMemory)
+void Texture::CreateImage(Device& _device, uint32_t _width, uint32_t _height, uint32_t _mipLevels, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags _properties, VkImage& _image, MemoryAllocation& _imageMemory)
 {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -64,27 +99,12 @@ void Texture::CreateImage(Device& _device, uint32_t _width, uint32_t _height, ui
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateImage(_device.GetDevice(), &imageInfo, nullptr, &_image) != VK_SUCCESS)
-        throw std::runtime_error("failed to create image");
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(_device.GetDevice(), _image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = _device.FindMemoryType(memRequirements.memoryTypeBits, _properties);
-
-    if (vkAllocateMemory(_device.GetDevice(), &allocInfo, nullptr, &_imageMemory) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate image memory");
-
-    vkBindImageMemory(_device.GetDevice(), _image, _imageMemory, 0);
+    _device.CreateImageWithInfo(imageInfo, _properties, _image, _imageMemory);
+    m_memorySize = _imageMemory.size;
 }
 
-void Texture::TransitionImageLayout(Device& _device, VkQueue _graphicsQueue, VkImage _image, VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout, uint32_t _mipLevels)
+void Texture::TransitionImageLayout(VkCommandBuffer _commandBuffer, VkImage _image, VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout, uint32_t _mipLevels)
 {
-    VkCommandBuffer commandBuffer = _device.BeginSingleTimeCommands();
-
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = _oldLayout;
@@ -118,23 +138,19 @@ void Texture::TransitionImageLayout(Device& _device, VkQueue _graphicsQueue, VkI
     }
 
     vkCmdPipelineBarrier(
-        commandBuffer,
+        _commandBuffer,
         sourceStage, destinationStage,
         0,
         0, nullptr,
         0, nullptr,
         1, &barrier
     );
-
-    _device.EndSingleTimeCommands(commandBuffer);
 }
 
-void Texture::CopyBufferToImage(Device& _device, VkQueue _graphicsQueue, VkBuffer _buffer, VkImage _image, uint32_t _width, uint32_t _height)
+void Texture::CopyBufferToImage(VkCommandBuffer _commandBuffer, VkBuffer _buffer, VkDeviceSize _bufferOffset, VkImage _image, uint32_t _width, uint32_t _height)
 {
-    VkCommandBuffer commandBuffer = _device.BeginSingleTimeCommands();
-
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = _bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -144,9 +160,7 @@ void Texture::CopyBufferToImage(Device& _device, VkQueue _graphicsQueue, VkBuffe
     region.imageOffset = {0, 0, 0};
     region.imageExtent = {_width, _height, 1};
 
-    vkCmdCopyBufferToImage(commandBuffer, _buffer, _image,  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    _device.EndSingleTimeCommands(commandBuffer);
+    vkCmdCopyBufferToImage(_commandBuffer, _buffer, _image,  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
 void Texture::CreateImageView(Device& _device, VkImage _image, VkFormat _format, uint32_t _mipLevels)
@@ -190,16 +204,13 @@ void Texture::CreateSampler(Device& _device)
         throw std::runtime_error("failed to create texture sampler");
 }
 
-void Texture::GenerateMipmaps(Device& _device, VkImage _image, VkFormat _imageFormat, int32_t _texWidth, int32_t _texHeight, uint32_t _mipLevels)
+void Texture::GenerateMipmaps(Device& _device, VkCommandBuffer _commandBuffer, VkImage _image, VkFormat _imageFormat, int32_t _texWidth, int32_t _texHeight, uint32_t _mipLevels)
 {
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(_device.GetPhysicalDevice(), _imageFormat, &formatProperties);
 
     if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) 
         throw std::runtime_error("texture image format does not support linear blitting");
-    
-
-    VkCommandBuffer commandBuffer = _device.BeginSingleTimeCommands();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -222,7 +233,7 @@ void Texture::GenerateMipmaps(Device& _device, VkImage _image, VkFormat _imageFo
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
         VkImageBlit blit{};
         blit.srcOffsets[0] = { 0, 0, 0 };
@@ -238,14 +249,14 @@ void Texture::GenerateMipmaps(Device& _device, VkImage _image, VkFormat _imageFo
         blit.dstSubresource.baseArrayLayer = 0;
         blit.dstSubresource.layerCount = 1;
 
-        vkCmdBlitImage(commandBuffer, _image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        vkCmdBlitImage(_commandBuffer, _image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
         barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
         barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
         if (mipWidth > 1)
             mipWidth /= 2;
@@ -259,36 +270,31 @@ void Texture::GenerateMipmaps(Device& _device, VkImage _image, VkFormat _imageFo
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    vkCmdPipelineBarrier(commandBuffer,
+    vkCmdPipelineBarrier(_commandBuffer,
         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
         0, nullptr,
         0, nullptr,
         1, &barrier);
-
-    _device.EndSingleTimeCommands(commandBuffer);
 }
 
 void Texture::Cleanup(Device& _device)
 {
-    if (m_sampler != VK_NULL_HANDLE) 
-    {
-        vkDestroySampler(_device.GetDevice(), m_sampler, nullptr);
-        m_sampler = VK_NULL_HANDLE;
-    }
-    if (m_imageView != VK_NULL_HANDLE) 
-    {
-        vkDestroyImageView(_device.GetDevice(), m_imageView, nullptr);
-        m_imageView = VK_NULL_HANDLE;
-    }
-    if (m_image != VK_NULL_HANDLE) 
-    {
-        vkDestroyImage(_device.GetDevice(), m_image, nullptr);
-        m_image = VK_NULL_HANDLE;
-    }
-    if (m_imageMemory != VK_NULL_HANDLE) 
-    {
-        vkFreeMemory(_device.GetDevice(), m_imageMemory, nullptr);
-        m_imageMemory = VK_NULL_HANDLE;
-    }
+    // Frames in flight may still sample the texture.
+    Device* device = &_device;
+    _device.GetDeletionQueue().Push([device, sampler = m_sampler, imageView = m_imageView, image = m_image, imageMemory = m_imageMemory]() mutable
+        {
+            if (sampler != VK_NULL_HANDLE) 
+                vkDestroySampler(device->GetDevice(), sampler, nullptr);
+            if (imageView != VK_NULL_HANDLE) 
+                vkDestroyImageView(device->GetDevice(), imageView, nullptr);
+            if (image != VK_NULL_HANDLE) 
+                vkDestroyImage(device->GetDevice(), image, nullptr);
+            device->FreeMemory(imageMemory);
+        });
+
+    m_sampler = VK_NULL_HANDLE;
+    m_imageView = VK_NULL_HANDLE;
+    m_image = VK_NULL_HANDLE;
+    m_imageMemory = {};
     m_loaded = false;
 }
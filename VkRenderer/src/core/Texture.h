@@ -4,6 +4,7 @@
 #include <string>
 #include <memory>
 #include <cmath>
+#include <vector>
 
 class Texture 
 {
@@ -13,28 +14,46 @@ public:
     Texture(const Texture&) = delete;
     Texture& operator=(const Texture&) = delete;
 
+    // RGBA8 pixels of a decoded image. Decoding touches no Vulkan object and can run on any thread.
+    struct ImageData
+    {
+        std::vector<unsigned char> pixels;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    static ImageData DecodeFile(const std::string& _filename);
+    // Encoded image already in memory, a PNG or JPEG embedded in a glTF buffer for instance.
+    static ImageData DecodeMemory(const uint8_t* _data, size_t _size);
+
     bool LoadFromFile(const std::string& _filename, Device& _device, VkQueue _graphicsQueue);
+    bool LoadFromPixels(const ImageData& _image, Device& _device, VkQueue _graphicsQueue);
 
     VkImageView GetImageView() const { return m_imageView; }
     VkSampler GetSampler() const { return m_sampler; }
     VkImage GetImage() const { return m_image; }
     uint32_t GetMipLevels() const { return m_mipLevels; }
+    VkDeviceSize GetMemorySize() const { return m_memorySize; }
 
 private:
-    void CreateImage(Device& _device, uint32_t _width, uint32_t _height, uint32_t _mipLevels, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags _properties, VkImage& _image, VkDeviceMemory& _imageMemory);
-    void TransitionImageLayout(Device& _device, VkQueue _graphicsQueue, VkImage _image, VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout, uint32_t _mipLevels);
-    void CopyBufferToImage(Device& _device, VkQueue _graphicsQueue, VkBuffer _buffer, VkImage _image, uint32_t _width, uint32_t _height);
+    void CreateImage(Device& _device, uint32_t _width, uint32_t _height, uint32_t _mipLevels, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags _properties, VkImage& _image, MemoryAllocation& _imageMemory);
+    // Recorded into the staging ring command buffer, along with the copy of the pixels.
+    void TransitionImageLayout(VkCommandBuffer _commandBuffer, VkImage _image, VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout, uint32_t _mipLevels);
+    void CopyBufferToImage(VkCommandBuffer _commandBuffer, VkBuffer _buffer, VkDeviceSize _bufferOffset, VkImage _image, uint32_t _width, uint32_t _height);
     void CreateImageView(Device& _device, VkImage _image, VkFormat _format, uint32_t _mipLevels);
     void CreateSampler(Device& _device);
-    void GenerateMipmaps(Device& _device, VkImage _image, VkFormat _imageFormat, int32_t _texWidth, int32_t _texHeight, uint32_t _mipLevels);
+    void GenerateMipmaps(Device& _device, VkCommandBuffer _commandBuffer, VkImage _image, VkFormat _imageFormat, int32_t _texWidth, int32_t _texHeight, uint32_t _mipLevels);
     void Cleanup(Device& _device);
 
+    // Set once loaded, the destructor releases the Vulkan objects through it.
+    Device* m_device = nullptr;
     VkImage m_image = VK_NULL_HANDLE;
-    VkDeviceMemory m_imageMemory = VK_NULL_HANDLE;
+    MemoryAllocation m_imageMemory{};
     VkImageView m_imageView = VK_NULL_HANDLE;
     VkSampler m_sampler = VK_NULL_HANDLE;
     uint32_t m_width = 0;
     uint32_t m_height = 0;
     uint32_t m_mipLevels = 1;
+    VkDeviceSize m_memorySize = 0;
     bool m_loaded = false;
 };
@@ -0,0 +1,119 @@
+#include "core/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(uint32_t _threadCount)
+{
+    if (_threadCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        _threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_workers.reserve(_threadCount);
+    for (uint32_t i = 0; i < _threadCount; i++)
+    {
+        m_workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+    static ThreadPool pool{};
+    return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> _job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push(std::move(_job));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+            if (m_stopping && m_jobs.empty())
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+        job();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t _count, const std::function<void(size_t)>& _job)
+{
+    if (_count == 0)
+        return;
+
+    if (_count == 1)
+    {
+        _job(0);
+        return;
+    }
+
+    // Items are pulled from a shared counter so uneven items balance out. The caller drains items too and only
+    // waits for completion, never for the helpers themselves, so nested calls from a worker cannot deadlock.
+    struct State
+    {
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> done{ 0 };
+        size_t count = 0;
+        const std::function<void(size_t)>* job = nullptr;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    auto state = std::make_shared<State>();
+    state->count = _count;
+    state->job = &_job;
+
+    auto drain = [state]()
+    {
+        for (size_t i = state->next.fetch_add(1); i < state->count; i = state->next.fetch_add(1))
+        {
+            (*state->job)(i);
+
+            if (state->done.fetch_add(1) + 1 == state->count)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helperCount = std::min(_count - 1, m_workers.size());
+    for (size_t i = 0; i < helperCount; i++)
+    {
+        Enqueue(drain);
+    }
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done.load() == _count; });
+}
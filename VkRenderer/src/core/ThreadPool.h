@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // 0 picks one worker per hardware thread, minus the calling thread.
+    explicit ThreadPool(uint32_t _threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process wide pool for CPU bound import work.
+    static ThreadPool& GetShared();
+
+    template <typename F>
+    auto Submit(F&& _job) -> std::future<decltype(_job())>
+    {
+        using Result = decltype(_job());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(_job));
+        std::future<Result> future = task->get_future();
+        Enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+    // Runs _job(i) for i in [0, _count) and blocks until all are done, the calling thread takes part.
+    // Jobs must not throw.
+    void ParallelFor(size_t _count, const std::function<void(size_t)>& _job);
+
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+    void Enqueue(std::function<void()> _job);
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
@@ -18,4 +18,18 @@ std::vector<char> Utils::ReadFile(const std::string& _filename)
     file.close();
 
     return buffer;
-} 
\ No newline at end of file
+}
+
+uint64_t Utils::HashBytes(const void* _data, size_t _size, uint64_t _seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(_data);
+    uint64_t hash = _seed;
+
+    for (size_t i = 0; i < _size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
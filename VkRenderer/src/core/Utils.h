@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <vector>
 #include <string>
@@ -6,6 +7,9 @@
 class Utils {
 public:
     static std::vector<char> ReadFile(const std::string& _filename);
+
+    // 64-bit FNV-1a, stable across runs and platforms so it can key on-disk caches.
+    static uint64_t HashBytes(const void* _data, size_t _size, uint64_t _seed = 0xcbf29ce484222325ull);
 };
 
 template <typename T, typename... Rest>
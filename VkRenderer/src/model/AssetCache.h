@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shares GPU assets between everything that loads the same content. Entries are keyed by the normalized source path
+// and the size and modification time of the file, so an edited file loads again instead of hitting a stale entry
+// while a resident one is found without reading the file.
+// Callers hold shared_ptrs. The last one may go away on any thread, so the asset is only destroyed by the next Collect.
+// _destroy is expected to hand the GPU objects to the deletion queue of the device, frames in flight may still read them.
+// Find and Insert may be called from loader threads, Collect from the render thread.
+template <typename T>
+class AssetCache
+{
+public:
+	using Destroy = std::function<void(T*)>;
+
+	struct Stats
+	{
+		uint32_t hitCount = 0;
+		uint32_t missCount = 0;
+		uint32_t residentCount = 0;
+		uint64_t residentSize = 0;
+	};
+
+	explicit AssetCache(Destroy _destroy = [](T* _asset) { delete _asset; }) : m_state{ std::make_shared<State>() }
+	{
+		m_state->destroy = std::move(_destroy);
+	}
+
+	// Assets still referenced are destroyed as soon as they are released, without delay, _destroy must stay callable
+	// until then.
+	~AssetCache()
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->alive = false;
+		for (T* released : m_state->released)
+		{
+			m_state->destroy(released);
+		}
+		m_state->released.clear();
+	}
+
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	static std::string MakeKey(const std::string& _path)
+	{
+		std::error_code error{};
+		uint64_t size = std::filesystem::file_size(_path, error);
+		if (error)
+			size = 0;
+		auto writeTime = std::filesystem::last_write_time(_path, error).time_since_epoch().count();
+		if (error)
+			writeTime = 0;
+
+		return std::filesystem::path(_path).lexically_normal().generic_string() + "#" + std::to_string(size) + "#" + std::to_string(writeTime);
+	}
+
+	std::shared_ptr<T> Find(const std::string& _key)
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		auto entry = m_state->entries.find(_key);
+		std::shared_ptr<T> asset = entry != m_state->entries.end() ? entry->second.asset.lock() : nullptr;
+		if (asset)
+			m_state->stats.hitCount++;
+		else
+			m_state->stats.missCount++;
+		return asset;
+	}
+
+	// When another loader inserted the same key first, _asset is dropped and the resident one is returned.
+	std::shared_ptr<T> Insert(const std::string& _key, std::unique_ptr<T> _asset, uint64_t _size)
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		Entry& entry = m_state->entries[_key];
+		if (std::shared_ptr<T> resident = entry.asset.lock())
+		{
+			// Never drawn, nothing references it.
+			m_state->destroy(_asset.release());
+			return resident;
+		}
+
+		std::shared_ptr<State> state = m_state;
+		std::shared_ptr<T> asset{ _asset.release(), [state, _key](T* _released)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (!state->alive)
+				{
+					state->destroy(_released);
+					return;
+				}
+
+				auto entry = state->entries.find(_key);
+				if (entry != state->entries.end() && entry->second.asset.expired())
+				{
+					state->entries.erase(entry);
+				}
+				state->released.push_back(_released);
+			} };
+
+		entry.asset = asset;
+		entry.size = _size;
+		return asset;
+	}
+
+	// Destroys the assets released since the last call, once per frame.
+	void Collect()
+	{
+		std::vector<T*> destroyed{};
+		{
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			destroyed.swap(m_state->released);
+		}
+
+		// Outside of the lock, destroying a model releases its texture into another cache.
+		for (T* asset : destroyed)
+		{
+			m_state->destroy(asset);
+		}
+	}
+
+	Stats GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		Stats stats = m_state->stats;
+		for (const auto& [key, entry] : m_state->entries)
+		{
+			if (!entry.asset.expired())
+			{
+				stats.residentCount++;
+				stats.residentSize += entry.size;
+			}
+		}
+		return stats;
+	}
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<T> asset;
+		uint64_t size = 0;
+	};
+
+	// Shared with the deleters, which may outlive the cache.
+	struct State
+	{
+		mutable std::mutex mutex;
+		std::unordered_map<std::string, Entry> entries;
+		std::vector<T*> released;
+		Stats stats{};
+		Destroy destroy;
+		bool alive = true;
+	};
+
+	std::shared_ptr<State> m_state;
+};
@@ -0,0 +1,364 @@
+#include "model/AssetLoader.h"
+#include "core/ThreadPool.h"
+#include "core/DeletionQueue.h"
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	// Unit cube with one quad per face so each face gets its own normal and uvs.
+	Model::Builder BuildPlaceholderCube()
+	{
+		const glm::vec3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		const glm::vec3 color{ 0.5f };
+
+		Model::Builder builder{};
+		for (const glm::vec3& normal : normals)
+		{
+			// Two axes spanning the face, any pair orthogonal to the normal.
+			glm::vec3 tangent = normal.x != 0.0f ? glm::vec3{ 0, 1, 0 } : glm::vec3{ 1, 0, 0 };
+			glm::vec3 bitangent = glm::cross(normal, tangent);
+
+			uint32_t first = static_cast<uint32_t>(builder.vertices.size());
+			const glm::vec2 corners[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+			for (const glm::vec2& corner : corners)
+			{
+				Model::Vertex vertex{};
+				vertex.position = 0.5f * normal + (corner.x - 0.5f) * tangent + (corner.y - 0.5f) * bitangent;
+				vertex.color = color;
+				vertex.normal = normal;
+				vertex.uv = corner;
+				builder.vertices.push_back(vertex);
+			}
+
+			builder.indices.insert(builder.indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+		}
+
+		builder.bounds.center = glm::vec3{ 0.0f };
+		builder.bounds.radius = glm::length(glm::vec3{ 0.5f });
+		return builder;
+	}
+}
+
+// Cached models may be released after the loader is gone, their destroy callback only holds the device and the pool.
+AssetLoader::AssetLoader(Device& _device) : m_device{ _device }, m_texturePool{ CreateTexturePool(_device) },
+	m_modelCache{ [device = &_device, texturePool = m_texturePool](Model* _model) { DestroyModel(*device, texturePool, _model); } }
+{
+	m_textureSetLayout = DescriptorSetLayout::Builder(m_device)
+		.AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+		.Build();
+
+	CreatePlaceholders();
+}
+
+AssetLoader::~AssetLoader()
+{
+	// The workers only touch their own DecodedAsset, waiting just keeps them from outliving the loader. Loads that
+	// never reached the GPU complete as failed ones.
+	for (PendingLoad& load : m_pending)
+	{
+		load.decoded.wait();
+		load.result.set_value(nullptr);
+	}
+
+	// Created models are handed to their waiters once their copies ran. Callbacks are not run, whatever they would
+	// update may already be gone.
+	StagingRing& stagingRing = m_device.GetStagingRing();
+	for (UploadingLoad& load : m_uploading)
+	{
+		stagingRing.Wait(load.token);
+		load.result.set_value(load.model);
+	}
+}
+
+void AssetLoader::CreatePlaceholders()
+{
+	m_placeholderModel = std::make_shared<Model>(m_device, BuildPlaceholderCube());
+
+	Texture::ImageData image{};
+	image.width = 1;
+	image.height = 1;
+	image.pixels = { 128, 128, 128, 255 };
+
+	m_placeholderTexture = std::make_shared<Texture>();
+	m_placeholderTexture->LoadFromPixels(image, m_device, m_device.GetGraphicsQueue());
+	m_placeholderTextureSet = CreateTextureDescriptorSet(*m_placeholderTexture);
+
+	m_placeholderModel->SetTexture(m_placeholderTexture);
+	m_placeholderModel->SetTextureDescriptorSet(m_placeholderTextureSet);
+
+	// Drawn from the first frame.
+	m_device.GetStagingRing().Flush();
+}
+
+std::unique_ptr<AssetLoader::DecodedAsset> AssetLoader::Decode(const std::string& _modelPath, const std::string& _texturePath)
+{
+	auto asset = std::make_unique<DecodedAsset>();
+
+	// A model entry is the mesh bound to its texture, the texture alone is shared through its own cache.
+	asset->modelKey = AssetCache<Model>::MakeKey(_modelPath);
+	if (!_texturePath.empty())
+	{
+		asset->textureKey = AssetCache<Texture>::MakeKey(_texturePath);
+		asset->modelKey += "|" + asset->textureKey;
+	}
+
+	asset->cachedModel = m_modelCache.Find(asset->modelKey);
+	if (asset->cachedModel)
+		return asset;
+
+	asset->meshData = Model::LoadMeshData(_modelPath, asset->cookedFile, asset->builder);
+	if (!_texturePath.empty())
+	{
+		asset->hasTexture = true;
+		asset->cachedTexture = m_textureCache.Find(asset->textureKey);
+		if (!asset->cachedTexture)
+		{
+			asset->image = Texture::DecodeFile(_texturePath);
+		}
+	}
+	return asset;
+}
+
+std::shared_future<std::shared_ptr<Model>> AssetLoader::LoadModelAsync(const std::string& _modelPath, const std::string& _texturePath, Callback _callback)
+{
+	PendingLoad load{};
+	load.modelPath = _modelPath;
+	load.callback = std::move(_callback);
+	load.decoded = ThreadPool::GetShared().Submit([this, _modelPath, _texturePath]() { return Decode(_modelPath, _texturePath); });
+
+	std::shared_future<std::shared_ptr<Model>> result = load.result.get_future().share();
+	m_pending.push_back(std::move(load));
+	return result;
+}
+
+std::shared_ptr<Model> AssetLoader::LoadModel(const std::string& _modelPath, const std::string& _texturePath)
+{
+	std::shared_ptr<Model> model = Upload(*Decode(_modelPath, _texturePath));
+	m_device.GetStagingRing().Flush();
+	return model;
+}
+
+std::vector<AssetLoader::SceneInstance> AssetLoader::LoadScene(const std::string& _filePath)
+{
+	auto importStart = std::chrono::high_resolution_clock::now();
+
+	GltfImporter importer{};
+	importer.Load(_filePath);
+
+	const std::string fileKey = AssetCache<Model>::MakeKey(_filePath);
+	const std::vector<GltfImporter::Mesh>& meshes = importer.GetMeshes();
+	const std::vector<GltfImporter::Material>& materials = importer.GetMaterials();
+
+	// Meshes instanced by several nodes are uploaded once.
+	std::vector<std::vector<std::shared_ptr<Model>>> meshModels(meshes.size());
+	std::vector<SceneInstance> instances{};
+	uint32_t modelCount = 0;
+
+	for (const GltfImporter::Node& node : importer.GetNodes())
+	{
+		if (node.mesh < 0)
+			continue;
+
+		const GltfImporter::Mesh& mesh = meshes[node.mesh];
+		std::vector<std::shared_ptr<Model>>& models = meshModels[node.mesh];
+		if (models.empty())
+		{
+			for (size_t i = 0; i < mesh.primitives.size(); i++)
+			{
+				std::string key = fileKey + "/mesh" + std::to_string(node.mesh) + "/primitive" + std::to_string(i);
+				models.push_back(UploadScenePrimitive(importer, fileKey, key, mesh.primitives[i]));
+			}
+			modelCount += static_cast<uint32_t>(models.size());
+		}
+
+		for (size_t i = 0; i < mesh.primitives.size(); i++)
+		{
+			SceneInstance instance{};
+			instance.name = node.name.empty() ? mesh.name : node.name;
+			instance.model = models[i];
+			instance.transform = node.world;
+
+			int32_t material = mesh.primitives[i].material;
+			if (material >= 0)
+			{
+				instance.color = glm::vec3(materials[material].baseColorFactor);
+			}
+			instances.push_back(std::move(instance));
+		}
+	}
+
+	m_device.GetStagingRing().Flush();
+
+	std::chrono::duration<double> importTime = std::chrono::high_resolution_clock::now() - importStart;
+	std::cout << "Imported " << _filePath << " in " << importTime.count() * 1000.0 << " ms (" << instances.size() << " instances of " << modelCount << " models)" << std::endl;
+	return instances;
+}
+
+std::shared_ptr<Model> AssetLoader::UploadScenePrimitive(const GltfImporter& _importer, const std::string& _fileKey, const std::string& _key, const GltfImporter::Primitive& _primitive)
+{
+	if (std::shared_ptr<Model> cachedModel = m_modelCache.Find(_key))
+		return cachedModel;
+
+	auto model = std::make_unique<Model>(m_device, _importer.GetStreamData(_primitive));
+
+	if (_primitive.material >= 0)
+	{
+		int32_t image = _importer.GetMaterials()[_primitive.material].baseColorImage;
+		std::shared_ptr<Texture> texture = image >= 0 ? LoadSceneTexture(_importer, _fileKey, image) : nullptr;
+		if (texture)
+		{
+			model->SetTexture(texture);
+			model->SetTextureDescriptorSet(CreateTextureDescriptorSet(*texture));
+		}
+	}
+
+	VkDeviceSize modelSize = model->GetMemorySize();
+	return m_modelCache.Insert(_key, std::move(model), modelSize);
+}
+
+std::shared_ptr<Texture> AssetLoader::LoadSceneTexture(const GltfImporter& _importer, const std::string& _fileKey, int32_t _image)
+{
+	const GltfImporter::Image& image = _importer.GetImages()[_image];
+	if (!image.data && image.path.empty())
+		return nullptr;
+
+	// Embedded images are part of the glTF file content, external ones are keyed by their own file.
+	std::string key = image.data ? _fileKey + "/image" + std::to_string(_image) : AssetCache<Texture>::MakeKey(image.path);
+	if (std::shared_ptr<Texture> cachedTexture = m_textureCache.Find(key))
+		return cachedTexture;
+
+	try
+	{
+		Texture::ImageData pixels = image.data ? Texture::DecodeMemory(image.data, image.size) : Texture::DecodeFile(image.path);
+
+		auto texture = std::make_unique<Texture>();
+		texture->LoadFromPixels(pixels, m_device, m_device.GetGraphicsQueue());
+		VkDeviceSize textureSize = texture->GetMemorySize();
+		return m_textureCache.Insert(key, std::move(texture), textureSize);
+	}
+	catch (const std::exception& _exception)
+	{
+		std::cout << "Failed to load glTF image " << _image << ": " << _exception.what() << std::endl;
+		return nullptr;
+	}
+}
+
+void AssetLoader::Update()
+{
+	// Callbacks run once the lists are settled, they may queue new loads.
+	StagingRing& stagingRing = m_device.GetStagingRing();
+	std::vector<UploadingLoad> completed{};
+	while (!m_uploading.empty() && stagingRing.IsComplete(m_uploading.front().token))
+	{
+		completed.push_back(std::move(m_uploading.front()));
+		m_uploading.erase(m_uploading.begin());
+	}
+
+	std::vector<PendingLoad> finished{};
+	for (auto it = m_pending.begin(); it != m_pending.end() && finished.size() < MAX_UPLOADS_PER_UPDATE;)
+	{
+		if (it->decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			finished.push_back(std::move(*it));
+			it = m_pending.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	m_modelCache.Collect();
+	m_textureCache.Collect();
+
+	for (PendingLoad& load : finished)
+	{
+		std::shared_ptr<Model> model;
+		try
+		{
+			model = Upload(*load.decoded.get());
+		}
+		catch (const std::exception& _exception)
+		{
+			std::cout << "Failed to load " << load.modelPath << ": " << _exception.what() << std::endl;
+		}
+
+		// Cache hits may still be uploading for an earlier load, the current token covers them as well.
+		m_uploading.push_back({ model, stagingRing.GetToken(), std::move(load.result), std::move(load.callback) });
+	}
+
+	for (UploadingLoad& load : completed)
+	{
+		load.result.set_value(load.model);
+		if (load.callback)
+		{
+			load.callback(load.model);
+		}
+	}
+}
+
+std::shared_ptr<Model> AssetLoader::Upload(const DecodedAsset& _asset)
+{
+	if (_asset.cachedModel)
+		return _asset.cachedModel;
+
+	auto model = std::make_unique<Model>(m_device, _asset.meshData);
+
+	if (_asset.hasTexture)
+	{
+		std::shared_ptr<Texture> texture = _asset.cachedTexture;
+		if (!texture)
+		{
+			auto newTexture = std::make_unique<Texture>();
+			newTexture->LoadFromPixels(_asset.image, m_device, m_device.GetGraphicsQueue());
+			VkDeviceSize textureSize = newTexture->GetMemorySize();
+			texture = m_textureCache.Insert(_asset.textureKey, std::move(newTexture), textureSize);
+		}
+		model->SetTexture(texture);
+		model->SetTextureDescriptorSet(CreateTextureDescriptorSet(*texture));
+	}
+
+	VkDeviceSize modelSize = model->GetMemorySize();
+	return m_modelCache.Insert(_asset.modelKey, std::move(model), modelSize);
+}
+
+std::shared_ptr<DescriptorPool> AssetLoader::CreateTexturePool(Device& _device)
+{
+	return DescriptorPool::Builder(_device)
+		.SetMaxSets(100)
+		.AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
+		.SetPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+		.Build();
+}
+
+void AssetLoader::DestroyModel(Device& _device, const std::shared_ptr<DescriptorPool>& _texturePool, Model* _model)
+{
+	// The set stays bound by the frames in flight, the pool is kept alive until it is freed.
+	if (_model->GetTextureDescriptorSet() != VK_NULL_HANDLE)
+	{
+		_device.GetDeletionQueue().Push([texturePool = _texturePool, descriptorSet = _model->GetTextureDescriptorSet()]()
+			{
+				std::vector<VkDescriptorSet> descriptorSets{ descriptorSet };
+				texturePool->FreeDescriptors(descriptorSets);
+			});
+	}
+	delete _model;
+}
+
+VkDescriptorSet AssetLoader::CreateTextureDescriptorSet(const Texture& _texture)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = _texture.GetImageView();
+	imageInfo.sampler = _texture.GetSampler();
+
+	VkDescriptorSet descriptorSet;
+	if (!DescriptorWriter(*m_textureSetLayout, *m_texturePool)
+		.WriteImage(0, &imageInfo)
+		.Build(descriptorSet))
+		throw std::runtime_error("failed to allocate texture descriptor set");
+
+	return descriptorSet;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "model/Model.h"
+#include "model/AssetCache.h"
+#include "model/GltfImporter.h"
+#include "core/Device.h"
+#include "core/Descriptors.h"
+#include "core/MappedFile.h"
+#include "core/StagingRing.h"
+#include "core/Texture.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Loads models and their texture off the render thread. Mesh import, cooked file reads and image decoding run on the
+// shared thread pool, then Update creates the GPU resources on the render thread, a few loads per frame, and hands the
+// model to the completion callback once the staging ring batch holding its copies has run. Until then callers draw
+// the placeholder.
+// Models and textures go through content keyed caches, loading the same files again returns the same GPU resources.
+class AssetLoader
+{
+public:
+	using Callback = std::function<void(std::shared_ptr<Model>)>;
+
+	// One model of an imported scene, placed by the world transform of its node.
+	struct SceneInstance
+	{
+		std::string name;
+		std::shared_ptr<Model> model;
+		glm::mat4 transform{ 1.0f };
+		glm::vec3 color{ 1.0f };
+	};
+
+	AssetLoader(Device& _device);
+	// Completes every outstanding future, with a null model for the loads still decoding. Callbacks are dropped.
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// Returns immediately, _texturePath may be empty. The callback runs and the future completes from Update, with a
+	// null model when the load failed.
+	std::shared_future<std::shared_ptr<Model>> LoadModelAsync(const std::string& _modelPath, const std::string& _texturePath, Callback _callback = nullptr);
+
+	// Blocking version for scene setup, shares the caches with the asynchronous loads.
+	std::shared_ptr<Model> LoadModel(const std::string& _modelPath, const std::string& _texturePath);
+
+	// Imports a glTF scene, one instance per primitive of every node with a mesh. Blocking, but vertices are converted
+	// from the mapped file straight into the upload memory so it stays far cheaper than an OBJ of the same size.
+	// Throws std::runtime_error when the file cannot be read.
+	std::vector<SceneInstance> LoadScene(const std::string& _filePath);
+
+	// Uploads the decoded loads and runs their callbacks, then destroys the released assets.
+	// Once per frame from the render thread, outside of recording.
+	void Update();
+
+	// Grey cube shown while a load is pending, with a flat grey texture for textured loads.
+	std::shared_ptr<Model> GetPlaceholderModel() const { return m_placeholderModel; }
+	VkDescriptorSet GetPlaceholderTextureDescriptorSet() const { return m_placeholderTextureSet; }
+	bool IsPlaceholder(const std::shared_ptr<Model>& _model) const { return _model == m_placeholderModel; }
+
+	uint32_t GetPendingCount() const { return static_cast<uint32_t>(m_pending.size() + m_uploading.size()); }
+	AssetCache<Model>::Stats GetModelCacheStats() const { return m_modelCache.GetStats(); }
+	AssetCache<Texture>::Stats GetTextureCacheStats() const { return m_textureCache.GetStats(); }
+
+private:
+	// Everything the workers produce, the mesh data points into cookedFile or builder. Cache hits skip the decoding.
+	struct DecodedAsset
+	{
+		std::string modelKey;
+		std::shared_ptr<Model> cachedModel;
+		std::string textureKey;
+		std::shared_ptr<Texture> cachedTexture;
+
+		MappedFile cookedFile;
+		Model::Builder builder;
+		Model::MeshData meshData;
+		bool hasTexture = false;
+		Texture::ImageData image;
+	};
+
+	struct PendingLoad
+	{
+		std::string modelPath;
+		std::future<std::unique_ptr<DecodedAsset>> decoded;
+		std::promise<std::shared_ptr<Model>> result;
+		Callback callback;
+	};
+
+	// Created, but its copies may still be running on the transfer queue.
+	struct UploadingLoad
+	{
+		std::shared_ptr<Model> model;
+		StagingRing::Token token = 0;
+		std::promise<std::shared_ptr<Model>> result;
+		Callback callback;
+	};
+
+	// Uploads only record copies into the staging ring now, this bounds the vertex conversion and buffer creation
+	// done in one frame.
+	static constexpr uint32_t MAX_UPLOADS_PER_UPDATE = 4;
+
+	void CreatePlaceholders();
+	// Thread safe, everything but the GPU work.
+	std::unique_ptr<DecodedAsset> Decode(const std::string& _modelPath, const std::string& _texturePath);
+	std::shared_ptr<Model> Upload(const DecodedAsset& _asset);
+	VkDescriptorSet CreateTextureDescriptorSet(const Texture& _texture);
+	std::shared_ptr<Model> UploadScenePrimitive(const GltfImporter& _importer, const std::string& _fileKey, const std::string& _key, const GltfImporter::Primitive& _primitive);
+	// Null when the image cannot be decoded, the primitive is then drawn untextured.
+	std::shared_ptr<Texture> LoadSceneTexture(const GltfImporter& _importer, const std::string& _fileKey, int32_t _image);
+	static std::shared_ptr<DescriptorPool> CreateTexturePool(Device& _device);
+	static void DestroyModel(Device& _device, const std::shared_ptr<DescriptorPool>& _texturePool, Model* _model);
+
+	Device& m_device;
+	std::unique_ptr<DescriptorSetLayout> m_textureSetLayout;
+	// Shared with the deletion queue, which frees the sets of destroyed models after the loader may be gone.
+	std::shared_ptr<DescriptorPool> m_texturePool;
+
+	// Declared after the pool, cached models free their descriptor set into it.
+	AssetCache<Texture> m_textureCache{};
+	AssetCache<Model> m_modelCache;
+
+	std::shared_ptr<Model> m_placeholderModel;
+	std::shared_ptr<Texture> m_placeholderTexture;
+	VkDescriptorSet m_placeholderTextureSet = VK_NULL_HANDLE;
+
+	std::vector<PendingLoad> m_pending{};
+	// In upload order, so in token order.
+	std::vector<UploadingLoad> m_uploading{};
+};
@@ -0,0 +1,614 @@
+#include "model/GltfImporter.h"
+#include "model/Json.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace
+{
+	constexpr uint32_t COMPONENT_BYTE = 5120;
+	constexpr uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+	constexpr uint32_t COMPONENT_SHORT = 5122;
+	constexpr uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+	constexpr uint32_t COMPONENT_UNSIGNED_INT = 5125;
+	constexpr uint32_t COMPONENT_FLOAT = 5126;
+
+	constexpr uint32_t GLB_MAGIC = 0x46546C67;
+	constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+	constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+	constexpr int64_t MODE_TRIANGLES = 4;
+
+	uint32_t ReadUint32(const uint8_t* _data)
+	{
+		uint32_t value;
+		std::memcpy(&value, _data, sizeof(value));
+		return value;
+	}
+
+	uint32_t GetComponentSize(uint32_t _componentType)
+	{
+		switch (_componentType)
+		{
+		case COMPONENT_BYTE:
+		case COMPONENT_UNSIGNED_BYTE:
+			return 1;
+		case COMPONENT_SHORT:
+		case COMPONENT_UNSIGNED_SHORT:
+			return 2;
+		case COMPONENT_UNSIGNED_INT:
+		case COMPONENT_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	uint32_t GetComponentCount(const std::string& _type)
+	{
+		if (_type == "SCALAR") return 1;
+		if (_type == "VEC2") return 2;
+		if (_type == "VEC3") return 3;
+		if (_type == "VEC4") return 4;
+		if (_type == "MAT2") return 4;
+		if (_type == "MAT3") return 9;
+		if (_type == "MAT4") return 16;
+		return 0;
+	}
+
+	// Relative URIs may escape spaces and other characters as %XX.
+	std::string DecodeUri(const std::string& _uri)
+	{
+		std::string decoded{};
+		decoded.reserve(_uri.size());
+		for (size_t i = 0; i < _uri.size(); i++)
+		{
+			if (_uri[i] == '%' && i + 2 < _uri.size() && std::isxdigit(static_cast<unsigned char>(_uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(_uri[i + 2])))
+			{
+				decoded += static_cast<char>(std::stoi(_uri.substr(i + 1, 2), nullptr, 16));
+				i += 2;
+			}
+			else
+			{
+				decoded += _uri[i];
+			}
+		}
+		return decoded;
+	}
+
+	glm::mat4 ReadLocalTransform(const Json& _node)
+	{
+		const Json& matrix = _node["matrix"];
+		if (matrix.GetSize() == 16)
+		{
+			// Column major, as glm.
+			glm::mat4 transform{};
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					transform[column][row] = matrix[column * 4 + row].AsFloat();
+				}
+			}
+			return transform;
+		}
+
+		const Json& translation = _node["translation"];
+		const Json& rotation = _node["rotation"];
+		const Json& scale = _node["scale"];
+
+		glm::mat4 transform{ 1.0f };
+		if (translation.GetSize() == 3)
+		{
+			transform = glm::translate(transform, { translation[0].AsFloat(), translation[1].AsFloat(), translation[2].AsFloat() });
+		}
+		if (rotation.GetSize() == 4)
+		{
+			// Stored x, y, z, w while glm takes w first.
+			glm::quat quaternion{ rotation[3].AsFloat(1.0f), rotation[0].AsFloat(), rotation[1].AsFloat(), rotation[2].AsFloat() };
+			transform = transform * glm::mat4_cast(glm::normalize(quaternion));
+		}
+		if (scale.GetSize() == 3)
+		{
+			transform = glm::scale(transform, { scale[0].AsFloat(1.0f), scale[1].AsFloat(1.0f), scale[2].AsFloat(1.0f) });
+		}
+		return transform;
+	}
+}
+
+glm::vec4 GltfImporter::Accessor::Read(uint32_t _index) const
+{
+	const uint8_t* element = data + static_cast<size_t>(_index) * stride;
+	uint32_t readCount = std::min(componentCount, 4u);
+
+	glm::vec4 value{ 0.0f };
+	if (componentType == COMPONENT_FLOAT)
+	{
+		std::memcpy(&value, element, readCount * sizeof(float));
+		return value;
+	}
+
+	for (uint32_t i = 0; i < readCount; i++)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		{
+			float component = static_cast<int8_t>(element[i]);
+			value[i] = normalized ? std::max(component / 127.0f, -1.0f) : component;
+			break;
+		}
+		case COMPONENT_UNSIGNED_BYTE:
+		{
+			float component = element[i];
+			value[i] = normalized ? component / 255.0f : component;
+			break;
+		}
+		case COMPONENT_SHORT:
+		{
+			int16_t component;
+			std::memcpy(&component, element + i * sizeof(int16_t), sizeof(component));
+			value[i] = normalized ? std::max(component / 32767.0f, -1.0f) : component;
+			break;
+		}
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			uint16_t component;
+			std::memcpy(&component, element + i * sizeof(uint16_t), sizeof(component));
+			value[i] = normalized ? component / 65535.0f : component;
+			break;
+		}
+		case COMPONENT_UNSIGNED_INT:
+		{
+			value[i] = static_cast<float>(ReadUint32(element + i * sizeof(uint32_t)));
+			break;
+		}
+		}
+	}
+	return value;
+}
+
+bool GltfImporter::IsGltfFile(const std::string& _filePath)
+{
+	std::string extension = std::filesystem::path(_filePath).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char _character) { return static_cast<char>(std::tolower(_character)); });
+	return extension == ".glb" || extension == ".gltf";
+}
+
+void GltfImporter::Load(const std::string& _filePath)
+{
+	if (m_file.IsOpen())
+		throw std::runtime_error("glTF importer already holds a file");
+	if (!m_file.Open(_filePath))
+		throw std::runtime_error("failed to open glTF file: " + _filePath);
+
+	m_directory = std::filesystem::path(_filePath).parent_path().string();
+
+	const uint8_t* data = m_file.GetData();
+	size_t size = m_file.GetSize();
+	const char* jsonBegin = reinterpret_cast<const char*>(data);
+	const char* jsonEnd = jsonBegin + size;
+	const uint8_t* binaryChunk = nullptr;
+	size_t binaryChunkSize = 0;
+
+	if (size >= 12 && ReadUint32(data) == GLB_MAGIC)
+	{
+		// 12 bytes header then { length, type, data } chunks, the JSON one first and an optional binary one.
+		if (ReadUint32(data + 4) != 2)
+			throw std::runtime_error("unsupported GLB version: " + _filePath);
+
+		size_t length = std::min<size_t>(ReadUint32(data + 8), size);
+		jsonBegin = nullptr;
+		for (size_t offset = 12; offset + 8 <= length;)
+		{
+			size_t chunkSize = ReadUint32(data + offset);
+			uint32_t chunkType = ReadUint32(data + offset + 4);
+			const uint8_t* chunk = data + offset + 8;
+			if (chunkSize > length - offset - 8)
+				throw std::runtime_error("truncated GLB chunk: " + _filePath);
+
+			if (chunkType == GLB_CHUNK_JSON && !jsonBegin)
+			{
+				jsonBegin = reinterpret_cast<const char*>(chunk);
+				jsonEnd = jsonBegin + chunkSize;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && !binaryChunk)
+			{
+				binaryChunk = chunk;
+				binaryChunkSize = chunkSize;
+			}
+			offset += 8 + chunkSize;
+		}
+
+		if (!jsonBegin)
+			throw std::runtime_error("GLB file without a JSON chunk: " + _filePath);
+	}
+
+	Json document = Json::Parse(jsonBegin, jsonEnd);
+
+	if (document["asset"]["version"].AsString().compare(0, 2, "2.") != 0)
+		throw std::runtime_error("unsupported glTF version: " + _filePath);
+
+	// Required extensions change how the data must be read, none of them is implemented.
+	const Json& requiredExtensions = document["extensionsRequired"];
+	if (requiredExtensions.GetSize() > 0)
+		throw std::runtime_error("glTF file requires the unsupported extension " + requiredExtensions[0].AsString() + ": " + _filePath);
+
+	LoadBuffers(document, binaryChunk, binaryChunkSize);
+	LoadMaterials(document);
+	LoadMeshes(document);
+	LoadNodes(document);
+}
+
+void GltfImporter::LoadBuffers(const Json& _document, const uint8_t* _binaryChunk, size_t _binaryChunkSize)
+{
+	const Json& buffers = _document["buffers"];
+	for (size_t i = 0; i < buffers.GetSize(); i++)
+	{
+		const Json& buffer = buffers[i];
+		size_t byteLength = static_cast<size_t>(buffer["byteLength"].AsInt());
+
+		if (!buffer.Has("uri"))
+		{
+			// Only the first buffer of a GLB may live in its binary chunk, which can have a few bytes of padding more.
+			if (i != 0 || !_binaryChunk || byteLength > _binaryChunkSize)
+				throw std::runtime_error("glTF buffer " + std::to_string(i) + " has no data");
+			m_buffers.push_back({ _binaryChunk, byteLength, 0 });
+			continue;
+		}
+
+		const std::string& uri = buffer["uri"].AsString();
+		if (uri.compare(0, 5, "data:") == 0)
+			throw std::runtime_error("base64 glTF buffers are not supported, convert the file to GLB");
+
+		auto file = std::make_unique<MappedFile>();
+		std::string path = (std::filesystem::path(m_directory) / DecodeUri(uri)).string();
+		if (!file->Open(path) || file->GetSize() < byteLength)
+			throw std::runtime_error("failed to open glTF buffer: " + path);
+
+		m_buffers.push_back({ file->GetData(), byteLength, 0 });
+		m_bufferFiles.push_back(std::move(file));
+	}
+
+	const Json& bufferViews = _document["bufferViews"];
+	for (size_t i = 0; i < bufferViews.GetSize(); i++)
+	{
+		const Json& bufferView = bufferViews[i];
+		int64_t buffer = bufferView["buffer"].AsInt(-1);
+		size_t byteOffset = static_cast<size_t>(bufferView["byteOffset"].AsInt());
+		size_t byteLength = static_cast<size_t>(bufferView["byteLength"].AsInt());
+
+		if (buffer < 0 || buffer >= static_cast<int64_t>(m_buffers.size()) || byteOffset > m_buffers[buffer].size || byteLength > m_buffers[buffer].size - byteOffset)
+			throw std::runtime_error("glTF buffer view " + std::to_string(i) + " is out of its buffer");
+
+		m_bufferViews.push_back({ m_buffers[buffer].data + byteOffset, byteLength, static_cast<uint32_t>(bufferView["byteStride"].AsInt()) });
+	}
+}
+
+GltfImporter::Accessor GltfImporter::LoadAccessor(const Json& _document, int64_t _index) const
+{
+	if (_index < 0)
+		return {};
+
+	const Json& json = _document["accessors"][static_cast<size_t>(_index)];
+	if (!json.IsObject())
+		throw std::runtime_error("invalid glTF accessor " + std::to_string(_index));
+	if (json.Has("sparse"))
+		throw std::runtime_error("sparse glTF accessors are not supported");
+
+	Accessor accessor{};
+	accessor.count = static_cast<uint32_t>(json["count"].AsInt());
+	accessor.componentType = static_cast<uint32_t>(json["componentType"].AsInt());
+	accessor.componentCount = GetComponentCount(json["type"].AsString());
+	accessor.normalized = json["normalized"].AsBool();
+
+	uint32_t componentSize = GetComponentSize(accessor.componentType);
+	if (componentSize == 0 || accessor.componentCount == 0)
+		throw std::runtime_error("invalid glTF accessor " + std::to_string(_index));
+
+	const Json& min = json["min"];
+	const Json& max = json["max"];
+	if (min.GetSize() >= 3 && max.GetSize() >= 3)
+	{
+		accessor.hasBounds = true;
+		accessor.min = { min[0].AsFloat(), min[1].AsFloat(), min[2].AsFloat() };
+		accessor.max = { max[0].AsFloat(), max[1].AsFloat(), max[2].AsFloat() };
+	}
+
+	// Without a buffer view the spec fills the accessor with zeros, only seen with sparse data, treated as missing.
+	int64_t bufferViewIndex = json["bufferView"].AsInt(-1);
+	if (bufferViewIndex < 0)
+		return {};
+	if (bufferViewIndex >= static_cast<int64_t>(m_bufferViews.size()))
+		throw std::runtime_error("invalid glTF buffer view " + std::to_string(bufferViewIndex));
+
+	const BufferView& bufferView = m_bufferViews[bufferViewIndex];
+	uint32_t elementSize = componentSize * accessor.componentCount;
+	accessor.stride = bufferView.stride > 0 ? bufferView.stride : elementSize;
+
+	size_t byteOffset = static_cast<size_t>(json["byteOffset"].AsInt());
+	if (accessor.count > 0 && (byteOffset > bufferView.size || static_cast<size_t>(accessor.stride) * (accessor.count - 1) + elementSize > bufferView.size - byteOffset))
+		throw std::runtime_error("glTF accessor " + std::to_string(_index) + " is out of its buffer view");
+
+	accessor.data = bufferView.data + byteOffset;
+	return accessor;
+}
+
+void GltfImporter::LoadMaterials(const Json& _document)
+{
+	const Json& images = _document["images"];
+	for (size_t i = 0; i < images.GetSize(); i++)
+	{
+		const Json& json = images[i];
+		Image image{};
+
+		int64_t bufferView = json["bufferView"].AsInt(-1);
+		if (bufferView >= 0 && bufferView < static_cast<int64_t>(m_bufferViews.size()))
+		{
+			image.data = m_bufferViews[bufferView].data;
+			image.size = m_bufferViews[bufferView].size;
+		}
+		else if (json.Has("uri") && json["uri"].AsString().compare(0, 5, "data:") != 0)
+		{
+			image.path = (std::filesystem::path(m_directory) / DecodeUri(json["uri"].AsString())).string();
+		}
+		else
+		{
+			std::cout << "Skipping glTF image " << i << ", only buffer views and files are supported" << std::endl;
+		}
+		m_images.push_back(std::move(image));
+	}
+
+	const Json& textures = _document["textures"];
+	const Json& materials = _document["materials"];
+	for (size_t i = 0; i < materials.GetSize(); i++)
+	{
+		const Json& json = materials[i];
+		const Json& pbr = json["pbrMetallicRoughness"];
+
+		Material material{};
+		material.name = json["name"].AsString();
+
+		const Json& factor = pbr["baseColorFactor"];
+		if (factor.GetSize() == 4)
+		{
+			material.baseColorFactor = { factor[0].AsFloat(1.0f), factor[1].AsFloat(1.0f), factor[2].AsFloat(1.0f), factor[3].AsFloat(1.0f) };
+		}
+
+		int64_t texture = pbr["baseColorTexture"]["index"].AsInt(-1);
+		if (texture >= 0)
+		{
+			int64_t source = textures[static_cast<size_t>(texture)]["source"].AsInt(-1);
+			if (source >= 0 && source < static_cast<int64_t>(m_images.size()))
+			{
+				material.baseColorImage = static_cast<int32_t>(source);
+			}
+		}
+
+		m_materials.push_back(std::move(material));
+	}
+}
+
+void GltfImporter::LoadMeshes(const Json& _document)
+{
+	const Json& meshes = _document["meshes"];
+	for (size_t i = 0; i < meshes.GetSize(); i++)
+	{
+		Mesh mesh{};
+		mesh.name = meshes[i]["name"].AsString();
+
+		const Json& primitives = meshes[i]["primitives"];
+		for (size_t j = 0; j < primitives.GetSize(); j++)
+		{
+			const Json& json = primitives[j];
+			if (json["mode"].AsInt(MODE_TRIANGLES) != MODE_TRIANGLES)
+			{
+				std::cout << "Skipping glTF primitive " << j << " of mesh " << i << ", only triangle lists are supported" << std::endl;
+				continue;
+			}
+
+			const Json& attributes = json["attributes"];
+			Primitive primitive{};
+			primitive.positions = LoadAccessor(_document, attributes["POSITION"].AsInt(-1));
+			primitive.normals = LoadAccessor(_document, attributes["NORMAL"].AsInt(-1));
+			primitive.uvs = LoadAccessor(_document, attributes["TEXCOORD_0"].AsInt(-1));
+			primitive.colors = LoadAccessor(_document, attributes["COLOR_0"].AsInt(-1));
+			primitive.indices = LoadAccessor(_document, json["indices"].AsInt(-1));
+
+			const Accessor& positions = primitive.positions;
+			if (!positions.IsValid() || positions.count < 3)
+				continue;
+			if (positions.componentType != COMPONENT_FLOAT || positions.componentCount != 3)
+				throw std::runtime_error("glTF positions must be float triplets");
+
+			for (const Accessor* attribute : { &primitive.normals, &primitive.uvs, &primitive.colors })
+			{
+				if (attribute->IsValid() && attribute->count != positions.count)
+					throw std::runtime_error("glTF attributes of one primitive must have the same count");
+			}
+
+			Accessor& indices = primitive.indices;
+			if (indices.IsValid())
+			{
+				// Index views are tightly packed by the spec, so the accessor is the index buffer as is.
+				uint32_t indexSize = GetComponentSize(indices.componentType);
+				if (indices.componentCount != 1 || indices.componentType == COMPONENT_BYTE || indices.componentType == COMPONENT_SHORT || indices.componentType == COMPONENT_FLOAT || indices.stride != indexSize)
+					throw std::runtime_error("invalid glTF index accessor");
+				if (indices.count % 3 != 0)
+					throw std::runtime_error("glTF triangle list index count must be a multiple of 3");
+
+				// Checked here so a broken file cannot make the GPU read past the vertex range.
+				uint32_t maxIndex = 0;
+				for (uint32_t k = 0; k < indices.count; k++)
+				{
+					uint32_t index;
+					if (indexSize == 1)
+					{
+						index = indices.data[k];
+					}
+					else if (indexSize == 2)
+					{
+						uint16_t shortIndex;
+						std::memcpy(&shortIndex, indices.data + k * sizeof(uint16_t), sizeof(shortIndex));
+						index = shortIndex;
+					}
+					else
+					{
+						index = ReadUint32(indices.data + k * sizeof(uint32_t));
+					}
+					maxIndex = std::max(maxIndex, index);
+				}
+				if (maxIndex >= positions.count)
+					throw std::runtime_error("glTF index out of the vertex range");
+
+				if (indexSize == 1)
+				{
+					primitive.widenedIndices.assign(indices.data, indices.data + indices.count);
+				}
+			}
+			else if (positions.count % 3 != 0)
+			{
+				throw std::runtime_error("glTF triangle list vertex count must be a multiple of 3");
+			}
+
+			int64_t material = json["material"].AsInt(-1);
+			primitive.material = material < static_cast<int64_t>(m_materials.size()) ? static_cast<int32_t>(material) : -1;
+
+			mesh.primitives.push_back(std::move(primitive));
+		}
+
+		m_meshes.push_back(std::move(mesh));
+	}
+}
+
+void GltfImporter::LoadNodes(const Json& _document)
+{
+	const Json& nodes = _document["nodes"];
+	size_t nodeCount = nodes.GetSize();
+
+	std::vector<int32_t> parents(nodeCount, -1);
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		const Json& children = nodes[i]["children"];
+		for (size_t j = 0; j < children.GetSize(); j++)
+		{
+			int64_t child = children[j].AsInt(-1);
+			if (child < 0 || child >= static_cast<int64_t>(nodeCount) || child == static_cast<int64_t>(i) || parents[child] != -1)
+				throw std::runtime_error("invalid glTF node hierarchy");
+			parents[child] = static_cast<int32_t>(i);
+		}
+	}
+
+	// Only the default scene is imported, files without scenes get every root node.
+	std::vector<int32_t> roots{};
+	const Json& scenes = _document["scenes"];
+	if (scenes.GetSize() > 0)
+	{
+		const Json& sceneNodes = scenes[static_cast<size_t>(_document["scene"].AsInt(0))]["nodes"];
+		for (size_t i = 0; i < sceneNodes.GetSize(); i++)
+		{
+			int64_t node = sceneNodes[i].AsInt(-1);
+			if (node >= 0 && node < static_cast<int64_t>(nodeCount) && parents[node] == -1)
+				roots.push_back(static_cast<int32_t>(node));
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			if (parents[i] == -1)
+				roots.push_back(static_cast<int32_t>(i));
+		}
+	}
+
+	// Depth first from the roots so parents are output, and their world transform computed, before their children.
+	// Every node has at most one parent, the walk cannot loop.
+	std::vector<std::pair<int32_t, int32_t>> stack{};
+	for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+	{
+		stack.push_back({ *it, -1 });
+	}
+
+	while (!stack.empty())
+	{
+		auto [index, parent] = stack.back();
+		stack.pop_back();
+
+		const Json& json = nodes[index];
+		Node node{};
+		node.name = json["name"].AsString();
+		node.parent = parent;
+		node.local = ReadLocalTransform(json);
+		node.world = parent >= 0 ? m_nodes[parent].world * node.local : node.local;
+
+		int64_t mesh = json["mesh"].AsInt(-1);
+		node.mesh = mesh < static_cast<int64_t>(m_meshes.size()) ? static_cast<int32_t>(mesh) : -1;
+
+		int32_t outputIndex = static_cast<int32_t>(m_nodes.size());
+		m_nodes.push_back(std::move(node));
+
+		const Json& children = json["children"];
+		for (size_t j = children.GetSize(); j-- > 0;)
+		{
+			stack.push_back({ static_cast<int32_t>(children[j].AsInt()), outputIndex });
+		}
+	}
+}
+
+Model::StreamData GltfImporter::GetStreamData(const Primitive& _primitive) const
+{
+	const Accessor& positions = _primitive.positions;
+
+	Model::StreamData data{};
+	data.vertexCount = positions.count;
+	data.readVertices = [&_primitive](uint32_t _first, uint32_t _count, Model::Vertex* _vertices)
+		{
+			for (uint32_t i = 0; i < _count; i++)
+			{
+				uint32_t index = _first + i;
+				Model::Vertex& vertex = _vertices[i];
+				vertex.position = glm::vec3(_primitive.positions.Read(index));
+				vertex.color = _primitive.colors.IsValid() ? glm::vec3(_primitive.colors.Read(index)) : glm::vec3{ 1.0f, 1.0f, 1.0f };
+				vertex.normal = _primitive.normals.IsValid() ? glm::vec3(_primitive.normals.Read(index)) : glm::vec3{ 0.0f, 0.0f, 1.0f };
+				vertex.uv = _primitive.uvs.IsValid() ? glm::vec2(_primitive.uvs.Read(index)) : glm::vec2{ 0.0f, 0.0f };
+			}
+		};
+
+	// Position bounds are mandatory in glTF, scanned only for files that skip them anyway.
+	if (positions.hasBounds)
+	{
+		data.boxMin = positions.min;
+		data.boxMax = positions.max;
+	}
+	else
+	{
+		data.boxMin = data.boxMax = glm::vec3(positions.Read(0));
+		for (uint32_t i = 1; i < positions.count; i++)
+		{
+			glm::vec3 position = glm::vec3(positions.Read(i));
+			data.boxMin = glm::min(data.boxMin, position);
+			data.boxMax = glm::max(data.boxMax, position);
+		}
+	}
+
+	const Accessor& indices = _primitive.indices;
+	if (!_primitive.widenedIndices.empty())
+	{
+		data.indices = _primitive.widenedIndices.data();
+		data.indexCount = static_cast<uint32_t>(_primitive.widenedIndices.size());
+		data.indexType = VK_INDEX_TYPE_UINT16;
+	}
+	else if (indices.IsValid())
+	{
+		data.indices = indices.data;
+		data.indexCount = indices.count;
+		data.indexType = indices.componentType == COMPONENT_UNSIGNED_SHORT ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+
+	return data;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "core/MappedFile.h"
+#include "model/Model.h"
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Json;
+
+// glTF 2.0 reader for binary .glb files and .gltf files with external .bin buffers. The files are mapped and accessors
+// are views into the mapping, nothing is copied until the vertices are written to the upload memory, so everything
+// returned stays valid as long as the importer.
+// Each primitive becomes its own model since it carries its own material, nodes keep their hierarchy.
+class GltfImporter
+{
+public:
+	struct Accessor
+	{
+		const uint8_t* data = nullptr;
+		uint32_t count = 0;
+		uint32_t stride = 0;
+		// GL enums of the glTF spec, GL_FLOAT, GL_UNSIGNED_SHORT...
+		uint32_t componentType = 0;
+		uint32_t componentCount = 0;
+		bool normalized = false;
+		bool hasBounds = false;
+		glm::vec3 min{};
+		glm::vec3 max{};
+
+		bool IsValid() const { return data != nullptr; }
+		// Converts the element to floats, normalized integers map to [0, 1] or [-1, 1], missing components read 0.
+		glm::vec4 Read(uint32_t _index) const;
+	};
+
+	struct Primitive
+	{
+		Accessor positions{};
+		Accessor normals{};
+		Accessor uvs{};
+		Accessor colors{};
+		Accessor indices{};
+		// 8-bit indices have no Vulkan index type, they are widened here at load.
+		std::vector<uint16_t> widenedIndices{};
+		int32_t material = -1;
+	};
+
+	struct Mesh
+	{
+		std::string name{};
+		std::vector<Primitive> primitives{};
+	};
+
+	struct Material
+	{
+		std::string name{};
+		glm::vec4 baseColorFactor{ 1.0f };
+		int32_t baseColorImage = -1;
+	};
+
+	// Either embedded in a buffer view or a file next to the glTF one.
+	struct Image
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		std::string path{};
+	};
+
+	struct Node
+	{
+		std::string name{};
+		int32_t parent = -1;
+		int32_t mesh = -1;
+		glm::mat4 local{ 1.0f };
+		glm::mat4 world{ 1.0f };
+	};
+
+	GltfImporter() = default;
+
+	GltfImporter(const GltfImporter&) = delete;
+	GltfImporter& operator=(const GltfImporter&) = delete;
+
+	static bool IsGltfFile(const std::string& _filePath);
+
+	// Throws std::runtime_error on malformed files or features outside of the core spec that change the geometry,
+	// sparse accessors, base64 buffers, Draco compression.
+	void Load(const std::string& _filePath);
+
+	// Reads the primitive straight from the mapped buffers, only valid while the importer lives.
+	Model::StreamData GetStreamData(const Primitive& _primitive) const;
+
+	const std::vector<Mesh>& GetMeshes() const { return m_meshes; }
+	const std::vector<Material>& GetMaterials() const { return m_materials; }
+	const std::vector<Image>& GetImages() const { return m_images; }
+	// Parents always come before their children.
+	const std::vector<Node>& GetNodes() const { return m_nodes; }
+
+private:
+	struct BufferView
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		uint32_t stride = 0;
+	};
+
+	void LoadBuffers(const Json& _document, const uint8_t* _binaryChunk, size_t _binaryChunkSize);
+	Accessor LoadAccessor(const Json& _document, int64_t _index) const;
+	void LoadMeshes(const Json& _document);
+	void LoadMaterials(const Json& _document);
+	void LoadNodes(const Json& _document);
+
+	std::string m_directory{};
+	MappedFile m_file{};
+	std::vector<std::unique_ptr<MappedFile>> m_bufferFiles{};
+	std::vector<BufferView> m_buffers{};
+	std::vector<BufferView> m_bufferViews{};
+
+	std::vector<Mesh> m_meshes{};
+	std::vector<Material> m_materials{};
+	std::vector<Image> m_images{};
+	std::vector<Node> m_nodes{};
+};
@@ -0,0 +1,311 @@
+#include "model/Json.h"
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+	const Json s_null{};
+
+	// Deep enough for any glTF file, low enough that a malicious one cannot overflow the stack.
+	constexpr uint32_t MAX_DEPTH = 256;
+}
+
+class Json::Parser
+{
+public:
+	Parser(const char* _begin, const char* _end) : m_begin{ _begin }, m_current{ _begin }, m_end{ _end } {}
+
+	Json ParseDocument()
+	{
+		Json value = ParseValue(0);
+		SkipWhitespace();
+		if (m_current != m_end)
+			Fail("trailing characters");
+		return value;
+	}
+
+private:
+	[[noreturn]] void Fail(const char* _message) const
+	{
+		throw std::runtime_error(std::string("invalid JSON at byte ") + std::to_string(m_current - m_begin) + ": " + _message);
+	}
+
+	void SkipWhitespace()
+	{
+		while (m_current != m_end && (*m_current == ' ' || *m_current == '\t' || *m_current == '\n' || *m_current == '\r'))
+			m_current++;
+	}
+
+	void Expect(char _character)
+	{
+		SkipWhitespace();
+		if (m_current == m_end || *m_current != _character)
+			Fail("unexpected character");
+		m_current++;
+	}
+
+	bool Consume(const char* _literal)
+	{
+		const char* current = m_current;
+		for (; *_literal; _literal++, current++)
+		{
+			if (current == m_end || *current != *_literal)
+				return false;
+		}
+		m_current = current;
+		return true;
+	}
+
+	Json ParseValue(uint32_t _depth)
+	{
+		if (_depth > MAX_DEPTH)
+			Fail("nesting too deep");
+
+		SkipWhitespace();
+		if (m_current == m_end)
+			Fail("unexpected end");
+
+		Json value{};
+		switch (*m_current)
+		{
+		case '{':
+			value.m_type = Type::Object;
+			ParseObject(value, _depth);
+			break;
+		case '[':
+			value.m_type = Type::Array;
+			ParseArray(value, _depth);
+			break;
+		case '"':
+			value.m_type = Type::String;
+			value.m_string = ParseString();
+			break;
+		case 't':
+		case 'f':
+			value.m_type = Type::Bool;
+			value.m_bool = *m_current == 't';
+			if (!Consume(value.m_bool ? "true" : "false"))
+				Fail("invalid literal");
+			break;
+		case 'n':
+			if (!Consume("null"))
+				Fail("invalid literal");
+			break;
+		default:
+			value.m_type = Type::Number;
+			value.m_number = ParseNumber();
+			break;
+		}
+		return value;
+	}
+
+	void ParseObject(Json& _object, uint32_t _depth)
+	{
+		m_current++;
+		SkipWhitespace();
+		if (m_current != m_end && *m_current == '}')
+		{
+			m_current++;
+			return;
+		}
+
+		while (true)
+		{
+			SkipWhitespace();
+			if (m_current == m_end || *m_current != '"')
+				Fail("expected a member name");
+			_object.m_keys.push_back(ParseString());
+			Expect(':');
+			_object.m_values.push_back(ParseValue(_depth + 1));
+
+			SkipWhitespace();
+			if (m_current != m_end && *m_current == ',')
+			{
+				m_current++;
+				continue;
+			}
+			Expect('}');
+			return;
+		}
+	}
+
+	void ParseArray(Json& _array, uint32_t _depth)
+	{
+		m_current++;
+		SkipWhitespace();
+		if (m_current != m_end && *m_current == ']')
+		{
+			m_current++;
+			return;
+		}
+
+		while (true)
+		{
+			_array.m_values.push_back(ParseValue(_depth + 1));
+
+			SkipWhitespace();
+			if (m_current != m_end && *m_current == ',')
+			{
+				m_current++;
+				continue;
+			}
+			Expect(']');
+			return;
+		}
+	}
+
+	double ParseNumber()
+	{
+		// strtod needs a terminated string, numbers are short so copy the candidate characters.
+		char buffer[64];
+		size_t length = 0;
+		while (m_current + length != m_end && length < sizeof(buffer) - 1)
+		{
+			char character = m_current[length];
+			if ((character < '0' || character > '9') && character != '-' && character != '+' && character != '.' && character != 'e' && character != 'E')
+				break;
+			buffer[length++] = character;
+		}
+		buffer[length] = '\0';
+
+		char* numberEnd = nullptr;
+		double number = std::strtod(buffer, &numberEnd);
+		if (length == 0 || numberEnd != buffer + length)
+			Fail("invalid number");
+
+		m_current += length;
+		return number;
+	}
+
+	uint32_t ParseHex4()
+	{
+		if (m_end - m_current < 4)
+			Fail("truncated escape");
+
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++, m_current++)
+		{
+			char character = *m_current;
+			value <<= 4;
+			if (character >= '0' && character <= '9')
+				value |= character - '0';
+			else if (character >= 'a' && character <= 'f')
+				value |= character - 'a' + 10;
+			else if (character >= 'A' && character <= 'F')
+				value |= character - 'A' + 10;
+			else
+				Fail("invalid escape");
+		}
+		return value;
+	}
+
+	static void AppendUtf8(std::string& _string, uint32_t _codePoint)
+	{
+		if (_codePoint < 0x80)
+		{
+			_string += static_cast<char>(_codePoint);
+		}
+		else if (_codePoint < 0x800)
+		{
+			_string += static_cast<char>(0xC0 | (_codePoint >> 6));
+			_string += static_cast<char>(0x80 | (_codePoint & 0x3F));
+		}
+		else if (_codePoint < 0x10000)
+		{
+			_string += static_cast<char>(0xE0 | (_codePoint >> 12));
+			_string += static_cast<char>(0x80 | ((_codePoint >> 6) & 0x3F));
+			_string += static_cast<char>(0x80 | (_codePoint & 0x3F));
+		}
+		else
+		{
+			_string += static_cast<char>(0xF0 | (_codePoint >> 18));
+			_string += static_cast<char>(0x80 | ((_codePoint >> 12) & 0x3F));
+			_string += static_cast<char>(0x80 | ((_codePoint >> 6) & 0x3F));
+			_string += static_cast<char>(0x80 | (_codePoint & 0x3F));
+		}
+	}
+
+	std::string ParseString()
+	{
+		m_current++;
+		std::string string{};
+		while (true)
+		{
+			if (m_current == m_end)
+				Fail("unterminated string");
+
+			char character = *m_current++;
+			if (character == '"')
+				return string;
+			if (character != '\\')
+			{
+				string += character;
+				continue;
+			}
+
+			if (m_current == m_end)
+				Fail("unterminated string");
+			switch (*m_current++)
+			{
+			case '"': string += '"'; break;
+			case '\\': string += '\\'; break;
+			case '/': string += '/'; break;
+			case 'b': string += '\b'; break;
+			case 'f': string += '\f'; break;
+			case 'n': string += '\n'; break;
+			case 'r': string += '\r'; break;
+			case 't': string += '\t'; break;
+			case 'u':
+			{
+				uint32_t codePoint = ParseHex4();
+				// Characters outside the basic plane come as a surrogate pair.
+				if (codePoint >= 0xD800 && codePoint < 0xDC00 && Consume("\\u"))
+				{
+					uint32_t low = ParseHex4();
+					if (low < 0xDC00 || low >= 0xE000)
+						Fail("invalid surrogate pair");
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUtf8(string, codePoint);
+				break;
+			}
+			default:
+				Fail("invalid escape");
+			}
+		}
+	}
+
+	const char* m_begin;
+	const char* m_current;
+	const char* m_end;
+};
+
+Json Json::Parse(const char* _begin, const char* _end)
+{
+	return Parser{ _begin, _end }.ParseDocument();
+}
+
+bool Json::Has(const std::string& _key) const
+{
+	for (const std::string& key : m_keys)
+	{
+		if (key == _key)
+			return true;
+	}
+	return false;
+}
+
+const Json& Json::operator[](const std::string& _key) const
+{
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		if (m_keys[i] == _key)
+			return m_values[i];
+	}
+	return s_null;
+}
+
+const Json& Json::operator[](size_t _index) const
+{
+	return _index < m_values.size() ? m_values[_index] : s_null;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Small read-only JSON document, enough for glTF headers. Lookups of missing members or out of range elements return
+// a null value instead of throwing, so optional properties read as their default.
+class Json
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	// Throws std::runtime_error with the byte offset of the first syntax error.
+	static Json Parse(const char* _begin, const char* _end);
+
+	Type GetType() const { return m_type; }
+	bool IsNull() const { return m_type == Type::Null; }
+	bool IsArray() const { return m_type == Type::Array; }
+	bool IsObject() const { return m_type == Type::Object; }
+
+	// Members in file order for objects, elements for arrays.
+	size_t GetSize() const { return m_values.size(); }
+	bool Has(const std::string& _key) const;
+	const Json& operator[](const std::string& _key) const;
+	const Json& operator[](size_t _index) const;
+
+	bool AsBool(bool _default = false) const { return m_type == Type::Bool ? m_bool : _default; }
+	double AsNumber(double _default = 0.0) const { return m_type == Type::Number ? m_number : _default; }
+	float AsFloat(float _default = 0.0f) const { return static_cast<float>(AsNumber(_default)); }
+	int64_t AsInt(int64_t _default = 0) const { return m_type == Type::Number ? static_cast<int64_t>(m_number) : _default; }
+	const std::string& AsString() const { return m_string; }
+
+private:
+	class Parser;
+
+	Type m_type = Type::Null;
+	bool m_bool = false;
+	double m_number = 0.0;
+	std::string m_string{};
+	// Object keys match m_values one to one.
+	std::vector<std::string> m_keys{};
+	std::vector<Json> m_values{};
+};
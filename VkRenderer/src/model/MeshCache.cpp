@@ -0,0 +1,250 @@
+#include "model/MeshCache.h"
+#include "core/Utils.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	const char* CACHE_DIRECTORY = "cache";
+	const uint32_t COOKED_MESH_MAGIC = 0x48534D56; // "VMSH"
+	const uint64_t BLOB_ALIGNMENT = 16;
+
+	struct CookedMeshHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+		uint64_t sourceHash;
+		uint32_t vertexSize;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t lodCount;
+		uint32_t indexSize;
+		uint32_t meshletCount;
+		Model::Bounds bounds;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t lodOffset;
+		uint64_t meshletOffset;
+	};
+
+	uint64_t AlignOffset(uint64_t _offset)
+	{
+		return (_offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+	}
+
+	bool IsBlobInFile(uint64_t _offset, uint64_t _size, size_t _fileSize)
+	{
+		return _offset % BLOB_ALIGNMENT == 0 && _offset <= _fileSize && _size <= _fileSize - _offset;
+	}
+
+	bool IsRangeInIndices(uint64_t _first, uint64_t _count, uint32_t _indexCount)
+	{
+		return _first <= _indexCount && _count <= _indexCount - _first;
+	}
+
+	template <typename T>
+	bool AreIndicesInVertices(const uint8_t* _indices, uint32_t _indexCount, uint32_t _vertexCount)
+	{
+		const T* indices = reinterpret_cast<const T*>(_indices);
+		for (uint32_t i = 0; i < _indexCount; i++)
+		{
+			if (indices[i] >= _vertexCount)
+				return false;
+		}
+		return true;
+	}
+
+	// The blobs lie in the file, now what they reference must lie in the blobs. A stale or corrupted file failing
+	// here is a cache miss, not an out of range draw.
+	bool AreRangesValid(const CookedMeshHeader& _header, const uint8_t* _data)
+	{
+		if (_header.lodCount == 0 || _header.lodCount > Model::MAX_LODS)
+			return false;
+
+		const Model::Lod* lods = reinterpret_cast<const Model::Lod*>(_data + _header.lodOffset);
+		for (uint32_t i = 0; i < _header.lodCount; i++)
+		{
+			if (!IsRangeInIndices(lods[i].firstIndex, lods[i].indexCount, _header.indexCount))
+				return false;
+		}
+
+		const Model::Meshlet* meshlets = reinterpret_cast<const Model::Meshlet*>(_data + _header.meshletOffset);
+		for (uint32_t i = 0; i < _header.meshletCount; i++)
+		{
+			if (!IsRangeInIndices(meshlets[i].firstIndex, uint64_t(meshlets[i].triangleCount) * 3, _header.indexCount))
+				return false;
+		}
+
+		const uint8_t* indices = _data + _header.indexOffset;
+		if (_header.indexSize == sizeof(uint16_t))
+			return AreIndicesInVertices<uint16_t>(indices, _header.indexCount, _header.vertexCount);
+		return AreIndicesInVertices<uint32_t>(indices, _header.indexCount, _header.vertexCount);
+	}
+}
+
+std::string MeshCache::GetCachePath(const std::string& _sourcePath)
+{
+	// Flatten the relative path so models with the same name in different folders do not share a file.
+	std::string name = std::filesystem::path(_sourcePath).lexically_normal().generic_string();
+	for (char& c : name)
+	{
+		if (c == '/' || c == ':')
+			c = '_';
+	}
+
+	return (std::filesystem::path(CACHE_DIRECTORY) / (name + ".mesh")).string();
+}
+
+bool MeshCache::GetSourceStamp(const std::string& _sourcePath, SourceStamp& _stamp)
+{
+	std::error_code error{};
+	_stamp.size = std::filesystem::file_size(_sourcePath, error);
+	if (error)
+		return false;
+
+	_stamp.writeTime = static_cast<int64_t>(std::filesystem::last_write_time(_sourcePath, error).time_since_epoch().count());
+	return !error;
+}
+
+uint64_t MeshCache::HashSourceFile(const std::string& _sourcePath)
+{
+	MappedFile source{};
+	if (!source.Open(_sourcePath))
+		return 0;
+
+	return Utils::HashBytes(source.GetData(), source.GetSize());
+}
+
+bool MeshCache::Load(const std::string& _cachePath, const std::string& _sourcePath, MappedFile& _file, Model::MeshData& _data)
+{
+	SourceStamp stamp{};
+	if (!GetSourceStamp(_sourcePath, stamp) || !_file.Open(_cachePath))
+		return false;
+
+	const size_t fileSize = _file.GetSize();
+	if (fileSize < sizeof(CookedMeshHeader))
+	{
+		_file.Close();
+		return false;
+	}
+
+	const CookedMeshHeader* header = reinterpret_cast<const CookedMeshHeader*>(_file.GetData());
+
+	bool valid = header->magic == COOKED_MESH_MAGIC &&
+		header->version == LOADER_VERSION &&
+		header->sourceSize == stamp.size &&
+		header->vertexSize == sizeof(Model::Vertex) &&
+		IsBlobInFile(header->vertexOffset, uint64_t(header->vertexCount) * sizeof(Model::Vertex), fileSize) &&
+		(header->indexSize == sizeof(uint16_t) || header->indexSize == sizeof(uint32_t)) &&
+		IsBlobInFile(header->indexOffset, uint64_t(header->indexCount) * header->indexSize, fileSize) &&
+		IsBlobInFile(header->lodOffset, uint64_t(header->lodCount) * sizeof(Model::Lod), fileSize) &&
+		IsBlobInFile(header->meshletOffset, uint64_t(header->meshletCount) * sizeof(Model::Meshlet), fileSize) &&
+		AreRangesValid(*header, _file.GetData());
+
+	// A copy or a checkout changes the time alone, the content decides then.
+	if (valid && header->sourceWriteTime != stamp.writeTime)
+		valid = header->sourceHash == HashSourceFile(_sourcePath);
+
+	if (!valid)
+	{
+		_file.Close();
+		return false;
+	}
+
+	_data.vertices = reinterpret_cast<const Model::Vertex*>(_file.GetData() + header->vertexOffset);
+	_data.vertexCount = header->vertexCount;
+	_data.indices = _file.GetData() + header->indexOffset;
+	_data.indexCount = header->indexCount;
+	_data.indexType = header->indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	_data.lods = reinterpret_cast<const Model::Lod*>(_file.GetData() + header->lodOffset);
+	_data.lodCount = header->lodCount;
+	_data.meshlets = reinterpret_cast<const Model::Meshlet*>(_file.GetData() + header->meshletOffset);
+	_data.meshletCount = header->meshletCount;
+	_data.bounds = header->bounds;
+	return true;
+}
+
+bool MeshCache::Save(const std::string& _cachePath, const std::string& _sourcePath, const Model::Builder& _builder)
+{
+	SourceStamp stamp{};
+	uint64_t sourceHash = HashSourceFile(_sourcePath);
+	if (sourceHash == 0 || !GetSourceStamp(_sourcePath, stamp))
+		return false;
+
+	CookedMeshHeader header{};
+	header.magic = COOKED_MESH_MAGIC;
+	header.version = LOADER_VERSION;
+	header.sourceSize = stamp.size;
+	header.sourceWriteTime = stamp.writeTime;
+	header.sourceHash = sourceHash;
+	header.vertexSize = sizeof(Model::Vertex);
+	header.vertexCount = static_cast<uint32_t>(_builder.vertices.size());
+	header.indexCount = static_cast<uint32_t>(_builder.indices.size());
+	header.lodCount = static_cast<uint32_t>(_builder.lods.size());
+	header.indexSize = Model::GetIndexSize(Model::SelectIndexType(header.vertexCount));
+	header.meshletCount = static_cast<uint32_t>(_builder.meshlets.size());
+	header.bounds = _builder.bounds;
+	header.vertexOffset = AlignOffset(sizeof(CookedMeshHeader));
+	header.indexOffset = AlignOffset(header.vertexOffset + uint64_t(header.vertexCount) * sizeof(Model::Vertex));
+	header.lodOffset = AlignOffset(header.indexOffset + uint64_t(header.indexCount) * header.indexSize);
+	header.meshletOffset = AlignOffset(header.lodOffset + uint64_t(header.lodCount) * sizeof(Model::Lod));
+
+	// Stored in the type Model uploads so a warm load needs no conversion.
+	std::vector<uint16_t> narrowedIndices{};
+	if (header.indexSize == sizeof(uint16_t))
+	{
+		narrowedIndices.resize(_builder.indices.size());
+		for (size_t i = 0; i < _builder.indices.size(); i++)
+		{
+			narrowedIndices[i] = static_cast<uint16_t>(_builder.indices[i]);
+		}
+	}
+	const void* indexData = narrowedIndices.empty() ? static_cast<const void*>(_builder.indices.data()) : narrowedIndices.data();
+
+	std::error_code error{};
+	std::filesystem::create_directories(std::filesystem::path(_cachePath).parent_path(), error);
+
+	// Written aside then renamed, a crash mid-write must not leave a truncated file with a valid header.
+	std::string tempPath = _cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "Could not write mesh cache: " << _cachePath << std::endl;
+			return false;
+		}
+
+		auto writeBlob = [&](uint64_t _offset, const void* _blob, size_t _size)
+		{
+			static const char padding[BLOB_ALIGNMENT] = {};
+			uint64_t position = static_cast<uint64_t>(file.tellp());
+			file.write(padding, static_cast<std::streamsize>(_offset - position));
+			file.write(static_cast<const char*>(_blob), static_cast<std::streamsize>(_size));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeBlob(header.vertexOffset, _builder.vertices.data(), _builder.vertices.size() * sizeof(Model::Vertex));
+		writeBlob(header.indexOffset, indexData, _builder.indices.size() * header.indexSize);
+		writeBlob(header.lodOffset, _builder.lods.data(), _builder.lods.size() * sizeof(Model::Lod));
+		writeBlob(header.meshletOffset, _builder.meshlets.data(), _builder.meshlets.size() * sizeof(Model::Meshlet));
+
+		if (!file.good())
+		{
+			file.close();
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, _cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "model/Model.h"
+#include "core/MappedFile.h"
+#include <cstdint>
+#include <string>
+
+// Cooked mesh files: a header followed by the vertex, index, lod and meshlet blobs exactly as Model uploads them,
+// so a warm load is a file mapping and a memcpy into the staging buffers.
+class MeshCache
+{
+public:
+	// Bump whenever the import output changes (dedup, lod generation, index ordering, vertex layout...) to invalidate cooked files.
+	static constexpr uint32_t LOADER_VERSION = 5;
+
+	static std::string GetCachePath(const std::string& _sourcePath);
+
+	// On success _data points into _file, which must stay open while the data is used. The cooked file matches when it
+	// was stamped with the size and modification time of the source, the source is only hashed when the time differs,
+	// so a touched but unchanged file still hits.
+	static bool Load(const std::string& _cachePath, const std::string& _sourcePath, MappedFile& _file, Model::MeshData& _data);
+	static bool Save(const std::string& _cachePath, const std::string& _sourcePath, const Model::Builder& _builder);
+
+private:
+	struct SourceStamp
+	{
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+	};
+
+	static bool GetSourceStamp(const std::string& _sourcePath, SourceStamp& _stamp);
+	static uint64_t HashSourceFile(const std::string& _sourcePath);
+};
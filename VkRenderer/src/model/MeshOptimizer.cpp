@@ -0,0 +1,336 @@
+#include "model/MeshOptimizer.h"
+#include <algorithm>
+#include <cassert>
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* _indices, size_t _indexCount, size_t _vertexCount)
+{
+	CacheStats stats{};
+	if (_indexCount < 3)
+		return stats;
+
+	uint32_t fifo[CACHE_SIZE];
+	std::fill(fifo, fifo + CACHE_SIZE, ~0u);
+	uint32_t fifoHead = 0;
+
+	std::vector<bool> referenced(_vertexCount, false);
+	size_t referencedCount = 0;
+	size_t misses = 0;
+
+	for (size_t i = 0; i < _indexCount; i++)
+	{
+		uint32_t index = _indices[i];
+		assert(index < _vertexCount);
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			referencedCount++;
+		}
+
+		if (std::find(fifo, fifo + CACHE_SIZE, index) == fifo + CACHE_SIZE)
+		{
+			fifo[fifoHead] = index;
+			fifoHead = (fifoHead + 1) % CACHE_SIZE;
+			misses++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(_indexCount / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* _indices, size_t _indexCount, size_t _vertexCount)
+{
+	const size_t triangleCount = _indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles around each vertex, liveTriangles counts the ones not emitted yet.
+	std::vector<uint32_t> liveTriangles(_vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		assert(_indices[i] < _vertexCount);
+		liveTriangles[_indices[i]]++;
+	}
+
+	std::vector<uint32_t> offsets(_vertexCount + 1, 0);
+	for (size_t v = 0; v < _vertexCount; v++)
+	{
+		offsets[v + 1] = offsets[v] + liveTriangles[v];
+	}
+
+	std::vector<uint32_t> adjacency(offsets[_vertexCount]);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			adjacency[fill[_indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<uint32_t> result(triangleCount * 3);
+	size_t resultSize = 0;
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> timestamps(_vertexCount, 0);
+	uint32_t time = CACHE_SIZE + 1;
+
+	std::vector<uint32_t> deadEnds{};
+	std::vector<uint32_t> candidates{};
+	uint32_t cursor = 0;
+	uint32_t current = _indices[0];
+
+	while (current != ~0u)
+	{
+		candidates.clear();
+
+		// Emit the whole fan around the current vertex.
+		for (uint32_t a = offsets[current]; a < offsets[current + 1]; a++)
+		{
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle])
+				continue;
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				uint32_t vertex = _indices[triangle * 3 + k];
+				result[resultSize++] = vertex;
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+
+				if (time - timestamps[vertex] > CACHE_SIZE)
+				{
+					timestamps[vertex] = time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next fan: the candidate that stays longest in the cache while its remaining fan is emitted, falling back
+		// on the most recent dead end, then on the next vertex in input order.
+		uint32_t next = ~0u;
+		int bestPriority = -1;
+		for (uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			uint32_t cachePosition = time - timestamps[vertex];
+			if (cachePosition + 2 * liveTriangles[vertex] <= CACHE_SIZE)
+			{
+				priority = static_cast<int>(cachePosition);
+			}
+
+			if (priority > bestPriority)
+			{
+				next = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		while (next == ~0u && !deadEnds.empty())
+		{
+			uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0)
+			{
+				next = vertex;
+			}
+		}
+
+		while (next == ~0u && cursor < _vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				next = cursor;
+			}
+			cursor++;
+		}
+
+		current = next;
+	}
+
+	assert(resultSize == triangleCount * 3);
+	std::copy(result.begin(), result.end(), _indices);
+}
+
+uint32_t MeshOptimizer::UpdateCache(const uint32_t* _triangle, std::vector<uint32_t>& _timestamps, uint32_t& _time)
+{
+	uint32_t misses = 0;
+	for (size_t k = 0; k < 3; k++)
+	{
+		if (_time - _timestamps[_triangle[k]] > CACHE_SIZE)
+		{
+			_timestamps[_triangle[k]] = _time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+void MeshOptimizer::GenerateHardBoundaries(const uint32_t* _indices, size_t _indexCount, std::vector<uint32_t>& _timestamps, std::vector<uint32_t>& _clusters)
+{
+	std::fill(_timestamps.begin(), _timestamps.end(), 0);
+	uint32_t time = CACHE_SIZE + 1;
+
+	// Three misses in a row means the cache optimizer jumped to a disjoint patch, a natural cluster start.
+	for (size_t t = 0; t < _indexCount / 3; t++)
+	{
+		uint32_t misses = UpdateCache(_indices + t * 3, _timestamps, time);
+		if (t == 0 || misses == 3)
+		{
+			_clusters.push_back(static_cast<uint32_t>(t));
+		}
+	}
+}
+
+void MeshOptimizer::GenerateSoftBoundaries(const uint32_t* _indices, size_t _indexCount, const std::vector<uint32_t>& _hardClusters, float _threshold, std::vector<uint32_t>& _timestamps, std::vector<uint32_t>& _clusters)
+{
+	std::fill(_timestamps.begin(), _timestamps.end(), 0);
+	uint32_t time = 0;
+
+	for (size_t c = 0; c < _hardClusters.size(); c++)
+	{
+		size_t start = _hardClusters[c];
+		size_t end = c + 1 < _hardClusters.size() ? _hardClusters[c + 1] : _indexCount / 3;
+
+		// Moving time past the cache size flushes it.
+		time += CACHE_SIZE + 1;
+
+		uint32_t clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += UpdateCache(_indices + t * 3, _timestamps, time);
+		}
+
+		const float clusterThreshold = _threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+		// Cut as soon as the running ACMR is within the threshold of the whole cluster's.
+		_clusters.push_back(static_cast<uint32_t>(start));
+		const size_t firstSoftCluster = _clusters.size() - 1;
+
+		time += CACHE_SIZE + 1;
+		uint32_t runningMisses = 0;
+		uint32_t runningTriangles = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			runningMisses += UpdateCache(_indices + t * 3, _timestamps, time);
+			runningTriangles++;
+
+			if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold)
+			{
+				_clusters.push_back(static_cast<uint32_t>(t + 1));
+				time += CACHE_SIZE + 1;
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+
+		// The last cut may land on the end of the cluster, and a leftover tail did not reach the target ACMR,
+		// it is merged into the previous cluster rather than kept as a poor cluster of its own.
+		if (_clusters.size() - 1 > firstSoftCluster && (_clusters.back() == end || runningTriangles > 0))
+		{
+			_clusters.pop_back();
+		}
+	}
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* _indices, size_t _indexCount, const std::vector<Model::Vertex>& _vertices, float _threshold)
+{
+	const size_t triangleCount = _indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	std::vector<uint32_t> timestamps(_vertices.size(), 0);
+
+	std::vector<uint32_t> hardClusters{};
+	GenerateHardBoundaries(_indices, _indexCount, timestamps, hardClusters);
+
+	std::vector<uint32_t> clusters{};
+	GenerateSoftBoundaries(_indices, _indexCount, hardClusters, _threshold, timestamps, clusters);
+
+	if (clusters.size() < 2)
+		return;
+
+	glm::vec3 meshCentroid{ 0.0f };
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		meshCentroid += _vertices[_indices[i]].position;
+	}
+	meshCentroid /= static_cast<float>(triangleCount * 3);
+
+	// Clusters facing away from the mesh center are likely to be in front of the others from any viewpoint they are seen.
+	std::vector<float> sortKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		float clusterArea = 0.0f;
+		glm::vec3 clusterCentroid{ 0.0f };
+		glm::vec3 clusterNormal{ 0.0f };
+
+		for (size_t t = start; t < end; t++)
+		{
+			const glm::vec3& p0 = _vertices[_indices[t * 3 + 0]].position;
+			const glm::vec3& p1 = _vertices[_indices[t * 3 + 1]].position;
+			const glm::vec3& p2 = _vertices[_indices[t * 3 + 2]].position;
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+
+			clusterCentroid += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormal += normal;
+			clusterArea += area;
+		}
+
+		clusterCentroid = clusterArea > 0.0f ? clusterCentroid / clusterArea : clusterCentroid;
+		float normalLength = glm::length(clusterNormal);
+		clusterNormal = normalLength > 0.0f ? clusterNormal / normalLength : clusterNormal;
+
+		sortKeys[c] = glm::dot(clusterCentroid - meshCentroid, clusterNormal);
+	}
+
+	std::vector<uint32_t> order(clusters.size());
+	for (size_t c = 0; c < order.size(); c++)
+	{
+		order[c] = static_cast<uint32_t>(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b) { return sortKeys[_a] > sortKeys[_b]; });
+
+	std::vector<uint32_t> source(_indices, _indices + triangleCount * 3);
+	size_t resultSize = 0;
+	for (uint32_t c : order)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		std::copy(source.begin() + start * 3, source.begin() + end * 3, _indices + resultSize);
+		resultSize += (end - start) * 3;
+	}
+
+	assert(resultSize == triangleCount * 3);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Model::Vertex>& _vertices, std::vector<uint32_t>& _indices)
+{
+	std::vector<uint32_t> remap(_vertices.size(), ~0u);
+	std::vector<Model::Vertex> result{};
+	result.reserve(_vertices.size());
+
+	for (uint32_t& index : _indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(_vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	_vertices.swap(result);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "model/Model.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Import time index and vertex reordering for the post-transform cache and vertex fetch.
+// Every pass works on a triangle list and keeps the triangles themselves, only their order and the vertex order change.
+class MeshOptimizer
+{
+public:
+	// Entries of the post-transform cache assumed by the optimizer and the statistics.
+	static constexpr uint32_t CACHE_SIZE = 16;
+
+	struct CacheStats
+	{
+		// Average cache miss ratio: transformed vertices per triangle, 0.5 at best, 3 at worst.
+		float acmr = 0.0f;
+		// Average transform to vertex ratio: transformed vertices per referenced vertex, 1 at best.
+		float atvr = 0.0f;
+	};
+
+	// Simulates a FIFO cache of CACHE_SIZE entries over the triangle list.
+	static CacheStats AnalyzeVertexCache(const uint32_t* _indices, size_t _indexCount, size_t _vertexCount);
+
+	// Tipsify (Sander et al. 2007), fans around the last emitted vertices while they are likely still cached.
+	static void OptimizeVertexCache(uint32_t* _indices, size_t _indexCount, size_t _vertexCount);
+
+	// Splits a cache optimized list into clusters and sorts them front to back from the outside of the mesh,
+	// so convex parts tend to occlude the rest. _threshold is the ACMR loss accepted to get smaller clusters.
+	static void OptimizeOverdraw(uint32_t* _indices, size_t _indexCount, const std::vector<Model::Vertex>& _vertices, float _threshold = 1.05f);
+
+	// Renumbers vertices in order of first use and drops unreferenced ones, so fetches walk the vertex buffer forward.
+	static void OptimizeVertexFetch(std::vector<Model::Vertex>& _vertices, std::vector<uint32_t>& _indices);
+
+private:
+	static uint32_t UpdateCache(const uint32_t* _triangle, std::vector<uint32_t>& _timestamps, uint32_t& _time);
+	static void GenerateHardBoundaries(const uint32_t* _indices, size_t _indexCount, std::vector<uint32_t>& _timestamps, std::vector<uint32_t>& _clusters);
+	static void GenerateSoftBoundaries(const uint32_t* _indices, size_t _indexCount, const std::vector<uint32_t>& _hardClusters, float _threshold, std::vector<uint32_t>& _timestamps, std::vector<uint32_t>& _clusters);
+};
@@ -0,0 +1,666 @@
+// Quadric edge collapse simplification adapted from meshoptimizer's simplifier.cpp
+// (https://github.com/zeux/meshoptimizer), used under the MIT license below.
+//
+// MIT License
+//
+// Copyright (c) 2016-2024 Arseny Kapoulkine
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "model/MeshSimplifier.h"
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+	const uint32_t INVALID_VERTEX = ~0u;
+	const float EDGE_WEIGHT = 10.0f;
+	const float NORMAL_WEIGHT = 0.5f;
+
+	// Collapse of a vertex of kind [row] onto a vertex of kind [column].
+	const bool CAN_COLLAPSE[4][4] =
+	{
+		{ true,  true,  true,  true  },
+		{ false, true,  false, false },
+		{ false, false, true,  false },
+		{ false, false, false, false },
+	};
+
+	// Whether the edge between two kinds is seen from both of its triangles.
+	const bool HAS_OPPOSITE[4][4] =
+	{
+		{ true,  true,  true,  false },
+		{ true,  false, true,  false },
+		{ true,  true,  true,  false },
+		{ false, false, false, false },
+	};
+}
+
+MeshSimplifier::MeshSimplifier(const std::vector<Model::Vertex>& _vertices) : m_vertices{ _vertices }
+{
+	const size_t vertexCount = _vertices.size();
+
+	glm::vec3 minPosition{ FLT_MAX };
+	glm::vec3 maxPosition{ -FLT_MAX };
+	for (const auto& vertex : _vertices)
+	{
+		minPosition = glm::min(minPosition, vertex.position);
+		maxPosition = glm::max(maxPosition, vertex.position);
+	}
+
+	glm::vec3 extent = maxPosition - minPosition;
+	m_scale = std::max(extent.x, std::max(extent.y, extent.z));
+	float invScale = m_scale == 0.0f ? 0.0f : 1.0f / m_scale;
+
+	m_positions.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		m_positions[i] = (_vertices[i].position - minPosition) * invScale;
+	}
+
+	m_remap.resize(vertexCount);
+	m_wedge.resize(vertexCount);
+
+	std::unordered_map<glm::vec3, uint32_t> firstVertex{};
+	firstVertex.reserve(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		auto [it, inserted] = firstVertex.emplace(_vertices[i].position, i);
+		m_remap[i] = it->second;
+		m_wedge[i] = i;
+
+		if (!inserted)
+		{
+			uint32_t r = it->second;
+			m_wedge[i] = m_wedge[r];
+			m_wedge[r] = i;
+		}
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<uint32_t>& _indices, size_t _targetIndexCount, float _targetError, std::vector<uint32_t>& _result) const
+{
+	assert(_indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+
+	const size_t vertexCount = m_vertices.size();
+	_result = _indices;
+
+	Adjacency adjacency{};
+	BuildEdgeAdjacency(adjacency, _result, vertexCount);
+
+	std::vector<uint8_t> kinds{};
+	std::vector<uint32_t> loop{};
+	std::vector<uint32_t> loopback{};
+	ClassifyVertices(adjacency, kinds, loop, loopback);
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	FillQuadrics(_result, kinds, loop, loopback, quadrics);
+
+	std::vector<Collapse> collapses{};
+	std::vector<uint32_t> collapseOrder{};
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<uint8_t> collapseLocked(vertexCount);
+	Adjacency triangles{};
+
+	float errorLimit = _targetError * _targetError;
+	float resultError = 0.0f;
+
+	while (_result.size() > _targetIndexCount)
+	{
+		PickEdgeCollapses(_result, kinds, loop, collapses);
+		if (collapses.empty())
+		{
+			break;
+		}
+
+		RankEdgeCollapses(collapses, quadrics);
+
+		collapseOrder.resize(collapses.size());
+		std::iota(collapseOrder.begin(), collapseOrder.end(), 0u);
+		std::sort(collapseOrder.begin(), collapseOrder.end(), [&](uint32_t _a, uint32_t _b) { return collapses[_a].error < collapses[_b].error; });
+
+		BuildTriangleAdjacency(triangles, _result, m_remap, vertexCount);
+
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0u);
+		std::fill(collapseLocked.begin(), collapseLocked.end(), uint8_t(0));
+
+		size_t triangleCollapseGoal = (_result.size() - _targetIndexCount) / 3;
+		size_t edgeCollapseGoal = triangleCollapseGoal / 2;
+
+		// Collapsing everything in one pass would make quadrics inaccurate, each pass only takes the cheapest edges.
+		float errorGoal = edgeCollapseGoal < collapses.size() ? 1.5f * collapses[collapseOrder[edgeCollapseGoal]].error : FLT_MAX;
+
+		size_t triangleCollapses = 0;
+		size_t edgeCollapses = 0;
+
+		for (uint32_t order : collapseOrder)
+		{
+			const Collapse& collapse = collapses[order];
+
+			if (collapse.error > errorLimit || collapse.error > errorGoal || triangleCollapses >= triangleCollapseGoal)
+			{
+				break;
+			}
+
+			uint32_t i0 = collapse.v0;
+			uint32_t i1 = collapse.v1;
+			uint32_t r0 = m_remap[i0];
+			uint32_t r1 = m_remap[i1];
+
+			if (collapseLocked[r0] || collapseLocked[r1])
+			{
+				continue;
+			}
+
+			if (HasTriangleFlips(triangles, _result, i0, i1))
+			{
+				continue;
+			}
+
+			assert(collapseRemap[r0] == r0 && collapseRemap[r1] == r1 && "Vertex collapsed twice in the same pass");
+
+			QuadricAdd(quadrics[r1], quadrics[r0]);
+
+			if (kinds[i0] == Seam)
+			{
+				// The other side of the seam follows the same edge, walked in the opposite direction.
+				uint32_t s0 = m_wedge[i0];
+				uint32_t s1 = loop[i0] == i1 ? loopback[s0] : loop[s0];
+				assert(s0 != i0 && m_wedge[s0] == i0 && "Seam vertex must have exactly two wedges");
+				assert(s1 != INVALID_VERTEX && m_remap[s1] == m_remap[i1] && "Seam edge must be closed on both sides");
+
+				collapseRemap[i0] = i1;
+				collapseRemap[s0] = s1;
+			}
+			else
+			{
+				uint32_t v = i0;
+				do
+				{
+					collapseRemap[v] = i1;
+					v = m_wedge[v];
+				} while (v != i0);
+			}
+
+			collapseLocked[r0] = 1;
+			collapseLocked[r1] = 1;
+
+			triangleCollapses += kinds[i0] == Border ? 1 : 2;
+			edgeCollapses++;
+			resultError = std::max(resultError, collapse.error);
+		}
+
+		if (edgeCollapses == 0)
+		{
+			break;
+		}
+
+		RemapEdgeLoop(loop, collapseRemap);
+		RemapEdgeLoop(loopback, collapseRemap);
+
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < _result.size(); i += 3)
+		{
+			uint32_t v0 = collapseRemap[_result[i + 0]];
+			uint32_t v1 = collapseRemap[_result[i + 1]];
+			uint32_t v2 = collapseRemap[_result[i + 2]];
+
+			// Checked on positions so triangles collapsed onto a seam edge are removed too.
+			if (m_remap[v0] != m_remap[v1] && m_remap[v0] != m_remap[v2] && m_remap[v1] != m_remap[v2])
+			{
+				_result[writeIndex + 0] = v0;
+				_result[writeIndex + 1] = v1;
+				_result[writeIndex + 2] = v2;
+				writeIndex += 3;
+			}
+		}
+		_result.resize(writeIndex);
+	}
+
+	return std::sqrt(resultError);
+}
+
+void MeshSimplifier::BuildEdgeAdjacency(Adjacency& _adjacency, const std::vector<uint32_t>& _indices, size_t _vertexCount)
+{
+	_adjacency.offsets.assign(_vertexCount + 1, 0);
+	_adjacency.data.resize(_indices.size());
+
+	for (uint32_t index : _indices)
+	{
+		_adjacency.offsets[index + 1]++;
+	}
+	for (size_t i = 0; i < _vertexCount; i++)
+	{
+		_adjacency.offsets[i + 1] += _adjacency.offsets[i];
+	}
+
+	std::vector<uint32_t> cursor(_adjacency.offsets.begin(), _adjacency.offsets.end() - 1);
+	for (size_t i = 0; i < _indices.size(); i += 3)
+	{
+		uint32_t a = _indices[i + 0];
+		uint32_t b = _indices[i + 1];
+		uint32_t c = _indices[i + 2];
+
+		_adjacency.data[cursor[a]++] = b;
+		_adjacency.data[cursor[b]++] = c;
+		_adjacency.data[cursor[c]++] = a;
+	}
+}
+
+void MeshSimplifier::BuildTriangleAdjacency(Adjacency& _adjacency, const std::vector<uint32_t>& _indices, const std::vector<uint32_t>& _remap, size_t _vertexCount)
+{
+	_adjacency.offsets.assign(_vertexCount + 1, 0);
+	_adjacency.data.resize(_indices.size());
+
+	for (uint32_t index : _indices)
+	{
+		_adjacency.offsets[_remap[index] + 1]++;
+	}
+	for (size_t i = 0; i < _vertexCount; i++)
+	{
+		_adjacency.offsets[i + 1] += _adjacency.offsets[i];
+	}
+
+	std::vector<uint32_t> cursor(_adjacency.offsets.begin(), _adjacency.offsets.end() - 1);
+	for (size_t i = 0; i < _indices.size(); i++)
+	{
+		_adjacency.data[cursor[_remap[_indices[i]]]++] = static_cast<uint32_t>(i / 3);
+	}
+}
+
+void MeshSimplifier::RemapEdgeLoop(std::vector<uint32_t>& _loop, const std::vector<uint32_t>& _collapseRemap)
+{
+	const std::vector<uint32_t> previous = _loop;
+
+	for (size_t i = 0; i < _loop.size(); i++)
+	{
+		uint32_t l = previous[i];
+		if (l == INVALID_VERTEX)
+		{
+			continue;
+		}
+
+		// When the edge collapsed onto i itself the loop skips over the removed vertex, which may have moved too.
+		uint32_t r = _collapseRemap[l];
+		if (r == i)
+		{
+			_loop[i] = previous[l] == INVALID_VERTEX ? INVALID_VERTEX : _collapseRemap[previous[l]];
+		}
+		else
+		{
+			_loop[i] = r;
+		}
+	}
+}
+
+bool MeshSimplifier::HasEdge(const Adjacency& _adjacency, uint32_t _a, uint32_t _b)
+{
+	for (uint32_t i = _adjacency.offsets[_a]; i < _adjacency.offsets[_a + 1]; i++)
+	{
+		if (_adjacency.data[i] == _b)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void MeshSimplifier::ClassifyVertices(const Adjacency& _adjacency, std::vector<uint8_t>& _kinds, std::vector<uint32_t>& _loop, std::vector<uint32_t>& _loopback) const
+{
+	const size_t vertexCount = m_vertices.size();
+
+	_kinds.assign(vertexCount, Locked);
+	_loop.assign(vertexCount, INVALID_VERTEX);
+	_loopback.assign(vertexCount, INVALID_VERTEX);
+
+	// Open edges have no opposite half-edge. A vertex with several open edges going out (or in) stores itself,
+	// which marks it as part of a complex boundary.
+	std::vector<uint32_t> openIncoming(vertexCount, INVALID_VERTEX);
+	std::vector<uint32_t> openOutgoing(vertexCount, INVALID_VERTEX);
+
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		for (uint32_t i = _adjacency.offsets[vertex]; i < _adjacency.offsets[vertex + 1]; i++)
+		{
+			uint32_t target = _adjacency.data[i];
+
+			if (!HasEdge(_adjacency, target, vertex))
+			{
+				openIncoming[target] = openIncoming[target] == INVALID_VERTEX ? vertex : target;
+				openOutgoing[vertex] = openOutgoing[vertex] == INVALID_VERTEX ? target : vertex;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		if (m_remap[i] != i)
+		{
+			continue;
+		}
+
+		if (m_wedge[i] == i)
+		{
+			uint32_t openI = openIncoming[i];
+			uint32_t openO = openOutgoing[i];
+
+			if (openI == INVALID_VERTEX && openO == INVALID_VERTEX)
+			{
+				_kinds[i] = Manifold;
+			}
+			else if (openI != INVALID_VERTEX && openO != INVALID_VERTEX && openI != i && openO != i)
+			{
+				_kinds[i] = Border;
+			}
+		}
+		else if (m_wedge[m_wedge[i]] == i)
+		{
+			uint32_t w = m_wedge[i];
+			uint32_t openIV = openIncoming[i];
+			uint32_t openOV = openOutgoing[i];
+			uint32_t openIW = openIncoming[w];
+			uint32_t openOW = openOutgoing[w];
+
+			bool valid = openIV != INVALID_VERTEX && openIV != i && openOV != INVALID_VERTEX && openOV != i &&
+				openIW != INVALID_VERTEX && openIW != w && openOW != INVALID_VERTEX && openOW != w;
+
+			if (valid && m_remap[openIV] == m_remap[openOW] && m_remap[openOV] == m_remap[openIW])
+			{
+				_kinds[i] = Seam;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		_kinds[i] = _kinds[m_remap[i]];
+
+		if (_kinds[i] == Border || _kinds[i] == Seam)
+		{
+			_loop[i] = openOutgoing[i];
+			_loopback[i] = openIncoming[i];
+		}
+	}
+}
+
+void MeshSimplifier::FillQuadrics(const std::vector<uint32_t>& _indices, const std::vector<uint8_t>& _kinds, const std::vector<uint32_t>& _loop, const std::vector<uint32_t>& _loopback, std::vector<Quadric>& _quadrics) const
+{
+	for (size_t i = 0; i < _indices.size(); i += 3)
+	{
+		uint32_t i0 = _indices[i + 0];
+		uint32_t i1 = _indices[i + 1];
+		uint32_t i2 = _indices[i + 2];
+
+		Quadric q{};
+		QuadricFromTriangle(q, m_positions[i0], m_positions[i1], m_positions[i2], 1.0f);
+
+		QuadricAdd(_quadrics[m_remap[i0]], q);
+		QuadricAdd(_quadrics[m_remap[i1]], q);
+		QuadricAdd(_quadrics[m_remap[i2]], q);
+	}
+
+	// Border and seam edges get an extra perpendicular plane so collapses keep their silhouette.
+	for (size_t i = 0; i < _indices.size(); i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint32_t i0 = _indices[i + e];
+			uint32_t i1 = _indices[i + (e + 1) % 3];
+			uint32_t i2 = _indices[i + (e + 2) % 3];
+
+			uint8_t k0 = _kinds[i0];
+			uint8_t k1 = _kinds[i1];
+
+			bool edge0 = k0 == Border || k0 == Seam;
+			bool edge1 = k1 == Border || k1 == Seam;
+
+			if (!edge0 && !edge1)
+			{
+				continue;
+			}
+			if (edge0 && _loop[i0] != i1)
+			{
+				continue;
+			}
+			if (edge1 && _loopback[i1] != i0)
+			{
+				continue;
+			}
+			if (HAS_OPPOSITE[k0][k1] && m_remap[i1] > m_remap[i0])
+			{
+				continue;
+			}
+
+			Quadric q{};
+			QuadricFromTriangleEdge(q, m_positions[i0], m_positions[i1], m_positions[i2], EDGE_WEIGHT);
+
+			QuadricAdd(_quadrics[m_remap[i0]], q);
+			QuadricAdd(_quadrics[m_remap[i1]], q);
+		}
+	}
+}
+
+void MeshSimplifier::PickEdgeCollapses(const std::vector<uint32_t>& _indices, const std::vector<uint8_t>& _kinds, const std::vector<uint32_t>& _loop, std::vector<Collapse>& _collapses) const
+{
+	_collapses.clear();
+
+	for (size_t i = 0; i < _indices.size(); i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint32_t i0 = _indices[i + e];
+			uint32_t i1 = _indices[i + (e + 1) % 3];
+
+			// Zero length edges are left alone, they usually hold complex topology together.
+			if (m_remap[i0] == m_remap[i1])
+			{
+				continue;
+			}
+
+			uint8_t k0 = _kinds[i0];
+			uint8_t k1 = _kinds[i1];
+
+			if (!CAN_COLLAPSE[k0][k1] && !CAN_COLLAPSE[k1][k0])
+			{
+				continue;
+			}
+
+			// Manifold and seam edges are seen twice, only keep one of them.
+			if (HAS_OPPOSITE[k0][k1] && m_remap[i1] > m_remap[i0])
+			{
+				continue;
+			}
+
+			// Two border (or seam) vertices without an edge between them belong to different loops.
+			if (k0 == k1 && (k0 == Border || k0 == Seam) && _loop[i0] != i1)
+			{
+				continue;
+			}
+
+			if (CAN_COLLAPSE[k0][k1] && CAN_COLLAPSE[k1][k0])
+			{
+				_collapses.push_back({ i0, i1, true, 0.0f });
+			}
+			else if (CAN_COLLAPSE[k0][k1])
+			{
+				_collapses.push_back({ i0, i1, false, 0.0f });
+			}
+			else
+			{
+				_collapses.push_back({ i1, i0, false, 0.0f });
+			}
+		}
+	}
+}
+
+void MeshSimplifier::RankEdgeCollapses(std::vector<Collapse>& _collapses, const std::vector<Quadric>& _quadrics) const
+{
+	for (auto& collapse : _collapses)
+	{
+		uint32_t i0 = collapse.v0;
+		uint32_t i1 = collapse.v1;
+
+		float edgeLengthSq = glm::dot(m_positions[i1] - m_positions[i0], m_positions[i1] - m_positions[i0]);
+		float normalPenalty = NORMAL_WEIGHT * edgeLengthSq * (1.0f - glm::dot(m_vertices[i0].normal, m_vertices[i1].normal));
+
+		float forward = QuadricError(_quadrics[m_remap[i0]], m_positions[i1]) + normalPenalty;
+		float backward = collapse.bidirectional ? QuadricError(_quadrics[m_remap[i1]], m_positions[i0]) + normalPenalty : FLT_MAX;
+
+		if (backward < forward)
+		{
+			collapse.v0 = i1;
+			collapse.v1 = i0;
+		}
+		collapse.error = std::min(forward, backward);
+	}
+}
+
+bool MeshSimplifier::HasTriangleFlips(const Adjacency& _triangles, const std::vector<uint32_t>& _indices, uint32_t _v0, uint32_t _v1) const
+{
+	uint32_t r0 = m_remap[_v0];
+	uint32_t r1 = m_remap[_v1];
+	const glm::vec3& target = m_positions[_v1];
+
+	for (uint32_t i = _triangles.offsets[r0]; i < _triangles.offsets[r0 + 1]; i++)
+	{
+		size_t triangle = _triangles.data[i];
+		uint32_t a = m_remap[_indices[triangle * 3 + 0]];
+		uint32_t b = m_remap[_indices[triangle * 3 + 1]];
+		uint32_t c = m_remap[_indices[triangle * 3 + 2]];
+
+		// Triangles containing the edge disappear with the collapse.
+		if (a == r1 || b == r1 || c == r1)
+		{
+			continue;
+		}
+
+		glm::vec3 p[3] = { m_positions[a], m_positions[b], m_positions[c] };
+		glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+		if (a == r0) p[0] = target;
+		if (b == r0) p[1] = target;
+		if (c == r0) p[2] = target;
+
+		glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+		if (glm::dot(before, after) <= 0.0f)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void MeshSimplifier::QuadricFromPlane(Quadric& _q, float _a, float _b, float _c, float _d, float _w)
+{
+	float aw = _a * _w;
+	float bw = _b * _w;
+	float cw = _c * _w;
+	float dw = _d * _w;
+
+	_q.a00 = _a * aw;
+	_q.a11 = _b * bw;
+	_q.a22 = _c * cw;
+	_q.a10 = _a * bw;
+	_q.a20 = _a * cw;
+	_q.a21 = _b * cw;
+	_q.b0 = _a * dw;
+	_q.b1 = _b * dw;
+	_q.b2 = _c * dw;
+	_q.c = _d * dw;
+	_q.w = _w;
+}
+
+void MeshSimplifier::QuadricFromTriangle(Quadric& _q, const glm::vec3& _p0, const glm::vec3& _p1, const glm::vec3& _p2, float _weight)
+{
+	glm::vec3 normal = glm::cross(_p1 - _p0, _p2 - _p0);
+	float area = glm::length(normal);
+
+	if (area > 0.0f)
+	{
+		normal /= area;
+	}
+
+	QuadricFromPlane(_q, normal.x, normal.y, normal.z, -glm::dot(normal, _p0), area * _weight);
+}
+
+void MeshSimplifier::QuadricFromTriangleEdge(Quadric& _q, const glm::vec3& _p0, const glm::vec3& _p1, const glm::vec3& _p2, float _weight)
+{
+	glm::vec3 edge = _p1 - _p0;
+	float length = glm::length(edge);
+
+	if (length > 0.0f)
+	{
+		edge /= length;
+	}
+
+	glm::vec3 normal = (_p2 - _p0) - edge * glm::dot(_p2 - _p0, edge);
+	float normalLength = glm::length(normal);
+
+	if (normalLength > 0.0f)
+	{
+		normal /= normalLength;
+	}
+
+	QuadricFromPlane(_q, normal.x, normal.y, normal.z, -glm::dot(normal, _p0), length * length * _weight);
+}
+
+void MeshSimplifier::QuadricAdd(Quadric& _q, const Quadric& _r)
+{
+	_q.a00 += _r.a00;
+	_q.a11 += _r.a11;
+	_q.a22 += _r.a22;
+	_q.a10 += _r.a10;
+	_q.a20 += _r.a20;
+	_q.a21 += _r.a21;
+	_q.b0 += _r.b0;
+	_q.b1 += _r.b1;
+	_q.b2 += _r.b2;
+	_q.c += _r.c;
+	_q.w += _r.w;
+}
+
+float MeshSimplifier::QuadricError(const Quadric& _q, const glm::vec3& _v)
+{
+	float rx = _q.b0;
+	float ry = _q.b1;
+	float rz = _q.b2;
+
+	rx += _q.a10 * _v.y;
+	ry += _q.a21 * _v.z;
+	rz += _q.a20 * _v.x;
+
+	rx *= 2.0f;
+	ry *= 2.0f;
+	rz *= 2.0f;
+
+	rx += _q.a00 * _v.x;
+	ry += _q.a11 * _v.y;
+	rz += _q.a22 * _v.z;
+
+	float r = _q.c + rx * _v.x + ry * _v.y + rz * _v.z;
+
+	return _q.w == 0.0f ? 0.0f : std::fabs(r) / _q.w;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "model/Model.h"
+#include <vector>
+#include <cstdint>
+
+// Quadric error metric edge collapse simplifier.
+// Vertices are never moved, an edge collapse snaps one vertex onto the other, so uvs and normals of the
+// remaining vertices stay untouched. Vertices sharing a position with different attributes (uv seams, hard
+// normals) can only collapse along their seam so both sides of the seam stay stitched together.
+class MeshSimplifier
+{
+public:
+	MeshSimplifier(const std::vector<Model::Vertex>& _vertices);
+
+	// Returns the reached error, relative to the mesh extent (see GetScale).
+	float Simplify(const std::vector<uint32_t>& _indices, size_t _targetIndexCount, float _targetError, std::vector<uint32_t>& _result) const;
+
+	float GetScale() const { return m_scale; }
+
+private:
+	enum VertexKind : uint8_t
+	{
+		Manifold,
+		Border,
+		Seam,
+		Locked,
+		KindCount
+	};
+
+	struct Quadric
+	{
+		float a00, a11, a22;
+		float a10, a20, a21;
+		float b0, b1, b2;
+		float c;
+		float w;
+	};
+
+	struct Collapse
+	{
+		uint32_t v0;
+		uint32_t v1;
+		bool bidirectional;
+		float error;
+	};
+
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> data;
+	};
+
+	static void BuildEdgeAdjacency(Adjacency& _adjacency, const std::vector<uint32_t>& _indices, size_t _vertexCount);
+	static void BuildTriangleAdjacency(Adjacency& _adjacency, const std::vector<uint32_t>& _indices, const std::vector<uint32_t>& _remap, size_t _vertexCount);
+	static void RemapEdgeLoop(std::vector<uint32_t>& _loop, const std::vector<uint32_t>& _collapseRemap);
+	static bool HasEdge(const Adjacency& _adjacency, uint32_t _a, uint32_t _b);
+
+	void ClassifyVertices(const Adjacency& _adjacency, std::vector<uint8_t>& _kinds, std::vector<uint32_t>& _loop, std::vector<uint32_t>& _loopback) const;
+	void FillQuadrics(const std::vector<uint32_t>& _indices, const std::vector<uint8_t>& _kinds, const std::vector<uint32_t>& _loop, const std::vector<uint32_t>& _loopback, std::vector<Quadric>& _quadrics) const;
+	void PickEdgeCollapses(const std::vector<uint32_t>& _indices, const std::vector<uint8_t>& _kinds, const std::vector<uint32_t>& _loop, std::vector<Collapse>& _collapses) const;
+	void RankEdgeCollapses(std::vector<Collapse>& _collapses, const std::vector<Quadric>& _quadrics) const;
+	bool HasTriangleFlips(const Adjacency& _triangles, const std::vector<uint32_t>& _indices, uint32_t _v0, uint32_t _v1) const;
+
+	static void QuadricFromPlane(Quadric& _q, float _a, float _b, float _c, float _d, float _w);
+	static void QuadricFromTriangle(Quadric& _q, const glm::vec3& _p0, const glm::vec3& _p1, const glm::vec3& _p2, float _weight);
+	static void QuadricFromTriangleEdge(Quadric& _q, const glm::vec3& _p0, const glm::vec3& _p1, const glm::vec3& _p2, float _weight);
+	static void QuadricAdd(Quadric& _q, const Quadric& _r);
+	static float QuadricError(const Quadric& _q, const glm::vec3& _v);
+
+	const std::vector<Model::Vertex>& m_vertices;
+	std::vector<glm::vec3> m_positions;
+	std::vector<uint32_t> m_remap;
+	std::vector<uint32_t> m_wedge;
+	float m_scale = 1.0f;
+};
@@ -0,0 +1,128 @@
+#include "model/MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+void MeshletBuilder::Build(const std::vector<Model::Vertex>& _vertices, const uint32_t* _indices, size_t _indexCount, uint32_t _firstIndex, std::vector<Model::Meshlet>& _meshlets)
+{
+	// Meshlet that last used each vertex, so a vertex is counted once per meshlet.
+	std::vector<uint32_t> vertexOwner(_vertices.size(), ~0u);
+	uint32_t meshletId = 0;
+
+	auto countNewVertices = [&](const uint32_t* _triangle)
+	{
+		uint32_t count = 0;
+		for (size_t k = 0; k < 3; k++)
+		{
+			bool repeated = (k > 0 && _triangle[k] == _triangle[0]) || (k > 1 && _triangle[k] == _triangle[1]);
+			if (vertexOwner[_triangle[k]] != meshletId && !repeated)
+			{
+				count++;
+			}
+		}
+		return count;
+	};
+
+	Model::Meshlet meshlet{};
+	meshlet.firstIndex = _firstIndex;
+	uint32_t meshletVertexCount = 0;
+
+	for (size_t t = 0; t < _indexCount / 3; t++)
+	{
+		const uint32_t* triangle = _indices + t * 3;
+		uint32_t newVertices = countNewVertices(triangle);
+
+		if (meshletVertexCount + newVertices > Model::MESHLET_MAX_VERTICES || meshlet.triangleCount == Model::MESHLET_MAX_TRIANGLES)
+		{
+			ComputeBounds(_vertices, _indices + (meshlet.firstIndex - _firstIndex), meshlet);
+			_meshlets.push_back(meshlet);
+
+			uint32_t nextFirstIndex = meshlet.firstIndex + meshlet.triangleCount * 3;
+			meshlet = {};
+			meshlet.firstIndex = nextFirstIndex;
+			meshletVertexCount = 0;
+			meshletId++;
+			newVertices = countNewVertices(triangle);
+		}
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			vertexOwner[triangle[k]] = meshletId;
+		}
+		meshletVertexCount += newVertices;
+		meshlet.triangleCount++;
+	}
+
+	if (meshlet.triangleCount > 0)
+	{
+		ComputeBounds(_vertices, _indices + (meshlet.firstIndex - _firstIndex), meshlet);
+		_meshlets.push_back(meshlet);
+	}
+}
+
+void MeshletBuilder::ComputeBounds(const std::vector<Model::Vertex>& _vertices, const uint32_t* _indices, Model::Meshlet& _meshlet)
+{
+	const uint32_t triangleCount = _meshlet.triangleCount;
+
+	glm::vec3 boxMin = _vertices[_indices[0]].position;
+	glm::vec3 boxMax = boxMin;
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		boxMin = glm::min(boxMin, _vertices[_indices[i]].position);
+		boxMax = glm::max(boxMax, _vertices[_indices[i]].position);
+	}
+
+	_meshlet.center = (boxMin + boxMax) * 0.5f;
+	_meshlet.radius = 0.0f;
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		_meshlet.radius = std::max(_meshlet.radius, glm::length(_vertices[_indices[i]].position - _meshlet.center));
+	}
+
+	// Normal cone: the axis averages the face normals, the cutoff comes from the widest of them.
+	std::vector<glm::vec3> normals(triangleCount, glm::vec3{ 0.0f });
+	glm::vec3 normalSum{ 0.0f };
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3& p0 = _vertices[_indices[t * 3 + 0]].position;
+		const glm::vec3& p1 = _vertices[_indices[t * 3 + 1]].position;
+		const glm::vec3& p2 = _vertices[_indices[t * 3 + 2]].position;
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+		normals[t] = area > 0.0f ? normal / area : glm::vec3{ 0.0f };
+		normalSum += normals[t];
+	}
+
+	float axisLength = glm::length(normalSum);
+	_meshlet.coneAxis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3{ 0.0f, 0.0f, 1.0f };
+	_meshlet.coneApex = _meshlet.center;
+	_meshlet.coneCutoff = 2.0f;
+
+	float minDot = 1.0f;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		if (normals[t] != glm::vec3{ 0.0f })
+		{
+			minDot = std::min(minDot, glm::dot(normals[t], _meshlet.coneAxis));
+		}
+	}
+
+	// Past ~85 degrees the cone almost never culls and the apex goes far away.
+	if (axisLength == 0.0f || minDot <= 0.1f)
+		return;
+
+	// Apex on the axis behind the center, far enough to be on the back side of every triangle plane.
+	float maxDistance = 0.0f;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		if (normals[t] == glm::vec3{ 0.0f })
+			continue;
+
+		const glm::vec3& p0 = _vertices[_indices[t * 3 + 0]].position;
+		float distance = glm::dot(_meshlet.center - p0, normals[t]) / glm::dot(_meshlet.coneAxis, normals[t]);
+		maxDistance = std::max(maxDistance, distance);
+	}
+
+	_meshlet.coneApex = _meshlet.center - _meshlet.coneAxis * maxDistance;
+	_meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
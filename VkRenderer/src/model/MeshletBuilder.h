@@ -0,0 +1,17 @@
+#pragma once
+#include "model/Model.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Splits a triangle list into meshlets of at most MESHLET_MAX_VERTICES unique vertices and MESHLET_MAX_TRIANGLES
+// triangles. Triangles are taken in order, so a cache optimized list gives compact clusters and each meshlet is a
+// contiguous index range that a plain indexed draw can consume, no mesh shader needed.
+class MeshletBuilder
+{
+public:
+	static void Build(const std::vector<Model::Vertex>& _vertices, const uint32_t* _indices, size_t _indexCount, uint32_t _firstIndex, std::vector<Model::Meshlet>& _meshlets);
+
+private:
+	static void ComputeBounds(const std::vector<Model::Vertex>& _vertices, const uint32_t* _indices, Model::Meshlet& _meshlet);
+};
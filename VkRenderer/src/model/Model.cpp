@@ -1,97 +1,363 @@
 #include "model/Model.h"
 #include <cassert>
 #include <iostream>
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 
 #include "core/Utils.h"
-#include <unordered_map>
 #include "core/Buffer.h"
 #include "core/Device.h"
-#include "core/Descriptors.h"
-
-namespace std 
+#include "core/StagingRing.h"
+#include "core/DeletionQueue.h"
+#include "model/MeshSimplifier.h"
+#include "model/MeshCache.h"
+#include "core/MappedFile.h"
+#include "model/ObjParser.h"
+#include "model/MeshOptimizer.h"
+#include "model/MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
 {
-	template <>
-	struct hash<Model::Vertex> {
-		size_t operator()(Model::Vertex const& _vertex) const 
+	// Open addressing table of vertex indices keyed by vertex value, one probe sequence per corner finds or inserts.
+	class VertexDedupTable
+	{
+	public:
+		VertexDedupTable(std::vector<Model::Vertex>& _vertices, size_t _expectedCount) : m_vertices{ _vertices }
+		{
+			size_t capacity = 16;
+			while (capacity < _expectedCount * 2)
+				capacity *= 2;
+
+			m_slots.assign(capacity, Slot{ 0, EMPTY_SLOT });
+			m_mask = capacity - 1;
+		}
+
+		uint32_t FindOrInsert(const Model::Vertex& _vertex)
+		{
+			uint32_t hash = Hash(_vertex);
+
+			for (size_t slot = hash & m_mask;; slot = (slot + 1) & m_mask)
+			{
+				Slot& entry = m_slots[slot];
+				if (entry.index == EMPTY_SLOT)
+				{
+					uint32_t index = static_cast<uint32_t>(m_vertices.size());
+					entry = { hash, index };
+					m_vertices.push_back(_vertex);
+
+					if (m_vertices.size() * 2 > m_slots.size())
+						Grow();
+					return index;
+				}
+
+				if (entry.hash == hash && m_vertices[entry.index] == _vertex)
+					return entry.index;
+			}
+		}
+
+	private:
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t index;
+		};
+
+		static constexpr uint32_t EMPTY_SLOT = ~0u;
+		static constexpr size_t WORD_COUNT = sizeof(Model::Vertex) / sizeof(uint32_t);
+		static_assert(sizeof(Model::Vertex) == WORD_COUNT * sizeof(uint32_t), "Vertex must be made of 32-bit words");
+
+		// Words are mixed independently and folded with xor so the loop vectorizes.
+		static uint32_t Hash(const Model::Vertex& _vertex)
+		{
+			static const uint32_t MULTIPLIERS[WORD_COUNT] =
+			{
+				0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu, 0x165667B1u, 0xD3A2646Du,
+				0xFD7046C5u, 0xB55A4F09u, 0x68E31DA5u, 0x8CB92BA7u, 0xE6546B65u,
+			};
+
+			uint32_t words[WORD_COUNT];
+			std::memcpy(words, &_vertex, sizeof(words));
+
+			uint32_t hash = 0;
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				// -0.0f compares equal to 0.0f so both must land in the same bucket.
+				uint32_t word = words[i] == 0x80000000u ? 0u : words[i];
+				uint32_t lane = word * MULTIPLIERS[i];
+				hash ^= lane ^ (lane >> 15);
+			}
+
+			hash ^= hash >> 16;
+			hash *= 0x85EBCA6Bu;
+			hash ^= hash >> 13;
+			return hash;
+		}
+
+		void Grow()
 		{
-			size_t seed = 0;
-			HashCombine(seed, _vertex.position, _vertex.color, _vertex.normal, _vertex.uv);
-			return seed;
+			std::vector<Slot> previous = std::move(m_slots);
+			m_slots.assign(previous.size() * 2, Slot{ 0, EMPTY_SLOT });
+			m_mask = m_slots.size() - 1;
+
+			for (const Slot& entry : previous)
+			{
+				if (entry.index == EMPTY_SLOT)
+					continue;
+
+				size_t slot = entry.hash & m_mask;
+				while (m_slots[slot].index != EMPTY_SLOT)
+					slot = (slot + 1) & m_mask;
+				m_slots[slot] = entry;
+			}
 		}
+
+		std::vector<Model::Vertex>& m_vertices;
+		std::vector<Slot> m_slots;
+		size_t m_mask = 0;
 	};
+
+	// Flat axes (a quad) keep a zero extent, every vertex then encodes to 0 on that axis.
+	glm::vec3 InverseExtent(const glm::vec3& _extent)
+	{
+		return { _extent.x > 0.0f ? 1.0f / _extent.x : 0.0f, _extent.y > 0.0f ? 1.0f / _extent.y : 0.0f, _extent.z > 0.0f ? 1.0f / _extent.z : 0.0f };
+	}
+
+	// Expands OBJ corners into vertices, merging identical ones.
+	void ExpandObj(const ObjParser::Result& _obj, std::vector<Model::Vertex>& _vertices, std::vector<uint32_t>& _indices)
+	{
+		_vertices.clear();
+		_indices.clear();
+		_indices.reserve(_obj.indices.size());
+
+		// Unique vertices are usually close to the largest attribute count, the table grows past that if needed.
+		size_t expectedCount = std::max({ _obj.positions.size() / 3, _obj.normals.size() / 3, _obj.texcoords.size() / 2 });
+		_vertices.reserve(expectedCount);
+		VertexDedupTable uniqueVertices{ _vertices, expectedCount };
+
+		for (const auto& index : _obj.indices) 
+		{
+			Model::Vertex vertex{};
+
+			if (index.vertexIndex >= 0) 
+			{
+				vertex.position =
+				{
+					_obj.positions[3 * index.vertexIndex + 0],
+					_obj.positions[3 * index.vertexIndex + 1],
+					_obj.positions[3 * index.vertexIndex + 2],
+				};
+
+				if (_obj.colors.size() > 0) 
+				{
+					vertex.color = 
+					{
+						_obj.colors[3 * index.vertexIndex + 0],
+						_obj.colors[3 * index.vertexIndex + 1],
+						_obj.colors[3 * index.vertexIndex + 2],
+					};
+				}
+				else 
+				{
+					vertex.color = { 1.0f, 1.0f, 1.0f };
+				}
+			}
+			else 
+			{
+				vertex.color = { 1.0f, 1.0f, 1.0f };
+			}
+
+			if (index.normalIndex >= 0) 
+			{
+				vertex.normal = 
+				{
+					_obj.normals[3 * index.normalIndex + 0],
+					_obj.normals[3 * index.normalIndex + 1],
+					_obj.normals[3 * index.normalIndex + 2],
+				};
+			}
+			else 
+			{
+				vertex.normal = { 0.0f, 0.0f, 1.0f };
+			}
+
+			if (index.texcoordIndex >= 0) 
+			{
+				vertex.uv = 
+				{
+					_obj.texcoords[2 * index.texcoordIndex + 0],
+					_obj.texcoords[2 * index.texcoordIndex + 1],
+				};
+			}
+			else 
+			{
+				vertex.uv = { 0.0f, 0.0f };
+			}
+
+			_indices.push_back(uniqueVertices.FindOrInsert(vertex));
+		}
+	}
+}
+
+Model::Model(Device& _device, const Model::Builder& _builder, VertexFormat _format) : Model{ _device, _builder.GetMeshData(), _format }
+{
+}
+
+Model::Model(Device& _device, const MeshData& _data, VertexFormat _format) : m_device{ _device }, m_vertexFormat{ _format }, m_lods(_data.lods, _data.lods + _data.lodCount), m_bounds{ _data.bounds }
+{
+	if (m_vertexFormat == VertexFormat::Compact)
+	{
+		CreateCompactVertexBuffers(_data.vertices, _data.vertexCount);
+	}
+	else
+	{
+		CreateVertexBuffers(_data.vertices, _data.vertexCount);
+	}
+	CreateIndexBuffers(_data.indices, _data.indexCount, _data.indexType, _data.vertexCount);
+	CreateMeshletBuffer(_data.meshlets, _data.meshletCount);
+
+	if (m_lods.empty())
+	{
+		m_lods.push_back({ 0, m_indexCount, 0.0f });
+	}
 }
 
-Model::Model(Device& _device, const Model::Builder& _builder) : m_device{ _device }
+Model::Model(Device& _device, const StreamData& _data, VertexFormat _format) : m_device{ _device }, m_vertexFormat{ _format }
 {
-	CreateVertexBuffers(_builder.vertices);
-	CreateIndexBuffers(_builder.indices);
+	m_bounds.center = (_data.boxMin + _data.boxMax) * 0.5f;
+	m_bounds.radius = glm::length(_data.boxMax - _data.boxMin) * 0.5f;
+
+	m_vertexCount = _data.vertexCount;
+	assert(m_vertexCount >= 3 && "Vertex count must equal or grater than 3");
+
+	GeometryPool& geometryPool = m_device.GetGeometryPool();
+	if (m_vertexFormat == VertexFormat::Compact)
+	{
+		glm::vec3 extent = _data.boxMax - _data.boxMin;
+		glm::vec3 invExtent = InverseExtent(extent);
+		m_dequantization = glm::scale(glm::translate(glm::mat4{ 1.0f }, _data.boxMin), extent);
+
+		m_vertexAllocation = geometryPool.AllocateVertices(sizeof(CompactVertex), m_vertexCount, [&](void* _destination)
+			{
+				// Full vertices go through a small batch that stays in cache, only the encoded ones reach the upload memory.
+				constexpr uint32_t BATCH_SIZE = 256;
+				Vertex batch[BATCH_SIZE];
+				CompactVertex* compactVertices = static_cast<CompactVertex*>(_destination);
+				for (uint32_t first = 0; first < m_vertexCount; first += BATCH_SIZE)
+				{
+					uint32_t count = std::min(BATCH_SIZE, m_vertexCount - first);
+					_data.readVertices(first, count, batch);
+					for (uint32_t i = 0; i < count; i++)
+					{
+						compactVertices[first + i] = CompactVertex::Encode(batch[i], _data.boxMin, invExtent);
+					}
+				}
+			});
+	}
+	else
+	{
+		m_vertexAllocation = geometryPool.AllocateVertices(sizeof(Vertex), m_vertexCount, [&](void* _destination)
+			{
+				_data.readVertices(0, m_vertexCount, static_cast<Vertex*>(_destination));
+			});
+	}
+
+	CreateIndexBuffers(_data.indices, _data.indexCount, _data.indexType, _data.vertexCount);
+	m_lods.push_back({ 0, m_indexCount, 0.0f });
 }
 
 Model::~Model()
 {
-	
+	// Frames in flight may still draw the ranges, a new mesh must not be uploaded over them before they are done.
+	GeometryPool* geometryPool = &m_device.GetGeometryPool();
+	std::shared_ptr<Buffer> meshletBuffer = std::move(m_meshletBuffer);
+	m_device.GetDeletionQueue().Push([geometryPool, vertexAllocation = m_vertexAllocation, indexAllocation = m_indexAllocation, meshletBuffer]() mutable
+		{
+			if (vertexAllocation != GeometryPool::INVALID_HANDLE)
+			{
+				geometryPool->Free(vertexAllocation);
+			}
+			if (indexAllocation != GeometryPool::INVALID_HANDLE)
+			{
+				geometryPool->Free(indexAllocation);
+			}
+			meshletBuffer.reset();
+		});
 }
 
 
+Model::MeshData Model::LoadMeshData(const std::string& _filepath, MappedFile& _cookedFile, Builder& _builder)
+{
+	std::string cachePath = MeshCache::GetCachePath(_filepath);
+
+	MeshData cookedData{};
+	if (MeshCache::Load(cachePath, _filepath, _cookedFile, cookedData))
+	{
+		return cookedData;
+	}
+
+	_builder.LoadModel(_filepath);
+	MeshCache::Save(cachePath, _filepath, _builder);
+	return _builder.GetMeshData();
+}
+
 std::unique_ptr<Model> Model::CreateModelFromFile(Device& _device, const std::string& _filepath) 
 {
+	// The mapping only has to outlive the copy into the staging buffers.
+	MappedFile cookedFile{};
 	Builder builder{};
-	builder.LoadModel(_filepath);
-	return std::make_unique<Model>(_device, builder);
-}
-
-std::shared_ptr<Model> Model::CreateModelWithTexture(
-    Device& device,
-    const std::string& modelPath,
-    const std::string& texturePath,
-    DescriptorSetLayout& textureSetLayout,
-    DescriptorPool& texturePool
-) {
-    auto uniqueModel = Model::CreateModelFromFile(device, modelPath);
-    auto model = std::shared_ptr<Model>(std::move(uniqueModel));
-    auto texture = std::make_shared<Texture>();
-    texture->LoadFromFile(texturePath, device, device.GetGraphicsQueue());
-    model->SetTexture(texture);
-
-    VkDescriptorSet textureDescriptorSet;
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = texture->GetImageView();
-    imageInfo.sampler = texture->GetSampler();
-    DescriptorWriter(textureSetLayout, texturePool)
-        .WriteImage(0, &imageInfo)
-        .Build(textureDescriptorSet);
-    model->SetTextureDescriptorSet(textureDescriptorSet);
-    return model;
-}
-
-void Model::CreateVertexBuffers(const std::vector<Vertex>& _vertices)
-{
-	m_vertexCount = static_cast<uint32_t>(_vertices.size());
+	MeshData data = LoadMeshData(_filepath, cookedFile, builder);
+	return std::make_unique<Model>(_device, data);
+}
 
-	assert(m_vertexCount >= 3 && "Vertex count must equal or grater than 3");
+void Model::CreateVertexBuffers(const Vertex* _vertices, uint32_t _vertexCount)
+{
+	UploadVertexBuffer(_vertices, sizeof(Vertex), _vertexCount);
+}
 
-	VkDeviceSize bufferSize = sizeof(_vertices[0]) * m_vertexCount;
-	uint32_t vertexSize = sizeof(_vertices[0]);
+void Model::CreateCompactVertexBuffers(const Vertex* _vertices, uint32_t _vertexCount)
+{
+	glm::vec3 boxMin{ 0.0f };
+	glm::vec3 boxMax{ 0.0f };
+	if (_vertexCount > 0)
+	{
+		boxMin = _vertices[0].position;
+		boxMax = _vertices[0].position;
+	}
+	for (uint32_t i = 1; i < _vertexCount; i++)
+	{
+		boxMin = glm::min(boxMin, _vertices[i].position);
+		boxMax = glm::max(boxMax, _vertices[i].position);
+	}
+
+	glm::vec3 extent = boxMax - boxMin;
+	glm::vec3 invExtent = InverseExtent(extent);
+
+	std::vector<CompactVertex> compactVertices(_vertexCount);
+	for (uint32_t i = 0; i < _vertexCount; i++)
+	{
+		compactVertices[i] = CompactVertex::Encode(_vertices[i], boxMin, invExtent);
+	}
 
-	Buffer stagingBuffer{m_device, vertexSize, m_vertexCount,VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+	m_dequantization = glm::scale(glm::translate(glm::mat4{ 1.0f }, boxMin), extent);
 
-	stagingBuffer.Map();
-	stagingBuffer.WriteToBuffer((void*)_vertices.data());
+	UploadVertexBuffer(compactVertices.data(), sizeof(CompactVertex), _vertexCount);
+}
 
-	m_vertexBuffer = std::make_unique<Buffer>(m_device, vertexSize, m_vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+void Model::UploadVertexBuffer(const void* _vertices, uint32_t _vertexSize, uint32_t _vertexCount)
+{
+	m_vertexCount = _vertexCount;
 
-	m_device.CopyBuffer(stagingBuffer.GetBuffer(), m_vertexBuffer->GetBuffer(), bufferSize);
+	assert(m_vertexCount >= 3 && "Vertex count must equal or grater than 3");
 
+	m_vertexAllocation = m_device.GetGeometryPool().AllocateVertices(_vertices, _vertexSize, m_vertexCount);
 }
 
-void Model::CreateIndexBuffers(const std::vector<uint32_t>& _indices)
+void Model::CreateIndexBuffers(const void* _indices, uint32_t _indexCount, VkIndexType _indexType, uint32_t _vertexCount)
 {
-	m_indexCount = static_cast<uint32_t>(_indices.size());
+	m_indexCount = _indexCount;
 	m_hasIndexBuffer = m_indexCount > 0;
 
 	if (!m_hasIndexBuffer) 
@@ -99,48 +365,133 @@ void Model::CreateIndexBuffers(const std::vector<uint32_t>& _indices)
 		return;
 	}
 
-	VkDeviceSize bufferSize = sizeof(_indices[0]) * m_indexCount;
-	uint32_t indexSize = sizeof(_indices[0]);
+	GeometryPool& geometryPool = m_device.GetGeometryPool();
+
+	// Builders hand over 32-bit indices, narrow them here when the vertex count allows it, straight into the upload memory.
+	if (_indexType == VK_INDEX_TYPE_UINT32 && SelectIndexType(_vertexCount) == VK_INDEX_TYPE_UINT16)
+	{
+		m_indexType = VK_INDEX_TYPE_UINT16;
+		m_indexAllocation = geometryPool.AllocateIndices(m_indexType, m_indexCount, [&](void* _destination)
+			{
+				const uint32_t* wideIndices = static_cast<const uint32_t*>(_indices);
+				uint16_t* narrowedIndices = static_cast<uint16_t*>(_destination);
+				for (uint32_t i = 0; i < m_indexCount; i++)
+				{
+					narrowedIndices[i] = static_cast<uint16_t>(wideIndices[i]);
+				}
+			});
+		return;
+	}
+
+	m_indexType = _indexType;
+	m_indexAllocation = geometryPool.AllocateIndices(_indices, m_indexType, m_indexCount);
+}
 
-	Buffer stagingBuffer{ m_device, indexSize, m_indexCount,VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+void Model::CreateMeshletBuffer(const Meshlet* _meshlets, uint32_t _meshletCount)
+{
+	m_meshletCount = _meshletCount;
+	if (m_meshletCount == 0)
+	{
+		return;
+	}
 
-	stagingBuffer.Map();
-	stagingBuffer.WriteToBuffer((void*)_indices.data());
+	uint32_t meshletSize = sizeof(Meshlet);
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(meshletSize) * m_meshletCount;
 
-	m_indexBuffer = std::make_unique<Buffer>(m_device, indexSize, m_indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_meshletBuffer = std::make_unique<Buffer>(m_device, meshletSize, m_meshletCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	m_device.CopyBuffer(stagingBuffer.GetBuffer(), m_indexBuffer->GetBuffer(), bufferSize);
+	m_device.GetStagingRing().UploadToBuffer(m_meshletBuffer->GetBuffer(), 0, _meshlets, bufferSize);
 }
 
 void Model::Bind(VkCommandBuffer _commandBuffer)
 {
-	assert(m_vertexBuffer != nullptr && "Vertex buffer is null");
-	
-	VkBuffer buffers[] = { m_vertexBuffer->GetBuffer()};
-	VkDeviceSize offsets[] = { 0 };
+	assert(m_vertexAllocation != GeometryPool::INVALID_HANDLE && "Vertex buffer is null");
 
-	vkCmdBindVertexBuffers(_commandBuffer, 0, 1, buffers, offsets);
+	GeometryPool& geometryPool = m_device.GetGeometryPool();
+	geometryPool.BindVertexBuffer(_commandBuffer, m_vertexAllocation);
 
 	if (m_hasIndexBuffer) 
 	{
-		assert(m_indexBuffer != nullptr && "Index buffer is null but hasIndexBuffer is true");
-		vkCmdBindIndexBuffer(_commandBuffer, m_indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		assert(m_indexAllocation != GeometryPool::INVALID_HANDLE && "Index buffer is null but hasIndexBuffer is true");
+		geometryPool.BindIndexBuffer(_commandBuffer, m_indexAllocation);
 	}
 }
 
-void Model::Draw(VkCommandBuffer _commandBuffer)
+void Model::Draw(VkCommandBuffer _commandBuffer, uint32_t _lod)
 {
-	assert(m_vertexBuffer != nullptr && "Vertex buffer is null");
-	
+	assert(m_vertexAllocation != GeometryPool::INVALID_HANDLE && "Vertex buffer is null");
+
+	GeometryPool& geometryPool = m_device.GetGeometryPool();
+	uint32_t baseVertex = geometryPool.GetFirstElement(m_vertexAllocation);
+
 	if (m_hasIndexBuffer)
 	{
-		assert(m_indexBuffer != nullptr && "Index buffer is null but hasIndexBuffer is true");
-		vkCmdDrawIndexed(_commandBuffer, m_indexCount, 1, 0, 0, 0);
+		assert(m_indexAllocation != GeometryPool::INVALID_HANDLE && "Index buffer is null but hasIndexBuffer is true");
+		assert(_lod < m_lods.size() && "Lod index out of range");
+		uint32_t firstIndex = geometryPool.GetFirstElement(m_indexAllocation) + m_lods[_lod].firstIndex;
+		vkCmdDrawIndexed(_commandBuffer, m_lods[_lod].indexCount, 1, firstIndex, static_cast<int32_t>(baseVertex), 0);
 	}
 	else 
 	{
-		vkCmdDraw(_commandBuffer, m_vertexCount, 1, 0, 0);
+		vkCmdDraw(_commandBuffer, m_vertexCount, 1, baseVertex, 0);
+	}
+}
+
+VkBuffer Model::GetVertexBuffer() const
+{
+	return m_device.GetGeometryPool().GetBuffer(m_vertexAllocation);
+}
+
+VkBuffer Model::GetIndexBuffer() const
+{
+	return m_hasIndexBuffer ? m_device.GetGeometryPool().GetBuffer(m_indexAllocation) : VK_NULL_HANDLE;
+}
+
+uint32_t Model::GetBaseVertex() const
+{
+	return m_device.GetGeometryPool().GetFirstElement(m_vertexAllocation);
+}
+
+VkDeviceSize Model::GetMemorySize() const
+{
+	VkDeviceSize vertexSize = m_vertexFormat == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+	VkDeviceSize indexSize = m_hasIndexBuffer ? GetIndexSize(m_indexType) : 0;
+	return vertexSize * m_vertexCount + indexSize * m_indexCount + sizeof(Meshlet) * m_meshletCount;
+}
+
+VkDescriptorBufferInfo Model::GetIndexBufferInfo() const
+{
+	assert(m_hasIndexBuffer && "Model has no index buffer");
+	return m_device.GetGeometryPool().GetDescriptorInfo(m_indexAllocation);
+}
+
+uint32_t Model::SelectLod(float _distance, float _objectScale, float _projectionScale, float _pixelThreshold) const
+{
+	if (_distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	uint32_t lod = 0;
+	for (uint32_t i = 1; i < m_lods.size(); i++)
+	{
+		float pixelError = m_lods[i].error * _objectScale / _distance * _projectionScale;
+		if (pixelError > _pixelThreshold)
+		{
+			break;
+		}
+		lod = i;
+	}
+	return lod;
+}
+
+uint32_t Model::GetTriangleCount(uint32_t _lod) const
+{
+	if (!m_hasIndexBuffer)
+	{
+		return m_vertexCount / 3;
 	}
+	return m_lods[_lod].indexCount / 3;
 }
 
 std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions()
@@ -165,88 +516,189 @@ std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescri
 	return attributeDescriptions;
 }
 
+static_assert(sizeof(Model::CompactVertex) == 16, "CompactVertex must stay 16 bytes");
+
+Model::CompactVertex Model::CompactVertex::Encode(const Vertex& _vertex, const glm::vec3& _boxMin, const glm::vec3& _boxInvExtent)
+{
+	CompactVertex compact{};
+
+	glm::vec3 position = glm::clamp((_vertex.position - _boxMin) * _boxInvExtent, 0.0f, 1.0f);
+	compact.position[0] = glm::packUnorm1x16(position.x);
+	compact.position[1] = glm::packUnorm1x16(position.y);
+	compact.position[2] = glm::packUnorm1x16(position.z);
+
+	glm::vec3 color = glm::clamp(_vertex.color, 0.0f, 1.0f);
+	compact.color = static_cast<uint16_t>(
+		(static_cast<uint32_t>(std::round(color.r * 31.0f)) << 11) |
+		(static_cast<uint32_t>(std::round(color.g * 63.0f)) << 5) |
+		static_cast<uint32_t>(std::round(color.b * 31.0f)));
+
+	// Octahedral mapping: project on the |x|+|y|+|z| = 1 octahedron and fold the lower half over the upper one.
+	glm::vec3 normal = _vertex.normal;
+	float length1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	glm::vec2 octahedral{ 0.0f };
+	if (length1 > 0.0f)
+	{
+		normal /= length1;
+		octahedral = glm::vec2(normal.x, normal.y);
+		if (normal.z < 0.0f)
+		{
+			octahedral.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+			octahedral.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+		}
+	}
+	compact.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(octahedral.x));
+	compact.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(octahedral.y));
+
+	compact.uv[0] = glm::packHalf1x16(_vertex.uv.x);
+	compact.uv[1] = glm::packHalf1x16(_vertex.uv.y);
+
+	return compact;
+}
+
+std::vector<VkVertexInputBindingDescription> Model::CompactVertex::GetBindingDescriptions()
+{
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding = 0;
+	bindingDescriptions[0].stride = sizeof(CompactVertex);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> Model::CompactVertex::GetAttributeDescriptions()
+{
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+	attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position) });
+	attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal) });
+	attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv) });
+
+	return attributeDescriptions;
+}
+
 void Model::Builder::LoadModel(const std::string& _filepath)
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
+	ObjParser::Result obj{};
+
+	// Parse times against the reference loader are reported by --verify-obj.
+	if (!ObjParser::Parse(_filepath, obj))
+	{
+		ObjParser::ParseReference(_filepath, obj);
+	}
+
+	LoadObj(obj);
+	GenerateLods();
+	OptimizeMesh();
+	BuildMeshlets();
+}
+
+void Model::Builder::LoadObj(const ObjParser::Result& _obj)
+{
+	ExpandObj(_obj, vertices, indices);
+}
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, _filepath.c_str())) 
-		throw std::runtime_error(warn + err);
+Model::MeshData Model::Builder::GetMeshData() const
+{
+	MeshData data{};
+	data.vertices = vertices.data();
+	data.vertexCount = static_cast<uint32_t>(vertices.size());
+	data.indices = indices.data();
+	data.indexCount = static_cast<uint32_t>(indices.size());
+	data.indexType = VK_INDEX_TYPE_UINT32;
+	data.lods = lods.data();
+	data.lodCount = static_cast<uint32_t>(lods.size());
+	data.meshlets = meshlets.data();
+	data.meshletCount = static_cast<uint32_t>(meshlets.size());
+	data.bounds = bounds;
+	return data;
+}
 
-	vertices.clear();
-	indices.clear();
+void Model::Builder::GenerateLods()
+{
+	lods.clear();
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-	for (const auto& shape : shapes) 
+	if (vertices.empty())
 	{
-		for (const auto& index : shape.mesh.indices) 
-		{
-		
-			Vertex vertex{};
+		bounds = {};
+		return;
+	}
 
-			if (index.vertex_index >= 0) 
-			{
-				vertex.position =
-				{
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2],
-				};
+	glm::vec3 minPosition = vertices[0].position;
+	glm::vec3 maxPosition = vertices[0].position;
+	for (const auto& vertex : vertices)
+	{
+		minPosition = glm::min(minPosition, vertex.position);
+		maxPosition = glm::max(maxPosition, vertex.position);
+	}
 
-				if (attrib.colors.size() > 0) 
-				{
-					vertex.color = 
-					{
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2],
-					};
-				}
-				else 
-				{
-					vertex.color = { 1.0f, 1.0f, 1.0f };
-				}
-			}
-			else 
-			{
-				vertex.color = { 1.0f, 1.0f, 1.0f };
-			}
+	bounds.center = (minPosition + maxPosition) * 0.5f;
+	bounds.radius = 0.0f;
+	for (const auto& vertex : vertices)
+	{
+		bounds.radius = std::max(bounds.radius, glm::length(vertex.position - bounds.center));
+	}
 
-			if (index.normal_index >= 0) 
-			{
-				vertex.normal = 
-				{
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2],
-				};
-			}
-			else 
-			{
-				vertex.normal = { 0.0f, 0.0f, 1.0f };
-			}
+	const uint32_t baseIndexCount = static_cast<uint32_t>(indices.size());
+	lods.push_back({ 0, baseIndexCount, 0.0f });
 
-			if (index.texcoord_index >= 0) 
-			{
-				vertex.uv = 
-				{
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1],
-				};
-			}
-			else 
-			{
-				vertex.uv = { 0.0f, 0.0f };
-			}
+	// Tiny meshes (cubes, quads) gain nothing from simplification.
+	if (baseIndexCount < 3 * 256)
+	{
+		return;
+	}
 
-			if (uniqueVertices.count(vertex) == 0) 
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
-			indices.push_back(uniqueVertices[vertex]);
+	MeshSimplifier simplifier{ vertices };
+	std::vector<uint32_t> source(indices.begin(), indices.end());
+	std::vector<uint32_t> simplified{};
+	float error = 0.0f;
+
+	while (lods.size() < MAX_LODS)
+	{
+		size_t targetIndexCount = (source.size() / 2) / 3 * 3;
+		float levelError = simplifier.Simplify(source, targetIndexCount, 0.05f, simplified);
+
+		// Stop once the simplifier is stuck on locked topology or the error limit.
+		if (simplified.empty() || simplified.size() * 10 > source.size() * 9)
+		{
+			break;
 		}
+
+		// Each level is simplified from the previous one, so errors pile up.
+		error += levelError * simplifier.GetScale();
+
+		lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), error });
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		source.swap(simplified);
+	}
+}
+
+void Model::Builder::OptimizeMesh()
+{
+	if (indices.empty() || lods.empty())
+	{
+		return;
+	}
+
+	// Each lod is drawn on its own, so each range is ordered on its own.
+	for (const auto& lod : lods)
+	{
+		MeshOptimizer::OptimizeVertexCache(indices.data() + lod.firstIndex, lod.indexCount, vertices.size());
+		MeshOptimizer::OptimizeOverdraw(indices.data() + lod.firstIndex, lod.indexCount, vertices);
+	}
+
+	// Lod 0 comes first in the index buffer so it drives the vertex order, coarser lods reuse a subset of it.
+	MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+}
+
+void Model::Builder::BuildMeshlets()
+{
+	meshlets.clear();
+
+	// A handful of meshlets cost more in dispatches than they save in triangles.
+	if (lods.empty() || lods[0].indexCount < 3 * MESHLET_MAX_TRIANGLES * 8)
+	{
+		return;
 	}
-}
\ No newline at end of file
+
+	MeshletBuilder::Build(vertices, indices.data() + lods[0].firstIndex, lods[0].indexCount, lods[0].firstIndex, meshlets);
+}
@@ -4,10 +4,14 @@
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <functional>
 #include <memory>
 #include "core/Buffer.h"
+#include "core/GeometryPool.h"
 #include <vulkan/vulkan.h>
 #include "core/Descriptors.h"
+#include "core/MappedFile.h"
+#include "model/ObjParser.h"
 
 class Model
 {
@@ -26,24 +30,165 @@ public:
 		}
 	};
 
+	enum class VertexFormat
+	{
+		Full,
+		Compact
+	};
+
+	// 16 bytes GPU layout: position quantized to unorm16 against the mesh box with an RGB565 color in w,
+	// octahedral snorm16 normal and half float uv. Positions are brought back to object space by the
+	// dequantization matrix, which the render system folds into the model matrix.
+	struct CompactVertex
+	{
+		uint16_t position[3];
+		uint16_t color;
+		int16_t normal[2];
+		uint16_t uv[2];
+
+		static CompactVertex Encode(const Vertex& _vertex, const glm::vec3& _boxMin, const glm::vec3& _boxInvExtent);
+
+		static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
+		static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+	};
+
 public:
+	// Sub-range of the index buffer, error is the object space deviation from the full detail mesh.
+	struct Lod
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f;
+	};
+
+	struct Bounds
+	{
+		glm::vec3 center{};
+		float radius = 0.0f;
+	};
+
+	static constexpr uint32_t MAX_LODS = 5;
+
+	// Cluster of lod 0 triangles, culled as a whole on the GPU. Laid out as the std430 struct of meshlet_cull.comp.
+	// Triangles are backfacing from every point where dot(normalize(coneApex - eye), coneAxis) >= coneCutoff,
+	// a cutoff above 1 means the normals spread too much for the cone test.
+	struct Meshlet
+	{
+		glm::vec3 center{};
+		float radius = 0.0f;
+		glm::vec3 coneAxis{};
+		float coneCutoff = 2.0f;
+		glm::vec3 coneApex{};
+		float _padding = 0.0f;
+		uint32_t firstIndex = 0;
+		uint32_t triangleCount = 0;
+		uint32_t _padding2[2] = {};
+	};
+
+	static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	// Non-owning view over mesh data, filled either from a Builder or from a mapped cooked file.
+	struct MeshData
+	{
+		const Vertex* vertices = nullptr;
+		uint32_t vertexCount = 0;
+		// uint16_t or uint32_t elements depending on indexType.
+		const void* indices = nullptr;
+		uint32_t indexCount = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		const Lod* lods = nullptr;
+		uint32_t lodCount = 0;
+		const Meshlet* meshlets = nullptr;
+		uint32_t meshletCount = 0;
+		Bounds bounds{};
+	};
+
+	// Mesh read in place from where it is stored, a glTF file for instance. readVertices converts the vertices
+	// [_first, _first + _count) straight into the upload memory, so no Vertex array of the whole mesh is built.
+	// The box must enclose every position, it gives the bounds and the compact quantization range.
+	struct StreamData
+	{
+		uint32_t vertexCount = 0;
+		std::function<void(uint32_t _first, uint32_t _count, Vertex* _vertices)> readVertices;
+		glm::vec3 boxMin{};
+		glm::vec3 boxMax{};
+		// uint16_t or uint32_t elements depending on indexType, null to draw the vertices in order.
+		const void* indices = nullptr;
+		uint32_t indexCount = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	};
+
 	struct Builder 
 	{
 		std::vector<Vertex> vertices{};
 		std::vector<uint32_t> indices{};
+		std::vector<Lod> lods{};
+		std::vector<Meshlet> meshlets{};
+		Bounds bounds{};
 
 		void LoadModel(const std::string& _filePath);
+		// Fills vertices and indices from parsed OBJ records, merging identical corners.
+		void LoadObj(const ObjParser::Result& _obj);
+		void GenerateLods();
+		// Reorders indices and vertices for the post-transform cache, overdraw and vertex fetch.
+		void OptimizeMesh();
+		// Splits lod 0 in place into meshlets, to run after OptimizeMesh so the index order is final.
+		void BuildMeshlets();
+		MeshData GetMeshData() const;
 	};
 
-	Model(Device& _device, const Model::Builder& _builder);
+	Model(Device& _device, const Model::Builder& _builder, VertexFormat _format = s_defaultVertexFormat);
+	Model(Device& _device, const MeshData& _data, VertexFormat _format = s_defaultVertexFormat);
+	// Single lod and no meshlets, the source is expected to be optimized already.
+	Model(Device& _device, const StreamData& _data, VertexFormat _format = s_defaultVertexFormat);
 	~Model();
 
 	Model(const Model&) = delete;
 	Model operator =(const Model&) = delete;
 
 	void Bind(VkCommandBuffer _commandBuffer);
-	void Draw(VkCommandBuffer _commandBuffer);
-
+	void Draw(VkCommandBuffer _commandBuffer, uint32_t _lod = 0);
+
+	// Picks the coarsest lod whose error stays under _pixelThreshold once projected on screen.
+	// _projectionScale is the number of pixels covered by one unit at distance one.
+	uint32_t SelectLod(float _distance, float _objectScale, float _projectionScale, float _pixelThreshold = 1.0f) const;
+
+	uint32_t GetLodCount() const { return static_cast<uint32_t>(m_lods.size()); }
+	uint32_t GetTriangleCount(uint32_t _lod = 0) const;
+	const Bounds& GetBounds() const { return m_bounds; }
+
+	VertexFormat GetVertexFormat() const { return m_vertexFormat; }
+	// Object space from the stored positions, identity for the full format.
+	const glm::mat4& GetDequantization() const { return m_dequantization; }
+
+	// Format used by models created without an explicit one, compact needs the matching shaders.
+	static void SetDefaultVertexFormat(VertexFormat _format) { s_defaultVertexFormat = _format; }
+
+	VkIndexType GetIndexType() const { return m_indexType; }
+
+	// Vertices and indices are ranges of the device geometry pool, models sharing a vertex format and an index type
+	// share the same buffers, so callers only need to Bind again when these change.
+	VkBuffer GetVertexBuffer() const;
+	VkBuffer GetIndexBuffer() const;
+	// vertexOffset of the draw commands, moves when the pool is defragmented.
+	uint32_t GetBaseVertex() const;
+	// Device memory of the vertices, indices and meshlets.
+	VkDeviceSize GetMemorySize() const;
+
+	bool HasMeshlets() const { return m_meshletCount > 0; }
+	uint32_t GetMeshletCount() const { return m_meshletCount; }
+	// Both are bound as storage buffers by the meshlet culling pass, meshlet first indices are relative to the index range.
+	Buffer* GetMeshletBuffer() const { return m_meshletBuffer.get(); }
+	VkDescriptorBufferInfo GetIndexBufferInfo() const;
+
+	// 16-bit whenever every vertex can be addressed, which halves the index buffer.
+	static VkIndexType SelectIndexType(uint32_t _vertexCount) { return _vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+	static uint32_t GetIndexSize(VkIndexType _indexType) { return _indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+	// CPU half of CreateModelFromFile, safe on any thread: the data points into _cookedFile on a cache hit and into
+	// _builder otherwise, both must outlive the Model construction.
+	static MeshData LoadMeshData(const std::string& _filePath, MappedFile& _cookedFile, Builder& _builder);
 	static std::unique_ptr<Model> CreateModelFromFile(Device& _device, const std::string& _filePath);
 
 	void SetTexture(std::shared_ptr<Texture> _texture) { m_texture = _texture; }
@@ -52,20 +197,30 @@ public:
 	void SetTextureDescriptorSet(VkDescriptorSet set) { m_textureDescriptorSet = set; }
 	VkDescriptorSet GetTextureDescriptorSet() const { return m_textureDescriptorSet; }
 
-	static std::shared_ptr<Model> CreateModelWithTexture(Device& _device,const std::string& _modelPath,const std::string& _texturePath,DescriptorSetLayout& _textureSetLayout,DescriptorPool& _texturePool);
-
 private:
-	void CreateVertexBuffers(const std::vector<Vertex>& _vertices);
-	void CreateIndexBuffers(const std::vector<uint32_t>& _indices);
+	void CreateVertexBuffers(const Vertex* _vertices, uint32_t _vertexCount);
+	void CreateCompactVertexBuffers(const Vertex* _vertices, uint32_t _vertexCount);
+	void UploadVertexBuffer(const void* _vertices, uint32_t _vertexSize, uint32_t _vertexCount);
+	void CreateIndexBuffers(const void* _indices, uint32_t _indexCount, VkIndexType _indexType, uint32_t _vertexCount);
+	void CreateMeshletBuffer(const Meshlet* _meshlets, uint32_t _meshletCount);
 
 	Device& m_device;
-	std::unique_ptr<Buffer> m_vertexBuffer;
+	GeometryPool::Handle m_vertexAllocation = GeometryPool::INVALID_HANDLE;
 	uint32_t m_vertexCount;
+	VertexFormat m_vertexFormat = VertexFormat::Full;
+	glm::mat4 m_dequantization{ 1.0f };
 
 	bool m_hasIndexBuffer = false;
-	std::unique_ptr<Buffer> m_indexBuffer;
+	GeometryPool::Handle m_indexAllocation = GeometryPool::INVALID_HANDLE;
 	uint32_t m_indexCount;
+	VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
+	std::vector<Lod> m_lods{};
+	std::unique_ptr<Buffer> m_meshletBuffer;
+	uint32_t m_meshletCount = 0;
+	Bounds m_bounds{};
 	std::shared_ptr<Texture> m_texture = nullptr;
 	VkDescriptorSet m_textureDescriptorSet = VK_NULL_HANDLE;
+
+	static inline VertexFormat s_defaultVertexFormat = VertexFormat::Full;
 };
 
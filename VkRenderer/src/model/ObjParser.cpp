@@ -0,0 +1,568 @@
+#include "model/ObjParser.h"
+#include "core/MappedFile.h"
+#include "core/ThreadPool.h"
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	const size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+	const uint8_t RELATIVE_VERTEX = 1 << 0;
+	const uint8_t RELATIVE_TEXCOORD = 1 << 1;
+	const uint8_t RELATIVE_NORMAL = 1 << 2;
+
+	inline bool IsSpace(char _c)
+	{
+		return _c == ' ' || _c == '\t';
+	}
+
+	inline bool IsDigit(char _c)
+	{
+		return _c >= '0' && _c <= '9';
+	}
+
+	inline const char* SkipSpaces(const char* _p, const char* _end)
+	{
+		while (_p < _end && IsSpace(*_p))
+			_p++;
+		return _p;
+	}
+
+	inline const char* TokenEnd(const char* _p, const char* _end)
+	{
+		while (_p < _end && !IsSpace(*_p))
+			_p++;
+		return _p;
+	}
+
+	// Same digit accumulation as tinyobjloader's tryParseDouble. A correctly rounded parser (from_chars, strtod)
+	// can land one float ulp away on some inputs, which would break dedup equality with the reference loader.
+	bool TryParseDouble(const char* _s, const char* _end, double* _result)
+	{
+		if (_s >= _end)
+			return false;
+
+		double mantissa = 0.0;
+		int exponent = 0;
+		char sign = '+';
+		char exponentSign = '+';
+		const char* curr = _s;
+		int read = 0;
+		bool endNotReached = false;
+		bool leadingDecimalDots = false;
+
+		if (*curr == '+' || *curr == '-')
+		{
+			sign = *curr;
+			curr++;
+			if (curr != _end && *curr == '.')
+				leadingDecimalDots = true;
+		}
+		else if (IsDigit(*curr))
+		{
+		}
+		else if (*curr == '.')
+		{
+			leadingDecimalDots = true;
+		}
+		else
+		{
+			return false;
+		}
+
+		endNotReached = curr != _end;
+		if (!leadingDecimalDots)
+		{
+			while (endNotReached && IsDigit(*curr))
+			{
+				mantissa *= 10;
+				mantissa += static_cast<int>(*curr - '0');
+				curr++;
+				read++;
+				endNotReached = curr != _end;
+			}
+
+			if (read == 0)
+				return false;
+		}
+
+		if (endNotReached)
+		{
+			bool hasExponent = false;
+
+			if (*curr == '.')
+			{
+				static const double POW_LUT[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+				const int lutEntries = sizeof(POW_LUT) / sizeof(POW_LUT[0]);
+
+				curr++;
+				read = 1;
+				endNotReached = curr != _end;
+				while (endNotReached && IsDigit(*curr))
+				{
+					mantissa += static_cast<int>(*curr - '0') * (read < lutEntries ? POW_LUT[read] : std::pow(10.0, -read));
+					read++;
+					curr++;
+					endNotReached = curr != _end;
+				}
+				hasExponent = endNotReached && (*curr == 'e' || *curr == 'E');
+			}
+			else
+			{
+				hasExponent = *curr == 'e' || *curr == 'E';
+			}
+
+			if (hasExponent)
+			{
+				curr++;
+				endNotReached = curr != _end;
+				if (endNotReached && (*curr == '+' || *curr == '-'))
+				{
+					exponentSign = *curr;
+					curr++;
+				}
+				else if (!endNotReached || !IsDigit(*curr))
+				{
+					return false;
+				}
+
+				read = 0;
+				endNotReached = curr != _end;
+				while (endNotReached && IsDigit(*curr))
+				{
+					if (exponent > 2147483647 / 10)
+						return false;
+
+					exponent *= 10;
+					exponent += static_cast<int>(*curr - '0');
+					curr++;
+					read++;
+					endNotReached = curr != _end;
+				}
+				exponent *= exponentSign == '+' ? 1 : -1;
+				if (read == 0)
+					return false;
+			}
+		}
+
+		*_result = (sign == '+' ? 1 : -1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+		return true;
+	}
+
+	inline float ParseReal(const char*& _p, const char* _end, double _default = 0.0)
+	{
+		_p = SkipSpaces(_p, _end);
+		const char* tokenEnd = TokenEnd(_p, _end);
+		double value = _default;
+		TryParseDouble(_p, tokenEnd, &value);
+		_p = tokenEnd;
+		return static_cast<float>(value);
+	}
+
+	inline bool ParseReal(const char*& _p, const char* _end, float* _out)
+	{
+		_p = SkipSpaces(_p, _end);
+		const char* tokenEnd = TokenEnd(_p, _end);
+		double value = 0.0;
+		bool parsed = TryParseDouble(_p, tokenEnd, &value);
+		if (parsed)
+			*_out = static_cast<float>(value);
+		_p = tokenEnd;
+		return parsed;
+	}
+
+	// atoi on a line that is not null terminated.
+	inline int ParseInt(const char* _p, const char* _end)
+	{
+		while (_p < _end && (IsSpace(*_p) || *_p == '\v' || *_p == '\f'))
+			_p++;
+
+		bool negative = false;
+		if (_p < _end && (*_p == '+' || *_p == '-'))
+		{
+			negative = *_p == '-';
+			_p++;
+		}
+
+		int value = 0;
+		while (_p < _end && IsDigit(*_p))
+		{
+			value = value * 10 + (*_p - '0');
+			_p++;
+		}
+		return negative ? -value : value;
+	}
+
+	inline const char* SkipIndexToken(const char* _p, const char* _end)
+	{
+		while (_p < _end && *_p != '/' && !IsSpace(*_p))
+			_p++;
+		return _p;
+	}
+
+	// Absolute indices are made zero based, relative ones are kept relative to the chunk and flagged.
+	inline bool FixIndex(int _index, int _localCount, bool _allowZero, int& _result, bool& _relative)
+	{
+		_relative = _index < 0;
+		if (_index > 0)
+		{
+			_result = _index - 1;
+			return true;
+		}
+		if (_index == 0)
+		{
+			_result = -1;
+			return _allowZero;
+		}
+		_result = _localCount + _index;
+		return true;
+	}
+}
+
+struct ObjParser::Chunk
+{
+	std::vector<float> positions{};
+	std::vector<float> colors{};
+	std::vector<float> normals{};
+	std::vector<float> texcoords{};
+	std::vector<Index> corners{};
+	std::vector<uint8_t> relativeFlags{};
+	std::vector<uint8_t> faceSizes{};
+	size_t triangleCount = 0;
+	bool failed = false;
+};
+
+void ObjParser::ParseReference(const std::string& _filePath, Result& _result)
+{
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warn, err;
+
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, _filePath.c_str())) 
+		throw std::runtime_error(warn + err);
+
+	_result.positions = std::move(attrib.vertices);
+	_result.colors = std::move(attrib.colors);
+	_result.normals = std::move(attrib.normals);
+	_result.texcoords = std::move(attrib.texcoords);
+
+	_result.indices.clear();
+	for (const auto& shape : shapes)
+	{
+		for (const auto& index : shape.mesh.indices)
+		{
+			_result.indices.push_back({ index.vertex_index, index.normal_index, index.texcoord_index });
+		}
+	}
+}
+
+bool ObjParser::Parse(const std::string& _filePath, Result& _result)
+{
+	MappedFile file{};
+	if (!file.Open(_filePath))
+		return false;
+
+	return Parse(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), _result);
+}
+
+bool ObjParser::Parse(const char* _data, size_t _size, Result& _result)
+{
+	ThreadPool& pool = ThreadPool::GetShared();
+
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(_size / MIN_CHUNK_SIZE, (pool.GetThreadCount() + 1) * 4));
+
+	// Chunk boundaries are moved forward to the next line start so no record is split.
+	std::vector<const char*> boundaries(chunkCount + 1);
+	boundaries[0] = _data;
+	boundaries[chunkCount] = _data + _size;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* p = std::max(_data + _size * i / chunkCount, boundaries[i - 1]);
+		const char* newLine = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(_data + _size - p)));
+		boundaries[i] = newLine ? newLine + 1 : _data + _size;
+	}
+
+	std::vector<Chunk> chunks(chunkCount);
+	pool.ParallelFor(chunkCount, [&](size_t _i)
+		{
+			ParseChunk(boundaries[_i], boundaries[_i + 1], chunks[_i]);
+		});
+
+	size_t positionCount = 0;
+	size_t normalCount = 0;
+	size_t texcoordCount = 0;
+	size_t triangleCount = 0;
+	for (const auto& chunk : chunks)
+	{
+		if (chunk.failed)
+			return false;
+
+		positionCount += chunk.positions.size();
+		normalCount += chunk.normals.size();
+		texcoordCount += chunk.texcoords.size();
+		triangleCount += chunk.triangleCount;
+	}
+
+	_result.positions.resize(positionCount);
+	_result.colors.resize(positionCount);
+	_result.normals.resize(normalCount);
+	_result.texcoords.resize(texcoordCount);
+	_result.indices.resize(triangleCount * 3);
+
+	struct Offsets
+	{
+		size_t position;
+		size_t normal;
+		size_t texcoord;
+		size_t index;
+	};
+
+	std::vector<Offsets> offsets(chunkCount);
+	Offsets running{};
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		offsets[i] = running;
+		running.position += chunks[i].positions.size();
+		running.normal += chunks[i].normals.size();
+		running.texcoord += chunks[i].texcoords.size();
+		running.index += chunks[i].triangleCount * 3;
+	}
+
+	pool.ParallelFor(chunkCount, [&](size_t _i)
+		{
+			const Chunk& chunk = chunks[_i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), _result.positions.begin() + offsets[_i].position);
+			std::copy(chunk.colors.begin(), chunk.colors.end(), _result.colors.begin() + offsets[_i].position);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), _result.normals.begin() + offsets[_i].normal);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), _result.texcoords.begin() + offsets[_i].texcoord);
+		});
+
+	const int vertexTotal = static_cast<int>(positionCount / 3);
+	const int normalTotal = static_cast<int>(normalCount / 3);
+	const int texcoordTotal = static_cast<int>(texcoordCount / 2);
+
+	// Quads need the merged positions to pick their diagonal, so indices are fixed up in a second pass.
+	std::atomic<bool> failed{ false };
+	pool.ParallelFor(chunkCount, [&](size_t _i)
+		{
+			const Chunk& chunk = chunks[_i];
+			const int vertexBase = static_cast<int>(offsets[_i].position / 3);
+			const int normalBase = static_cast<int>(offsets[_i].normal / 3);
+			const int texcoordBase = static_cast<int>(offsets[_i].texcoord / 2);
+
+			Index* out = _result.indices.data() + offsets[_i].index;
+			Index face[4];
+			size_t corner = 0;
+
+			for (uint8_t faceSize : chunk.faceSizes)
+			{
+				for (uint8_t k = 0; k < faceSize; k++, corner++)
+				{
+					Index index = chunk.corners[corner];
+					uint8_t relative = chunk.relativeFlags[corner];
+
+					if (relative & RELATIVE_VERTEX)
+						index.vertexIndex += vertexBase;
+					if (relative & RELATIVE_NORMAL)
+						index.normalIndex += normalBase;
+					if (relative & RELATIVE_TEXCOORD)
+						index.texcoordIndex += texcoordBase;
+
+					bool valid = index.vertexIndex >= 0 && index.vertexIndex < vertexTotal &&
+						index.normalIndex >= -1 && index.normalIndex < normalTotal &&
+						index.texcoordIndex >= -1 && index.texcoordIndex < texcoordTotal &&
+						!((relative & RELATIVE_NORMAL) && index.normalIndex < 0) &&
+						!((relative & RELATIVE_TEXCOORD) && index.texcoordIndex < 0);
+
+					if (!valid)
+					{
+						failed = true;
+						return;
+					}
+					face[k] = index;
+				}
+
+				if (faceSize == 3)
+				{
+					*out++ = face[0];
+					*out++ = face[1];
+					*out++ = face[2];
+					continue;
+				}
+
+				// Split along the shortest diagonal, as tinyobjloader triangulates quads.
+				const float* v0 = &_result.positions[3 * face[0].vertexIndex];
+				const float* v1 = &_result.positions[3 * face[1].vertexIndex];
+				const float* v2 = &_result.positions[3 * face[2].vertexIndex];
+				const float* v3 = &_result.positions[3 * face[3].vertexIndex];
+
+				float e02x = v2[0] - v0[0];
+				float e02y = v2[1] - v0[1];
+				float e02z = v2[2] - v0[2];
+				float e13x = v3[0] - v1[0];
+				float e13y = v3[1] - v1[1];
+				float e13z = v3[2] - v1[2];
+
+				float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+				float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+				if (sqr02 < sqr13)
+				{
+					*out++ = face[0];
+					*out++ = face[1];
+					*out++ = face[2];
+					*out++ = face[0];
+					*out++ = face[2];
+					*out++ = face[3];
+				}
+				else
+				{
+					*out++ = face[0];
+					*out++ = face[1];
+					*out++ = face[3];
+					*out++ = face[1];
+					*out++ = face[2];
+					*out++ = face[3];
+				}
+			}
+		});
+
+	return !failed;
+}
+
+void ObjParser::ParseChunk(const char* _begin, const char* _end, Chunk& _chunk)
+{
+	// Rough guess from typical record lengths to avoid most reallocations.
+	size_t bytes = static_cast<size_t>(_end - _begin);
+	_chunk.positions.reserve(bytes / 16);
+	_chunk.corners.reserve(bytes / 12);
+
+	const char* line = _begin;
+	while (line < _end && !_chunk.failed)
+	{
+		const char* lineEnd = line;
+		while (lineEnd < _end && *lineEnd != '\n' && *lineEnd != '\r')
+			lineEnd++;
+
+		const char* token = SkipSpaces(line, lineEnd);
+		line = lineEnd + 1;
+
+		if (token == lineEnd || *token == '#' || lineEnd - token < 2)
+			continue;
+
+		if (token[0] == 'v' && IsSpace(token[1]))
+		{
+			token += 2;
+			float x = ParseReal(token, lineEnd);
+			float y = ParseReal(token, lineEnd);
+			float z = ParseReal(token, lineEnd);
+
+			// A fourth value is read as red, like tinyobjloader does with its default vertex color fallback.
+			float r = 1.0f;
+			float g = 1.0f;
+			float b = 1.0f;
+			if (ParseReal(token, lineEnd, &r) && ParseReal(token, lineEnd, &g) && !ParseReal(token, lineEnd, &b))
+			{
+				r = g = b = 1.0f;
+			}
+
+			_chunk.positions.insert(_chunk.positions.end(), { x, y, z });
+			_chunk.colors.insert(_chunk.colors.end(), { r, g, b });
+		}
+		else if (token[0] == 'v' && token[1] == 'n' && lineEnd - token > 2 && IsSpace(token[2]))
+		{
+			token += 3;
+			float x = ParseReal(token, lineEnd);
+			float y = ParseReal(token, lineEnd);
+			float z = ParseReal(token, lineEnd);
+			_chunk.normals.insert(_chunk.normals.end(), { x, y, z });
+		}
+		else if (token[0] == 'v' && token[1] == 't' && lineEnd - token > 2 && IsSpace(token[2]))
+		{
+			token += 3;
+			float u = ParseReal(token, lineEnd);
+			float v = ParseReal(token, lineEnd);
+			_chunk.texcoords.insert(_chunk.texcoords.end(), { u, v });
+		}
+		else if (token[0] == 'f' && IsSpace(token[1]))
+		{
+			token = SkipSpaces(token + 2, lineEnd);
+
+			const int vertexCount = static_cast<int>(_chunk.positions.size() / 3);
+			const int normalCount = static_cast<int>(_chunk.normals.size() / 3);
+			const int texcoordCount = static_cast<int>(_chunk.texcoords.size() / 2);
+
+			uint8_t faceSize = 0;
+			while (token < lineEnd)
+			{
+				if (faceSize == 4)
+				{
+					_chunk.failed = true;
+					return;
+				}
+
+				Index index{ -1, -1, -1 };
+				uint8_t relative = 0;
+				bool isRelative = false;
+				bool valid = FixIndex(ParseInt(token, lineEnd), vertexCount, false, index.vertexIndex, isRelative);
+				relative |= isRelative ? RELATIVE_VERTEX : 0;
+				token = SkipIndexToken(token, lineEnd);
+
+				if (valid && token < lineEnd && *token == '/')
+				{
+					token++;
+					if (token < lineEnd && *token == '/')
+					{
+						token++;
+						valid = FixIndex(ParseInt(token, lineEnd), normalCount, true, index.normalIndex, isRelative);
+						relative |= isRelative ? RELATIVE_NORMAL : 0;
+						token = SkipIndexToken(token, lineEnd);
+					}
+					else
+					{
+						valid = FixIndex(ParseInt(token, lineEnd), texcoordCount, true, index.texcoordIndex, isRelative);
+						relative |= isRelative ? RELATIVE_TEXCOORD : 0;
+						token = SkipIndexToken(token, lineEnd);
+
+						if (valid && token < lineEnd && *token == '/')
+						{
+							token++;
+							valid = FixIndex(ParseInt(token, lineEnd), normalCount, true, index.normalIndex, isRelative);
+							relative |= isRelative ? RELATIVE_NORMAL : 0;
+							token = SkipIndexToken(token, lineEnd);
+						}
+					}
+				}
+
+				if (!valid)
+				{
+					_chunk.failed = true;
+					return;
+				}
+
+				_chunk.corners.push_back(index);
+				_chunk.relativeFlags.push_back(relative);
+				faceSize++;
+				token = SkipSpaces(token, lineEnd);
+			}
+
+			// Degenerate faces are dropped, as the reference loader does.
+			if (faceSize < 3)
+			{
+				_chunk.corners.resize(_chunk.corners.size() - faceSize);
+				_chunk.relativeFlags.resize(_chunk.relativeFlags.size() - faceSize);
+				continue;
+			}
+
+			_chunk.faceSizes.push_back(faceSize);
+			_chunk.triangleCount += faceSize - 2;
+		}
+	}
+}
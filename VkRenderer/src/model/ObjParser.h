@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Parallel parser for the OBJ records the renderer consumes (v, vt, vn, f).
+// The file is split on line boundaries and chunks are parsed concurrently, then merged with their index offsets.
+// Output mirrors tinyobj::attrib_t and the triangulated shape indices, number parsing and quad splitting follow
+// tinyobjloader so Model::Builder gets exactly the same vertices and indices out of both.
+class ObjParser
+{
+public:
+	// -1 when the corner has no such attribute, as in tinyobj::index_t.
+	struct Index
+	{
+		int vertexIndex;
+		int normalIndex;
+		int texcoordIndex;
+
+		bool operator==(const Index& _other) const { return vertexIndex == _other.vertexIndex && normalIndex == _other.normalIndex && texcoordIndex == _other.texcoordIndex; }
+	};
+
+	struct Result
+	{
+		std::vector<float> positions{};
+		std::vector<float> colors{};
+		std::vector<float> normals{};
+		std::vector<float> texcoords{};
+		std::vector<Index> indices{};
+	};
+
+	// Returns false when the file needs the reference loader: polygons with more than four corners,
+	// malformed face records or out of range indices.
+	static bool Parse(const std::string& _filePath, Result& _result);
+	static bool Parse(const char* _data, size_t _size, Result& _result);
+	// tinyobjloader, for the files Parse rejects and to check Parse against (ObjParserCheck).
+	static void ParseReference(const std::string& _filePath, Result& _result);
+
+private:
+	struct Chunk;
+
+	static void ParseChunk(const char* _begin, const char* _end, Chunk& _chunk);
+};
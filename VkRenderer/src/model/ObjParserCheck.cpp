@@ -0,0 +1,127 @@
+#include "model/ObjParserCheck.h"
+#include "model/ObjParser.h"
+#include "model/Model.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	// Every vertex form tinyobjloader reads (w lands in red) and every face record form, with relative indices.
+	const char* SAMPLE_OBJ =
+		"v 0 0 0\n"
+		"v 1.5 0 0 0.25\n"
+		"v 1.5 1.5 0 0.2 0.4 0.6\n"
+		"v 0 1.5 0 2\n"
+		"v -1e-3 2.5E+1 .5 1.0\n"
+		"vt 0 0\n"
+		"vt 1 0\n"
+		"vt 1 1\n"
+		"vt 0 1\n"
+		"vn 0 0 1\n"
+		"f 1 2 3\n"
+		"f 1/1 3/3 4/4\n"
+		"f 1//1 2//1 5//1\n"
+		"f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+		"f -5/-4/-1 -3/-2/-1 -1/-1/-1\n";
+
+	template<typename T>
+	bool Compare(const char* _name, const std::vector<T>& _parsed, const std::vector<T>& _reference, std::string& _error)
+	{
+		if (_parsed.size() != _reference.size())
+		{
+			_error = std::string(_name) + " count " + std::to_string(_parsed.size()) + " instead of " + std::to_string(_reference.size());
+			return false;
+		}
+
+		auto mismatch = std::mismatch(_parsed.begin(), _parsed.end(), _reference.begin());
+		if (mismatch.first != _parsed.end())
+		{
+			_error = std::string(_name) + " differ at " + std::to_string(mismatch.first - _parsed.begin());
+			return false;
+		}
+
+		return true;
+	}
+}
+
+bool ObjParserCheck::Run(const std::vector<std::string>& _filePaths)
+{
+	std::vector<std::string> filePaths = _filePaths;
+
+	if (filePaths.empty())
+	{
+		for (const auto& entry : std::filesystem::directory_iterator("models/"))
+		{
+			if (entry.path().extension() == ".obj")
+				filePaths.push_back(entry.path().string());
+		}
+		std::sort(filePaths.begin(), filePaths.end());
+
+		std::filesystem::path samplePath = std::filesystem::temp_directory_path() / "vkr_obj_parser_check.obj";
+		std::ofstream(samplePath, std::ios::binary) << SAMPLE_OBJ;
+		filePaths.push_back(samplePath.string());
+	}
+
+	size_t failureCount = 0;
+	for (const auto& filePath : filePaths)
+	{
+		try
+		{
+			if (!Check(filePath))
+				failureCount++;
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << filePath << ": " << e.what() << std::endl;
+			failureCount++;
+		}
+	}
+
+	std::cout << filePaths.size() - failureCount << "/" << filePaths.size() << " OBJ files match tinyobjloader" << std::endl;
+	return failureCount == 0;
+}
+
+bool ObjParserCheck::Check(const std::string& _filePath)
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	ObjParser::Result parsed{};
+	auto parseStart = Clock::now();
+	bool supported = ObjParser::Parse(_filePath, parsed);
+	std::chrono::duration<double, std::milli> parseTime = Clock::now() - parseStart;
+
+	ObjParser::Result reference{};
+	auto referenceStart = Clock::now();
+	ObjParser::ParseReference(_filePath, reference);
+	std::chrono::duration<double, std::milli> referenceTime = Clock::now() - referenceStart;
+
+	if (!supported)
+	{
+		std::cout << _filePath << ": left to tinyobjloader (" << referenceTime.count() << " ms)" << std::endl;
+		return true;
+	}
+
+	std::string error{};
+	bool same = Compare("positions", parsed.positions, reference.positions, error)
+		&& Compare("colors", parsed.colors, reference.colors, error)
+		&& Compare("normals", parsed.normals, reference.normals, error)
+		&& Compare("texcoords", parsed.texcoords, reference.texcoords, error)
+		&& Compare("corners", parsed.indices, reference.indices, error);
+
+	Model::Builder builder{};
+	Model::Builder referenceBuilder{};
+	if (same)
+	{
+		builder.LoadObj(parsed);
+		referenceBuilder.LoadObj(reference);
+		same = Compare("vertices", builder.vertices, referenceBuilder.vertices, error)
+			&& Compare("indices", builder.indices, referenceBuilder.indices, error);
+	}
+
+	std::cout << _filePath << ": " << (same ? "ok" : error) << ", " << builder.vertices.size() << " vertices, " << builder.indices.size() << " indices, "
+		<< parseTime.count() << " ms parallel, " << referenceTime.count() << " ms tinyobjloader" << std::endl;
+	return same;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Console check of ObjParser against tinyobjloader, run with "VkRenderer --verify-obj [files...]".
+// Without files it checks every OBJ in models/ and a generated file covering the xyz, xyzw and xyz rgb vertex forms.
+// Compares the parsed records and the vertices and indices Model::Builder expands from them, and times both loaders.
+class ObjParserCheck
+{
+public:
+	static bool Run(const std::vector<std::string>& _filePaths);
+
+private:
+	static bool Check(const std::string& _filePath);
+};
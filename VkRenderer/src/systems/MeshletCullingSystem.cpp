@@ -0,0 +1,237 @@
+#include "systems/MeshletCullingSystem.h"
+#include "core/PipelineCache.h"
+#include "core/ShaderCompiler.h"
+#include "core/Utils.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace
+{
+    const char* CULL_SHADER = "shaders/meshlet_cull_comp.spv";
+
+    const uint32_t FLAG_16BIT_INDICES = 1;
+    const uint32_t FLAG_CONE_CULLING = 2;
+
+    struct CullPushConstants
+    {
+        glm::vec4 frustumPlanes[6];
+        glm::vec4 cameraPosition;
+        uint32_t meshletCount;
+        uint32_t drawIndex;
+        uint32_t outputOffset;
+        uint32_t flags;
+    };
+
+    static_assert(sizeof(CullPushConstants) <= 128, "Push constants must fit the guaranteed 128 bytes");
+}
+
+MeshletCullingSystem::MeshletCullingSystem(Device& _device) : m_device{ _device }
+{
+    CreatePipeline();
+}
+
+MeshletCullingSystem::~MeshletCullingSystem()
+{
+    vkDestroyPipeline(m_device.GetDevice(), m_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device.GetDevice(), m_pipelineLayout, nullptr);
+}
+
+bool MeshletCullingSystem::IsSupported()
+{
+    return ShaderCompiler::Exists(CULL_SHADER);
+}
+
+void MeshletCullingSystem::CreatePipeline()
+{
+    m_descriptorSetLayout = DescriptorSetLayout::Builder(m_device)
+        .AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .Build();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullPushConstants);
+
+    std::vector<VkDescriptorSetLayout> setLayouts{ m_descriptorSetLayout->GetDescriptorSetLayout() };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create meshlet culling pipeline layout");
+
+    auto shaderCode = ShaderCompiler::GetShared().LoadSpirv(CULL_SHADER);
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = shaderCode.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(m_device.GetDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        throw std::runtime_error("failed to create meshlet culling shader module");
+
+    VkPipelineShaderStageCreateInfo shaderStageInfo{};
+    shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStageInfo.module = shaderModule;
+    shaderStageInfo.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shaderStageInfo;
+    pipelineInfo.layout = m_pipelineLayout;
+
+    VkResult result = m_device.GetPipelineCache().CreateComputePipeline(pipelineInfo, &m_pipeline);
+    vkDestroyShaderModule(m_device.GetDevice(), shaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to create meshlet culling pipeline");
+}
+
+void MeshletCullingSystem::BeginFrame(int _frameIndex, const glm::mat4& _viewProjection, const glm::vec3& _cameraPosition)
+{
+    m_frameIndex = _frameIndex;
+    m_viewProjection = _viewProjection;
+    m_cameraPosition = _cameraPosition;
+    m_draws.clear();
+    m_outputIndexCount = 0;
+}
+
+uint32_t MeshletCullingSystem::AddDraw(const Model& _model, const glm::mat4& _modelMatrix)
+{
+    assert(_model.HasMeshlets() && "Model has no meshlets");
+
+    PendingDraw draw{};
+    draw.model = &_model;
+    draw.outputOffset = m_outputIndexCount;
+
+    // Planes from the rows of the object to clip matrix (Gribb/Hartmann, depth in [0, 1]), so they come out in object
+    // space and the shader tests the untransformed meshlet bounds. Inside is positive.
+    glm::mat4 objectToClip = m_viewProjection * _modelMatrix;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(objectToClip[0][i], objectToClip[1][i], objectToClip[2][i], objectToClip[3][i]);
+    }
+
+    draw.frustumPlanes = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+    for (auto& plane : draw.frustumPlanes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        plane = length > 0.0f ? plane / length : plane;
+    }
+
+    draw.cameraPosition = glm::inverse(_modelMatrix) * glm::vec4(m_cameraPosition, 1.0f);
+
+    m_draws.push_back(draw);
+    m_outputIndexCount += _model.GetTriangleCount(0) * 3;
+    return static_cast<uint32_t>(m_draws.size() - 1);
+}
+
+void MeshletCullingSystem::ReserveFrameResources(FrameResources& _frame, uint32_t _drawCount, uint32_t _indexCount)
+{
+    // The frame fence has been waited on, this frame's buffers are no longer read by the GPU and can be replaced.
+    if (!_frame.drawCommandBuffer || _frame.drawCommandBuffer->GetInstanceCount() < _drawCount)
+    {
+        uint32_t capacity = std::max<uint32_t>(_drawCount * 2, 64);
+        _frame.drawCommandBuffer = std::make_unique<Buffer>(m_device, sizeof(VkDrawIndexedIndirectCommand), capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        _frame.drawCommandBuffer->Map();
+    }
+
+    if (!_frame.outputIndexBuffer || _frame.outputIndexBuffer->GetInstanceCount() < _indexCount)
+    {
+        uint32_t capacity = std::max<uint32_t>(_indexCount + _indexCount / 2, 3 * Model::MESHLET_MAX_TRIANGLES);
+        _frame.outputIndexBuffer = std::make_unique<Buffer>(m_device, sizeof(uint32_t), capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    if (_frame.descriptorCapacity < _drawCount)
+    {
+        _frame.descriptorCapacity = std::max<uint32_t>(_drawCount * 2, 64);
+        _frame.descriptorPool = DescriptorPool::Builder(m_device)
+            .SetMaxSets(_frame.descriptorCapacity)
+            .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _frame.descriptorCapacity * 4)
+            .Build();
+    }
+    else
+    {
+        _frame.descriptorPool->ResetPool();
+    }
+}
+
+void MeshletCullingSystem::Dispatch(VkCommandBuffer _commandBuffer)
+{
+    if (m_draws.empty())
+        return;
+
+    FrameResources& frame = m_frames[m_frameIndex];
+    ReserveFrameResources(frame, static_cast<uint32_t>(m_draws.size()), m_outputIndexCount);
+
+    // Every draw starts empty, the shader appends the surviving meshlets to indexCount. The culled indices stay
+    // relative to the model, which sits at its base vertex in the geometry pool.
+    auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(frame.drawCommandBuffer->GetMappedMemory());
+    for (size_t i = 0; i < m_draws.size(); i++)
+    {
+        commands[i] = { 0, 1, m_draws[i].outputOffset, static_cast<int32_t>(m_draws[i].model->GetBaseVertex()), 0 };
+    }
+
+    vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+    VkDescriptorBufferInfo outputInfo = frame.outputIndexBuffer->DescriptorInfo();
+    VkDescriptorBufferInfo commandInfo = frame.drawCommandBuffer->DescriptorInfo();
+
+    for (size_t i = 0; i < m_draws.size(); i++)
+    {
+        const PendingDraw& draw = m_draws[i];
+
+        VkDescriptorBufferInfo meshletInfo = draw.model->GetMeshletBuffer()->DescriptorInfo();
+        VkDescriptorBufferInfo indexInfo = draw.model->GetIndexBufferInfo();
+
+        VkDescriptorSet descriptorSet;
+        if (!DescriptorWriter(*m_descriptorSetLayout, *frame.descriptorPool)
+            .WriteBuffer(0, &meshletInfo)
+            .WriteBuffer(1, &indexInfo)
+            .WriteBuffer(2, &outputInfo)
+            .WriteBuffer(3, &commandInfo)
+            .Build(descriptorSet))
+            throw std::runtime_error("failed to allocate meshlet culling descriptor set");
+
+        vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+        CullPushConstants push{};
+        std::copy(draw.frustumPlanes.begin(), draw.frustumPlanes.end(), push.frustumPlanes);
+        push.cameraPosition = draw.cameraPosition;
+        push.meshletCount = draw.model->GetMeshletCount();
+        push.drawIndex = static_cast<uint32_t>(i);
+        push.outputOffset = draw.outputOffset;
+        push.flags = (draw.model->GetIndexType() == VK_INDEX_TYPE_UINT16 ? FLAG_16BIT_INDICES : 0) | (m_coneCulling ? FLAG_CONE_CULLING : 0);
+
+        vkCmdPushConstants(_commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+        vkCmdDispatch(_commandBuffer, push.meshletCount, 1, 1);
+    }
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void MeshletCullingSystem::Draw(VkCommandBuffer _commandBuffer, uint32_t _draw)
+{
+    assert(_draw < m_draws.size() && "Meshlet draw slot out of range");
+
+    FrameResources& frame = m_frames[m_frameIndex];
+    vkCmdBindIndexBuffer(_commandBuffer, frame.outputIndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexedIndirect(_commandBuffer, frame.drawCommandBuffer->GetBuffer(), _draw * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+}
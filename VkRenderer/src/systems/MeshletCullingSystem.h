@@ -0,0 +1,74 @@
+#pragma once
+#include "core/Device.h"
+#include "core/Buffer.h"
+#include "core/Descriptors.h"
+#include "core/SwapChain.h"
+#include "model/Model.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <memory>
+#include <vector>
+
+// GPU meshlet culling for lod 0 draws, without mesh shaders.
+// Draws are registered each frame, Dispatch culls their meshlets against the frustum and the normal cones into a
+// compacted per frame index buffer, then each draw is issued with vkCmdDrawIndexedIndirect.
+// Dispatch records compute work and must happen outside of the render pass.
+class MeshletCullingSystem
+{
+public:
+    MeshletCullingSystem(Device& _device);
+    ~MeshletCullingSystem();
+
+    MeshletCullingSystem(const MeshletCullingSystem&) = delete;
+    MeshletCullingSystem& operator=(const MeshletCullingSystem&) = delete;
+
+    // The culling shader ships as a separate binary, the render system falls back to plain draws without it.
+    static bool IsSupported();
+
+    void BeginFrame(int _frameIndex, const glm::mat4& _viewProjection, const glm::vec3& _cameraPosition);
+    // Returns the draw slot to pass to Draw, _modelMatrix is the object to world transform of the meshlet bounds.
+    uint32_t AddDraw(const Model& _model, const glm::mat4& _modelMatrix);
+    void Dispatch(VkCommandBuffer _commandBuffer);
+    // Binds the culled index buffer over the geometry pool one, call after Model::Bind.
+    void Draw(VkCommandBuffer _commandBuffer, uint32_t _draw);
+
+    // Cone culling only removes back faces, exact for closed meshes but the default pipelines do not cull back
+    // faces, so open meshes seen from behind lose triangles.
+    void SetConeCulling(bool _enabled) { m_coneCulling = _enabled; }
+
+private:
+    struct PendingDraw
+    {
+        const Model* model;
+        std::array<glm::vec4, 6> frustumPlanes;
+        glm::vec4 cameraPosition;
+        uint32_t outputOffset;
+    };
+
+    struct FrameResources
+    {
+        std::unique_ptr<DescriptorPool> descriptorPool;
+        uint32_t descriptorCapacity = 0;
+        std::unique_ptr<Buffer> drawCommandBuffer;
+        std::unique_ptr<Buffer> outputIndexBuffer;
+    };
+
+    void CreatePipeline();
+    void ReserveFrameResources(FrameResources& _frame, uint32_t _drawCount, uint32_t _indexCount);
+
+    Device& m_device;
+
+    std::unique_ptr<DescriptorSetLayout> m_descriptorSetLayout;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+    std::array<FrameResources, SwapChain::MAX_FRAMES_IN_FLIGHT> m_frames{};
+    int m_frameIndex = 0;
+    glm::mat4 m_viewProjection{ 1.0f };
+    glm::vec3 m_cameraPosition{ 0.0f };
+
+    std::vector<PendingDraw> m_draws{};
+    uint32_t m_outputIndexCount = 0;
+    bool m_coneCulling = false;
+};
@@ -2,11 +2,16 @@
 #include "core/Utils.h"
 #include "core/SwapChain.h"
 #include "core/FrameInfo.h"
+#include "core/StagingRing.h"
+#include "core/PipelineCache.h"
+#include "core/PipelineLibrary.h"
+#include "core/ShaderCompiler.h"
 #include "systems/EntityComponentSystem.h"
 #include "components/ParticleSystemComponent.h"
 #include "components/TransformComponent.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstring>
 #include <stdexcept>
 #include <random>
 #include <ctime>
@@ -18,21 +23,47 @@ struct RenderPushConstants
     glm::vec3 particleColor;
 };
 
-ParticleRenderSystem::ParticleRenderSystem(Device& _device, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits _msaaSamples, uint32_t _maxParticles, float _particleSize, glm::vec3 _particleColor)
+ParticleRenderSystem::ParticleRenderSystem(Device& _device, PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits _msaaSamples, uint32_t _maxParticles, float _particleSize, glm::vec3 _particleColor)
     : m_device{ _device }, m_msaaSamples{ _msaaSamples }, m_maxParticles{ _maxParticles }, m_particleSize{ _particleSize }, m_particleColor{ _particleColor }
 {
     CreatePipelineLayout(_globalSetLayout);
-    CreatePipeline(_renderPass, _msaaSamples);
+    CreatePipeline(_buildQueue, _renderPass, _msaaSamples);
     CreateVertexBuffer();
     CreateParticleBuffer();
+    // The first frame already simulates and draws the particles.
+    m_device.GetStagingRing().Flush();
     CreateComputePipeline();
     CreateComputeDescriptorSet();
+    if (m_device.HasAsyncComputeQueue())
+        CreateAsyncComputeResources();
 }
 
 ParticleRenderSystem::~ParticleRenderSystem()
 {
     vkDestroyBuffer(m_device.GetDevice(), m_vertexBuffer, nullptr);
-    vkFreeMemory(m_device.GetDevice(), m_vertexBufferMemory, nullptr);
+    m_device.FreeMemory(m_vertexBufferMemory);
+
+    if (m_computeCommandPool != VK_NULL_HANDLE)
+    {
+        vkWaitForFences(m_device.GetDevice(), SwapChain::MAX_FRAMES_IN_FLIGHT, m_computeFences.data(), VK_TRUE, UINT64_MAX);
+        for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            vkDestroyFence(m_device.GetDevice(), m_computeFences[i], nullptr);
+            vkDestroySemaphore(m_device.GetDevice(), m_simulatedSemaphores[i], nullptr);
+            vkDestroySemaphore(m_device.GetDevice(), m_releasedSemaphores[i], nullptr);
+        }
+        for (VkSemaphore semaphore : m_handoffSemaphores)
+        {
+            vkDestroySemaphore(m_device.GetDevice(), semaphore, nullptr);
+        }
+        vkDestroyCommandPool(m_device.GetDevice(), m_computeCommandPool, nullptr);
+    }
+
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        vkDestroyBuffer(m_device.GetDevice(), m_particleBuffers[i], nullptr);
+        m_device.FreeMemory(m_particleBufferMemory[i]);
+    }
     
     if (m_computePipeline != VK_NULL_HANDLE) 
     {
@@ -42,10 +73,6 @@ ParticleRenderSystem::~ParticleRenderSystem()
     {
         vkDestroyPipelineLayout(m_device.GetDevice(), m_computePipelineLayout, nullptr);
     }
-    if (m_pipelineLayout != VK_NULL_HANDLE) 
-    {
-        vkDestroyPipelineLayout(m_device.GetDevice(), m_pipelineLayout, nullptr);
-    }
 }
 
 void ParticleRenderSystem::CreateParticleBuffer()
@@ -88,16 +115,37 @@ void ParticleRenderSystem::CreateParticleBuffer()
         p.pad3 = 0.0f;
         p.pad4 = glm::vec2(0.0f);
     }
-    m_particleBuffer = std::make_unique<Buffer>(m_device,sizeof(Particle),m_maxParticles,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    
-    Buffer stagingBuffer(m_device, sizeof(Particle), m_maxParticles,VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    
-    stagingBuffer.Map();
-    stagingBuffer.WriteToBuffer(particles.data());
-    stagingBuffer.Flush(VK_WHOLE_SIZE);
-    m_device.CopyBuffer(stagingBuffer.GetBuffer(), m_particleBuffer->GetBuffer(), m_particleBuffer->GetBufferSize());
-    stagingBuffer.Unmap();
+
+    QueueFamilyIndices indices = m_device.FindPhysicalQueueFamilies();
+    uint32_t queueFamilies[] = { indices.graphicsFamily.value(), indices.computeFamily.value() };
+
+    m_particleBufferSize = sizeof(Particle) * m_maxParticles;
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_particleBufferSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (queueFamilies[0] != queueFamilies[1])
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = queueFamilies;
+    }
+
+    // Both buffers start from the same particles, the first frame copies the other one. The copies are recorded on the
+    // graphics half of the ring, the transfer family is not one the buffers are shared with.
+    StagingRing& stagingRing = m_device.GetStagingRing();
+    StagingRing::Allocation staging = stagingRing.Allocate(m_particleBufferSize);
+    memcpy(staging.data, particles.data(), static_cast<size_t>(m_particleBufferSize));
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = staging.offset;
+    copyRegion.size = m_particleBufferSize;
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        m_device.CreateBufferWithInfo(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_particleBuffers[i], m_particleBufferMemory[i]);
+        vkCmdCopyBuffer(stagingRing.GetCommandBuffer(), staging.buffer, m_particleBuffers[i], 1, &copyRegion);
+    }
 }
 
 void ParticleRenderSystem::Render(FrameInfo& _frameInfo, VkDescriptorSet _descriptorSet)
@@ -116,23 +164,12 @@ void ParticleRenderSystem::Render(FrameInfo& _frameInfo, VkDescriptorSet _descri
 
 void ParticleRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayout)
 {
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ _globalSetLayout };
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-    if (vkCreatePipelineLayout(m_device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) 
-        throw std::runtime_error("failed to create particle pipeline layout");
-    
+    m_pipelineLayout = m_device.GetPipelineLibrary().GetPipelineLayout({ _globalSetLayout }, {});
 }
 
-void ParticleRenderSystem::CreatePipeline(VkRenderPass _renderPass, VkSampleCountFlagBits _msaaSamples)
+void ParticleRenderSystem::CreatePipeline(PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkSampleCountFlagBits _msaaSamples)
 {
-    PipelineConfigInfo pipelineConfig{};
+    PipelineConfigInfo& pipelineConfig = _buildQueue.Add(m_pipeline, "shaders/particle_vert.spv", "shaders/particle_frag.spv");
     Pipeline::DefaultPipelineConfigInfo(pipelineConfig);
     Pipeline::EnableFireParticleBlending(pipelineConfig);
     
@@ -157,8 +194,6 @@ void ParticleRenderSystem::CreatePipeline(VkRenderPass _renderPass, VkSampleCoun
     attributeDescription.format = VK_FORMAT_R32G32_SFLOAT;
     attributeDescription.offset = 0;
     pipelineConfig.attributeDescriptions.push_back(attributeDescription);
-
-    m_pipeline = std::make_unique<Pipeline>(m_device, "shaders/particle_vert.spv", "shaders/particle_frag.spv", pipelineConfig);
 }
 
 void ParticleRenderSystem::CreateVertexBuffer()
@@ -175,23 +210,9 @@ void ParticleRenderSystem::CreateVertexBuffer()
 
     VkDeviceSize bufferSize = sizeof(float) * vertices.size();
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    m_device.CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                         stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(m_device.GetDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(m_device.GetDevice(), stagingBufferMemory);
-
     m_device.CreateBuffer(bufferSize,VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,m_vertexBuffer,m_vertexBufferMemory);
 
-    m_device.CopyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
-
-    vkDestroyBuffer(m_device.GetDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(m_device.GetDevice(), stagingBufferMemory, nullptr);
+    m_device.GetStagingRing().UploadToBuffer(m_vertexBuffer, 0, vertices.data(), bufferSize);
 } 
 
 void ParticleRenderSystem::CreateComputePipeline()
@@ -218,7 +239,7 @@ void ParticleRenderSystem::CreateComputePipeline()
         throw std::runtime_error("failed to create compute pipeline layout");
     
 
-    auto computeShaderCode = Utils::ReadFile("shaders/particle_comp.spv");
+    auto computeShaderCode = ShaderCompiler::GetShared().LoadSpirv("shaders/particle_comp.spv");
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     createInfo.codeSize = computeShaderCode.size();
@@ -242,7 +263,7 @@ void ParticleRenderSystem::CreateComputePipeline()
     pipelineInfo.stage = shaderStageInfo;
     pipelineInfo.layout = m_computePipelineLayout;
 
-    if (vkCreateComputePipelines(m_device.GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_computePipeline) != VK_SUCCESS) 
+    if (m_device.GetPipelineCache().CreateComputePipeline(pipelineInfo, &m_computePipeline) != VK_SUCCESS) 
         throw std::runtime_error("failed to create compute pipeline");
     
 
@@ -253,24 +274,159 @@ void ParticleRenderSystem::CreateComputePipeline()
 void ParticleRenderSystem::CreateComputeDescriptorSet()
 {
     m_computeDescriptorPool = DescriptorPool::Builder(m_device)
-        .SetMaxSets(1)
-        .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1)
+        .SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+        .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
         .Build();
 
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_particleBuffer->GetBuffer();
-    bufferInfo.offset = 0;
-    bufferInfo.range = m_particleBuffer->GetBufferSize();
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        VkDescriptorBufferInfo bufferInfo = GetParticleBufferInfo(i);
+        DescriptorWriter(*m_computeDescriptorSetLayout, *m_computeDescriptorPool)
+            .WriteBuffer(0, &bufferInfo)
+            .Build(m_computeDescriptorSets[i]);
+    }
+}
+
+void ParticleRenderSystem::CreateAsyncComputeResources()
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_device.FindPhysicalQueueFamilies().computeFamily.value();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(m_device.GetDevice(), &poolInfo, nullptr, &m_computeCommandPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create compute command pool");
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = m_computeCommandPool;
+    allocInfo.commandBufferCount = SwapChain::MAX_FRAMES_IN_FLIGHT;
+    if (vkAllocateCommandBuffers(m_device.GetDevice(), &allocInfo, m_computeCommandBuffers.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate compute command buffers");
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        if (vkCreateFence(m_device.GetDevice(), &fenceInfo, nullptr, &m_computeFences[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(m_device.GetDevice(), &semaphoreInfo, nullptr, &m_simulatedSemaphores[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(m_device.GetDevice(), &semaphoreInfo, nullptr, &m_releasedSemaphores[i]) != VK_SUCCESS)
+            throw std::runtime_error("failed to create compute synchronization objects");
+    }
+    for (VkSemaphore& semaphore : m_handoffSemaphores)
+    {
+        if (vkCreateSemaphore(m_device.GetDevice(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+            throw std::runtime_error("failed to create compute synchronization objects");
+    }
+}
+
+void ParticleRenderSystem::UpdateParticlesWithCompute(FrameInfo& _frameInfo, Renderer& _renderer, const ParticleSystemComponent& _params, const TransformComponent& _transform)
+{
+    bool async = _params.asyncCompute && m_computeCommandPool != VK_NULL_HANDLE;
+    if (async)
+    {
+        SimulateAsync(_frameInfo, _renderer, _params, _transform);
+    }
+    else
+    {
+        if (m_computeCommandPool != VK_NULL_HANDLE)
+        {
+            // Waiting on the previous handoff on the same queue costs nothing and keeps a single one pending.
+            int handoff = (m_pendingHandoff + 1) % static_cast<int>(m_handoffSemaphores.size());
+            if (m_pendingHandoff >= 0)
+                _renderer.AddWaitSemaphore(m_handoffSemaphores[m_pendingHandoff], VK_PIPELINE_STAGE_TRANSFER_BIT);
+            _renderer.AddSignalSemaphore(m_handoffSemaphores[handoff]);
+            m_pendingHandoff = handoff;
+        }
+
+        // Earlier frames of this queue read the buffer, frames of the compute queue are covered by the semaphore the
+        // previous frame waited on.
+        RecordSimulation(_frameInfo.commandBuffer, _frameInfo.frameIndex, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, _frameInfo.frameTime, _params, _transform);
+
+        VkMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(_frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+void ParticleRenderSystem::SimulateAsync(FrameInfo& _frameInfo, Renderer& _renderer, const ParticleSystemComponent& _params, const TransformComponent& _transform)
+{
+    int frameIndex = _frameInfo.frameIndex;
+    VkCommandBuffer commandBuffer = m_computeCommandBuffers[frameIndex];
+
+    vkWaitForFences(m_device.GetDevice(), 1, &m_computeFences[frameIndex], VK_TRUE, UINT64_MAX);
+    vkResetFences(m_device.GetDevice(), 1, &m_computeFences[frameIndex]);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin compute command buffer");
+
+    RecordSimulation(commandBuffer, frameIndex, 0, _frameInfo.frameTime, _params, _transform);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to record compute command buffer");
+
+    // The copy is the first command, reading the previous buffer and writing this frame's.
+    std::array<VkSemaphore, 2> waitSemaphores{};
+    std::array<VkPipelineStageFlags, 2> waitStages{ VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+    uint32_t waitCount = 0;
+    if (m_releasePending[frameIndex])
+        waitSemaphores[waitCount++] = m_releasedSemaphores[frameIndex];
+    // The last frames simulated on the graphics queue, the signal also covers the ones submitted before it.
+    if (m_pendingHandoff >= 0)
+    {
+        waitSemaphores[waitCount++] = m_handoffSemaphores[m_pendingHandoff];
+        m_pendingHandoff = -1;
+    }
 
-    DescriptorWriter(*m_computeDescriptorSetLayout, *m_computeDescriptorPool)
-        .WriteBuffer(0, &bufferInfo)
-        .Build(m_computeDescriptorSet);
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = waitCount;
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_simulatedSemaphores[frameIndex];
+    if (vkQueueSubmit(m_device.GetComputeQueue(), 1, &submitInfo, m_computeFences[frameIndex]) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit particle simulation");
+
+    // Everything before the vertex shaders, the culling compute and the opaque geometry, still overlaps the simulation.
+    _renderer.AddWaitSemaphore(m_simulatedSemaphores[frameIndex], VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+    _renderer.AddSignalSemaphore(m_releasedSemaphores[frameIndex]);
+    m_releasePending[frameIndex] = true;
 }
 
-void ParticleRenderSystem::UpdateParticlesWithCompute(float _deltaTime, VkCommandBuffer _commandBuffer, const ParticleSystemComponent& _params, const TransformComponent& _transform)
+void ParticleRenderSystem::RecordSimulation(VkCommandBuffer _commandBuffer, int _frameIndex, VkPipelineStageFlags _previousReaders, float _deltaTime, const ParticleSystemComponent& _params, const TransformComponent& _transform)
 {
+    int previousFrame = (_frameIndex + SwapChain::MAX_FRAMES_IN_FLIGHT - 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+    // The previous simulation wrote the source, earlier frames read the destination.
+    VkMemoryBarrier copyBarrier{};
+    copyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    copyBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    copyBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | _previousReaders, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &copyBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = m_particleBufferSize;
+    vkCmdCopyBuffer(_commandBuffer, m_particleBuffers[previousFrame], m_particleBuffers[_frameIndex], 1, &copyRegion);
+
+    VkMemoryBarrier simulateBarrier{};
+    simulateBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    simulateBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    simulateBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &simulateBarrier, 0, nullptr, 0, nullptr);
+
     vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipeline);
-    vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipelineLayout, 0, 1, &m_computeDescriptorSet, 0, nullptr);
+    vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipelineLayout, 0, 1, &m_computeDescriptorSets[_frameIndex], 0, nullptr);
     
     ComputePushConstants pushConstants = {};
     pushConstants.deltaTime = _deltaTime;
@@ -297,12 +453,4 @@ void ParticleRenderSystem::UpdateParticlesWithCompute(float _deltaTime, VkComman
     vkCmdPushConstants(_commandBuffer, m_computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &pushConstants);
     uint32_t groupCount = (_params.maxParticles + 255) / 256;
     vkCmdDispatch(_commandBuffer, groupCount, 1, 1);
-    
-    VkMemoryBarrier memoryBarrier{};
-    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-    
-    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memoryBarrier,  0, nullptr, 0, nullptr);
-
 } 
\ No newline at end of file
@@ -1,53 +1,89 @@
 #pragma once
 #include "core/Device.h"
 #include "core/Pipeline.h"
+#include "core/PipelineBuildQueue.h"
 #include "core/Descriptors.h"
 #include "core/FrameInfo.h"
+#include "core/Renderer.h"
+#include "core/SwapChain.h"
 #include "core/Particle.h"
 #include "components/ParticleSystemComponent.h"
 #include "components/TransformComponent.h"
 #include <vulkan/vulkan.h>
+#include <array>
 #include <memory>
 #include <vector>
 #include <glm/glm.hpp>
 
+// The particles live in one storage buffer per frame in flight. Each frame copies the state of the previous one into its
+// buffer and simulates it in place, so with an async compute queue the simulation of frame N overlaps the rasterization
+// of frame N - 1, which still reads the other buffer. Without one, or with ParticleSystemComponent::asyncCompute off,
+// the simulation is recorded into the frame command buffer before the render pass.
 class ParticleRenderSystem {
 public:
-    ParticleRenderSystem(Device& _device, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits _msaaSamples, uint32_t _maxParticles, float _particleSize, glm::vec3 _particleColor);
+    // The render pipeline is added to _buildQueue, build it before the first frame.
+    ParticleRenderSystem(Device& _device, PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits _msaaSamples, uint32_t _maxParticles, float _particleSize, glm::vec3 _particleColor);
     ~ParticleRenderSystem();
 
     ParticleRenderSystem(const ParticleRenderSystem&) = delete;
     ParticleRenderSystem& operator=(const ParticleRenderSystem&) = delete;
 
     void Render(FrameInfo& _frameInfo, VkDescriptorSet _descriptorSet);
-    void UpdateParticlesWithCompute(float _deltaTime, VkCommandBuffer _commandBuffer, const ParticleSystemComponent& _params, const TransformComponent& _transform);
+    // Between BeginFrame and EndFrame, before the render pass. Adds the semaphores of the async path to the frame.
+    void UpdateParticlesWithCompute(FrameInfo& _frameInfo, Renderer& _renderer, const ParticleSystemComponent& _params, const TransformComponent& _transform);
 
-    Buffer* GetParticleBuffer() { return m_particleBuffer.get(); }
+    // The buffer simulated and drawn by the frame.
+    VkDescriptorBufferInfo GetParticleBufferInfo(int _frameIndex) const { return { m_particleBuffers[_frameIndex], 0, m_particleBufferSize }; }
 
 private:
 
     void CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayout);
-    void CreatePipeline(VkRenderPass _renderPass, VkSampleCountFlagBits _msaaSamples);
+    void CreatePipeline(PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkSampleCountFlagBits _msaaSamples);
     void CreateVertexBuffer();
     void CreateParticleBuffer();
     void CreateComputePipeline();
     void CreateComputeDescriptorSet();
+    void CreateAsyncComputeResources();
+    // Copies the previous frame's particles into the frame's buffer and simulates them. _previousReaders are the stages
+    // of this queue that may still read the frame's buffer.
+    void RecordSimulation(VkCommandBuffer _commandBuffer, int _frameIndex, VkPipelineStageFlags _previousReaders, float _deltaTime, const ParticleSystemComponent& _params, const TransformComponent& _transform);
+    void SimulateAsync(FrameInfo& _frameInfo, Renderer& _renderer, const ParticleSystemComponent& _params, const TransformComponent& _transform);
 
     Device& m_device;
     
-    std::unique_ptr<Pipeline> m_pipeline;
+    // Both shared through the pipeline library.
+    std::shared_ptr<Pipeline> m_pipeline;
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
     
     VkPipeline m_computePipeline = VK_NULL_HANDLE;
     VkPipelineLayout m_computePipelineLayout = VK_NULL_HANDLE;
     std::unique_ptr<DescriptorSetLayout> m_computeDescriptorSetLayout;
-    VkDescriptorSet m_computeDescriptorSet = VK_NULL_HANDLE;
+    std::array<VkDescriptorSet, SwapChain::MAX_FRAMES_IN_FLIGHT> m_computeDescriptorSets{};
     std::unique_ptr<DescriptorPool> m_computeDescriptorPool;
     
     VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_vertexBufferMemory = VK_NULL_HANDLE;
-    std::unique_ptr<Buffer> m_particleBuffer;
+    MemoryAllocation m_vertexBufferMemory{};
+    // Shared by the graphics and compute families when they differ, both read the previous frame's buffer at once.
+    std::array<VkBuffer, SwapChain::MAX_FRAMES_IN_FLIGHT> m_particleBuffers{};
+    std::array<MemoryAllocation, SwapChain::MAX_FRAMES_IN_FLIGHT> m_particleBufferMemory{};
+    VkDeviceSize m_particleBufferSize = 0;
     uint32_t m_maxParticles = 0;
+
+    // Async path, per frame in flight. The compute submission signals simulated, the frame waits on it before its
+    // vertex shaders and signals released once it no longer reads the buffer, which the simulation two frames later
+    // waits on before overwriting it.
+    VkCommandPool m_computeCommandPool = VK_NULL_HANDLE;
+    std::array<VkCommandBuffer, SwapChain::MAX_FRAMES_IN_FLIGHT> m_computeCommandBuffers{};
+    std::array<VkFence, SwapChain::MAX_FRAMES_IN_FLIGHT> m_computeFences{};
+    std::array<VkSemaphore, SwapChain::MAX_FRAMES_IN_FLIGHT> m_simulatedSemaphores{};
+    std::array<VkSemaphore, SwapChain::MAX_FRAMES_IN_FLIGHT> m_releasedSemaphores{};
+    // Binary semaphores, released ones are only waited on when a frame signaled them.
+    std::array<bool, SwapChain::MAX_FRAMES_IN_FLIGHT> m_releasePending{};
+    // Frames simulating on the graphics queue signal one, waited on by the next simulation on either queue, so the
+    // compute queue never copies a buffer the graphics queue is still writing when the toggle changes. At most one is
+    // pending, -1 when none is.
+    std::array<VkSemaphore, 2> m_handoffSemaphores{};
+    int m_pendingHandoff = -1;
     
     VkSampleCountFlagBits m_msaaSamples;
     float m_particleSize = 0.01f;
@@ -1,6 +1,7 @@
 #include "systems/PointLightSystem.h"
 #include "components/PointLightComponent.h"
 #include "components/TransformComponent.h"
+#include "core/PipelineLibrary.h"
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
@@ -19,16 +20,15 @@ struct PointLightPushConstants
 };
 
 
-PointLightSystem::PointLightSystem(Device& _device, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits msaaSamples) 
+PointLightSystem::PointLightSystem(Device& _device, PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits msaaSamples) 
     : m_device{ _device }, m_msaaSamples{ msaaSamples }
 {
     CreatePipelineLayout(_globalSetLayout);
-    CreatePipeline(_renderPass);
+    CreatePipeline(_buildQueue, _renderPass);
 }
 
 PointLightSystem::~PointLightSystem() 
 {
-    vkDestroyPipelineLayout(m_device.GetDevice(), m_pipelineLayout, nullptr);
 }
 
 void PointLightSystem::CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayout) 
@@ -38,25 +38,14 @@ void PointLightSystem::CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayo
     pushConstantRange.offset = 0;
     pushConstantRange.size = sizeof(PointLightPushConstants);
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ _globalSetLayout };
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-    if (vkCreatePipelineLayout(m_device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
-        throw std::runtime_error("failed to create pipeline layout");
-    
+    m_pipelineLayout = m_device.GetPipelineLibrary().GetPipelineLayout({ _globalSetLayout }, { pushConstantRange });
 }
 
-void PointLightSystem::CreatePipeline(VkRenderPass _renderPass) 
+void PointLightSystem::CreatePipeline(PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass) 
 {
     assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{};
+    PipelineConfigInfo& pipelineConfig = _buildQueue.Add(m_pipeline, "shaders/pointLight_vert.spv", "shaders/pointLight_frag.spv");
     Pipeline::DefaultPipelineConfigInfo(pipelineConfig);
     Pipeline::EnableAlphaBlending(pipelineConfig);
     pipelineConfig.attributeDescriptions.clear();
@@ -65,8 +54,6 @@ void PointLightSystem::CreatePipeline(VkRenderPass _renderPass)
     pipelineConfig.pipelineLayout = m_pipelineLayout;
     pipelineConfig.multisampleInfo.rasterizationSamples = m_msaaSamples;
 
-    m_pipeline = std::make_unique<Pipeline>(m_device, "shaders/pointLight_vert.spv", "shaders/pointLight_frag.spv",pipelineConfig);
-
 
 }
 
@@ -4,6 +4,7 @@
 #include "core/Device.h"
 #include "core/FrameInfo.h"
 #include "core/Pipeline.h"
+#include "core/PipelineBuildQueue.h"
 #include <vulkan/vulkan.h>
 #include <memory>
 #include <vector>
@@ -12,7 +13,8 @@
 class PointLightSystem
 {
 public:
-	PointLightSystem(Device& _device, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits msaaSamples);
+	// The pipeline is added to _buildQueue, build it before the first frame.
+	PointLightSystem(Device& _device, PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkSampleCountFlagBits msaaSamples);
 	~PointLightSystem();
 
 	PointLightSystem(const PointLightSystem&) = delete;
@@ -23,11 +25,12 @@ public:
 
 private:
 	void CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayout);
-	void CreatePipeline(VkRenderPass _renderPass);
+	void CreatePipeline(PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass);
 
 	Device& m_device;
 
-	std::unique_ptr<Pipeline> m_pipeline;
+	// Both shared through the pipeline library.
+	std::shared_ptr<Pipeline> m_pipeline;
 	VkPipelineLayout m_pipelineLayout;
 	VkSampleCountFlagBits m_msaaSamples;
 };
@@ -2,14 +2,64 @@
 #include "core/Pipeline.h"
 #include "components/ModelComponent.h"
 #include "components/TransformComponent.h"
+#include "core/ThreadPool.h"
+#include "core/PipelineCache.h"
+#include "core/ShaderCompiler.h"
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cassert>
+#include <functional>
+#include <iterator>
 #include <stdexcept>
 
+namespace
+{
+    const char* COMPACT_VERT_SHADER = "shaders/shader_compact_vert.spv";
+    const char* TEXTURED_COMPACT_VERT_SHADER = "shaders/texture_compact_vert.spv";
+
+    // constant_id values of the lit fragment shaders.
+    enum SpecializationConstant : uint32_t
+    {
+        MAX_LIGHTS_CONSTANT = 0,
+        SPECULAR_MODEL_CONSTANT = 1,
+        SPECULAR_EXPONENT_CONSTANT = 2,
+    };
+
+    constexpr float SPECULAR_EXPONENT = 512.0f;
+}
+
+uint32_t PipelinePermutation::GetKey() const
+{
+    return (compact ? 1u : 0u) | (textured ? 2u : 0u) | (cullBackFaces ? 4u : 0u) | (static_cast<uint32_t>(specularModel) << 3) | (maxLights << 8);
+}
+
+PipelinePermutation PipelinePermutation::GetFallback() const
+{
+    PipelinePermutation fallback{};
+    fallback.compact = compact;
+    fallback.textured = textured;
+    return fallback;
+}
+
+uint32_t PipelinePermutation::GetLightCap(int _lightCount)
+{
+    uint32_t cap = 0;
+    if (_lightCount > 0)
+    {
+        cap = 1;
+        while (cap < static_cast<uint32_t>(_lightCount))
+        {
+            cap *= 2;
+        }
+    }
+    return std::min<uint32_t>(cap, MAX_LIGHTS);
+}
+
 
 struct SimplePushConstantData 
 {
@@ -19,19 +69,21 @@ struct SimplePushConstantData
     float _padding{ 0.0f }; // Ensure 16-byte alignment
 };
 
-RenderSystem::RenderSystem(Device& _device, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkDescriptorSetLayout _textureSetLayout, VkSampleCountFlagBits msaaSamples)
-    : m_device{ _device }, m_msaaSamples{ msaaSamples }
+RenderSystem::RenderSystem(Device& _device, PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkDescriptorSetLayout _textureSetLayout, VkSampleCountFlagBits msaaSamples)
+    : m_device{ _device }, m_msaaSamples{ msaaSamples }, m_runtimeBuildQueue{ _device }, m_renderPass{ _renderPass }
 {
     CreatePipelineLayout(_globalSetLayout);
-    CreatePipeline(_renderPass);
     CreatePipelineLayoutTextured(_globalSetLayout, _textureSetLayout);
-    CreatePipelineTextured(_renderPass);
+    CreatePipelines(_buildQueue);
+
+    if (MeshletCullingSystem::IsSupported())
+    {
+        m_meshletCulling = std::make_unique<MeshletCullingSystem>(m_device);
+    }
 }
 
 RenderSystem::~RenderSystem() 
 {
-    vkDestroyPipelineLayout(m_device.GetDevice(), m_pipelineLayout, nullptr);
-    vkDestroyPipelineLayout(m_device.GetDevice(), m_pipelineLayoutTextured, nullptr);
 }
 
 void RenderSystem::CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayout)
@@ -41,17 +93,7 @@ void RenderSystem::CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayout)
     pushConstantRange.offset = 0;
     pushConstantRange.size = sizeof(SimplePushConstantData);
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ _globalSetLayout };
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-    if (vkCreatePipelineLayout(m_device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) 
-        throw std::runtime_error("failed to create pipeline layout");
+    m_pipelineLayout = m_device.GetPipelineLibrary().GetPipelineLayout({ _globalSetLayout }, { pushConstantRange });
 }
 
 void RenderSystem::CreatePipelineLayoutTextured(VkDescriptorSetLayout _globalSetLayout, VkDescriptorSetLayout _textureSetLayout)
@@ -61,77 +103,265 @@ void RenderSystem::CreatePipelineLayoutTextured(VkDescriptorSetLayout _globalSet
     pushConstantRange.offset = 0;
     pushConstantRange.size = sizeof(SimplePushConstantData);
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ _globalSetLayout, _textureSetLayout };
+    m_pipelineLayoutTextured = m_device.GetPipelineLibrary().GetPipelineLayout({ _globalSetLayout, _textureSetLayout }, { pushConstantRange });
+}
+
+bool RenderSystem::HasCompactShaders()
+{
+    return ShaderCompiler::Exists(COMPACT_VERT_SHADER) && ShaderCompiler::Exists(TEXTURED_COMPACT_VERT_SHADER);
+}
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+void RenderSystem::CreatePipelines(PipelineBuildQueue& _buildQueue)
+{
+    // The compact shaders ship separately, without them only the full vertex format is drawn.
+    m_hasCompactPipelines = HasCompactShaders();
+    for (bool compact : { false, true })
+    {
+        if (compact && !m_hasCompactPipelines)
+            continue;
 
-    if (vkCreatePipelineLayout(m_device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayoutTextured) != VK_SUCCESS) 
-        throw std::runtime_error("failed to create pipeline layout (textured)");
+        for (bool textured : { false, true })
+        {
+            PipelinePermutation permutation{};
+            permutation.compact = compact;
+            permutation.textured = textured;
+            AddPipeline(_buildQueue, permutation, nullptr);
+        }
+    }
 }
 
-void RenderSystem::CreatePipeline(VkRenderPass _renderPass) 
+void RenderSystem::AddPipeline(PipelineBuildQueue& _buildQueue, const PipelinePermutation& _permutation, Pipeline* _fallback)
 {
-    assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+    assert((_permutation.textured ? m_pipelineLayoutTextured : m_pipelineLayout) != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{}; 
+    // Same fragment shaders for both vertex formats, only the vertex input and its decoding differ.
+    const char* vertShader = _permutation.compact ? (_permutation.textured ? TEXTURED_COMPACT_VERT_SHADER : COMPACT_VERT_SHADER) : (_permutation.textured ? "shaders/texture_vert.spv" : "shaders/shader_vert.spv");
+    const char* fragShader = _permutation.textured ? "shaders/texture_frag.spv" : "shaders/shader_frag.spv";
+    PipelineConfigInfo& pipelineConfig = _buildQueue.Add(m_pipelines[_permutation.GetKey()], vertShader, fragShader, _fallback);
     Pipeline::DefaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = _renderPass;
-    pipelineConfig.pipelineLayout = m_pipelineLayout;
+    if (_permutation.compact)
+    {
+        pipelineConfig.bindingDescriptions = Model::CompactVertex::GetBindingDescriptions();
+        pipelineConfig.attributeDescriptions = Model::CompactVertex::GetAttributeDescriptions();
+    }
+    if (_permutation.cullBackFaces)
+        pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+    pipelineConfig.renderPass = m_renderPass;
+    pipelineConfig.pipelineLayout = _permutation.textured ? m_pipelineLayoutTextured : m_pipelineLayout;
     pipelineConfig.multisampleInfo.rasterizationSamples = m_msaaSamples;
-    m_pipeline = std::make_unique<Pipeline>(m_device, "shaders/shader_vert.spv", "shaders/shader_frag.spv", pipelineConfig);
+
+    Pipeline::AddSpecializationConstant(pipelineConfig, MAX_LIGHTS_CONSTANT, static_cast<int32_t>(_permutation.maxLights));
+    Pipeline::AddSpecializationConstant(pipelineConfig, SPECULAR_MODEL_CONSTANT, static_cast<int32_t>(_permutation.specularModel));
+    Pipeline::AddSpecializationConstant(pipelineConfig, SPECULAR_EXPONENT_CONSTANT, SPECULAR_EXPONENT);
 }
 
-void RenderSystem::CreatePipelineTextured(VkRenderPass _renderPass)
+void RenderSystem::RequestPipeline(const PipelinePermutation& _permutation)
 {
-    assert(m_pipelineLayoutTextured != nullptr && "Cannot create pipeline before pipeline layout (textured)");
+    auto pipeline = m_pipelines.find(_permutation.GetKey());
+    if (pipeline != m_pipelines.end())
+    {
+        // Null until the runtime queue resolves the request.
+        if (!pipeline->second || !pipeline->second->HasFailed())
+            return;
 
-    PipelineConfigInfo pipelineConfig{}; 
-    Pipeline::DefaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = _renderPass;
-    pipelineConfig.pipelineLayout = m_pipelineLayoutTextured;
-    pipelineConfig.multisampleInfo.rasterizationSamples = m_msaaSamples;
-    m_pipelineTextured = std::make_unique<Pipeline>(m_device, "shaders/texture_vert.spv", "shaders/texture_frag.spv", pipelineConfig);
+        auto now = std::chrono::steady_clock::now();
+        PipelineRetry& retry = m_pipelineRetries.try_emplace(_permutation.GetKey(), PipelineRetry{ 0, now + PIPELINE_RETRY_DELAY }).first->second;
+        if (retry.attemptCount >= MAX_PIPELINE_BUILD_ATTEMPTS || now < retry.nextAttempt)
+            return;
+
+        retry.attemptCount++;
+        retry.nextAttempt = now + PIPELINE_RETRY_DELAY * (1 << retry.attemptCount);
+    }
+
+    AddPipeline(m_runtimeBuildQueue, _permutation, m_pipelines.at(_permutation.GetFallback().GetKey()).get());
 }
 
-void RenderSystem::RenderGameObjects(FrameInfo& _frameInfo)
+uint32_t RenderSystem::SelectLod(const FrameInfo& _frameInfo, const Model& _model, const TransformComponent& _transform) const
 {
+    // Pixels covered by one unit of world space at distance one, proj[1][1] is negative with the Vulkan flip.
+    float projectionScale = std::abs(_frameInfo.camera.GetProjection()[1][1]) * static_cast<float>(_frameInfo.extent.height) * 0.5f;
+
+    const auto& bounds = _model.GetBounds();
+    float maxScale = std::max(std::abs(_transform.scale.x), std::max(std::abs(_transform.scale.y), std::abs(_transform.scale.z)));
+    glm::vec3 worldCenter = glm::vec3(_transform.Mat4() * glm::vec4(bounds.center, 1.0f));
+    float distance = glm::length(worldCenter - _frameInfo.camera.GetPosition()) - bounds.radius * maxScale;
+    return _model.SelectLod(distance, maxScale, projectionScale, m_lodPixelThreshold);
+}
+
+void RenderSystem::CullMeshlets(FrameInfo& _frameInfo)
+{
+    m_meshletDraws.clear();
+
+    if (!m_meshletCulling || !_frameInfo.ec)
+        return;
+
+    m_meshletCulling->BeginFrame(_frameInfo.frameIndex, _frameInfo.camera.GetProjection() * _frameInfo.camera.GetView(), _frameInfo.camera.GetPosition());
+
+    // Only full detail draws go through meshlets, coarser lods are already cheap.
+    _frameInfo.ec->ForEach<ModelComponent>([&](Entity id, ModelComponent& modelComp)
+        {
+            if (!modelComp.model || !modelComp.model->HasMeshlets() || !_frameInfo.ec->HasComponent<TransformComponent>(id))
+                return;
+
+            auto& transform = _frameInfo.ec->GetComponent<TransformComponent>(id);
+            if (SelectLod(_frameInfo, *modelComp.model, transform) != 0)
+                return;
+
+            m_meshletDraws[id] = m_meshletCulling->AddDraw(*modelComp.model, transform.Mat4());
+        });
+
+    m_meshletCulling->Dispatch(_frameInfo.commandBuffer);
+}
+
+void RenderSystem::RenderGameObjects(FrameInfo& _frameInfo, Renderer& _renderer)
+{
+    m_stats = {};
+    m_stats.geometryPool = m_device.GetGeometryPool().GetStats();
+    m_stats.pipelineLibrary = m_device.GetPipelineLibrary().GetStats();
+
+    // Gathered on the render thread, the workers only read the components. Every light is in the same ubo, so the light
+    // cap is the same for the whole frame.
+    const uint32_t lightCap = PipelinePermutation::GetLightCap(_frameInfo.lightCount);
+    m_drawList.clear();
     if (_frameInfo.ec) 
     {
         _frameInfo.ec->ForEach<ModelComponent>([&](Entity id, ModelComponent& modelComp) 
             {
-            if (!_frameInfo.ec->HasComponent<TransformComponent>(id)) return;
+                if (!modelComp.model || !_frameInfo.ec->HasComponent<TransformComponent>(id)) return;
 
-            auto& transform = _frameInfo.ec->GetComponent<TransformComponent>(id);
+                PipelinePermutation permutation{};
+                permutation.compact = modelComp.model->GetVertexFormat() == Model::VertexFormat::Compact;
+                permutation.textured = modelComp.textureDescriptorSet != VK_NULL_HANDLE;
+                permutation.cullBackFaces = modelComp.cullBackFaces;
+                permutation.specularModel = modelComp.specularModel;
+                permutation.maxLights = lightCap;
+                assert((!permutation.compact || m_hasCompactPipelines) && "Compact model without the compact shaders");
+                RequestPipeline(permutation);
 
-            if (!modelComp.model) 
+                m_drawList.push_back({ id, &modelComp, &_frameInfo.ec->GetComponent<TransformComponent>(id), permutation.GetKey(), nullptr });
+            });
+    }
+    m_runtimeBuildQueue.BuildAsync();
 
-            {
-                return;
-            }
+    // Permutations the library shares resolve to the same pipeline, grouping by it and then by geometry buffer keeps
+    // binds to one per change. Draws are opaque and depth tested, their order does not matter.
+    for (DrawItem& item : m_drawList)
+    {
+        item.pipeline = m_pipelines.at(item.pipelineKey)->GetReady();
+    }
+    auto skipped = std::remove_if(m_drawList.begin(), m_drawList.end(), [](const DrawItem& _item) { return _item.pipeline == nullptr; });
+    m_stats.skippedDrawCount = static_cast<uint32_t>(std::distance(skipped, m_drawList.end()));
+    m_drawList.erase(skipped, m_drawList.end());
+    std::sort(m_drawList.begin(), m_drawList.end(), [](const DrawItem& _a, const DrawItem& _b)
+        {
+            if (_a.pipeline != _b.pipeline)
+                return std::less<Pipeline*>()(_a.pipeline, _b.pipeline);
+            return std::less<VkBuffer>()(_a.model->model->GetVertexBuffer(), _b.model->model->GetVertexBuffer());
+        });
+    m_stats.pendingPipelineCount = m_runtimeBuildQueue.GetPendingCount();
+    m_stats.longestPipelineBuildTime = m_device.GetPipelineCache().GetLongestCreationTime();
+    if (m_drawList.empty())
+        return;
 
-            SimplePushConstantData push{};
-            push.modelMatrix = transform.Mat4();
-            push.normalMatrix = transform.NormalMatrix();
-            push.color = modelComp.color;
-            if (modelComp.textureDescriptorSet != VK_NULL_HANDLE) 
-            {
-                m_pipelineTextured->Bind(_frameInfo.commandBuffer);
-                vkCmdBindDescriptorSets(_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayoutTextured, 0, 1, &_frameInfo.globalDescriptorSet, 0, nullptr);
-                vkCmdBindDescriptorSets(_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayoutTextured, 1, 1, &modelComp.textureDescriptorSet, 0, nullptr);
-            } else 
-            {
-                m_pipeline->Bind(_frameInfo.commandBuffer);
-                vkCmdBindDescriptorSets(_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &_frameInfo.globalDescriptorSet, 0, nullptr);
-            }
-            vkCmdPushConstants(_frameInfo.commandBuffer, modelComp.textureDescriptorSet != VK_NULL_HANDLE ? m_pipelineLayoutTextured : m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
-            modelComp.model->Bind(_frameInfo.commandBuffer);
-            modelComp.model->Draw(_frameInfo.commandBuffer);
+    // Contiguous chunks executed in order keep the draw order of a single recording.
+    const size_t chunkCount = std::min<size_t>(_renderer.GetRecordingSlotCount(), (m_drawList.size() + MIN_DRAWS_PER_CHUNK - 1) / MIN_DRAWS_PER_CHUNK);
+    std::vector<VkCommandBuffer> commandBuffers(chunkCount);
+    std::vector<RenderStats> chunkStats(chunkCount);
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        commandBuffers[i] = _renderer.BeginSecondaryCommandBuffer(static_cast<uint32_t>(i));
+    }
+
+    // Chunk i records from slot i, so no two threads share a command pool.
+    ThreadPool::GetShared().ParallelFor(chunkCount, [&](size_t _i)
+        {
+            RecordDraws(_frameInfo, commandBuffers[_i], m_drawList.size() * _i / chunkCount, m_drawList.size() * (_i + 1) / chunkCount, chunkStats[_i]);
         });
+
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        _renderer.EndSecondaryCommandBuffer(commandBuffers[i]);
+
+        const RenderStats& stats = chunkStats[i];
+        m_stats.drawCount += stats.drawCount;
+        m_stats.triangleCount += stats.triangleCount;
+        m_stats.fullDetailTriangleCount += stats.fullDetailTriangleCount;
+        for (uint32_t lod = 0; lod < Model::MAX_LODS; lod++)
+        {
+            m_stats.lodDrawCounts[lod] += stats.lodDrawCounts[lod];
+        }
+        m_stats.meshletDrawCount += stats.meshletDrawCount;
+        m_stats.meshletCount += stats.meshletCount;
+        m_stats.geometryBindCount += stats.geometryBindCount;
+        m_stats.pipelineBindCount += stats.pipelineBindCount;
     }
+
+    vkCmdExecuteCommands(_frameInfo.commandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
 }
 
+void RenderSystem::RecordDraws(const FrameInfo& _frameInfo, VkCommandBuffer _commandBuffer, size_t _begin, size_t _end, RenderStats& _stats) const
+{
+    // Models share the geometry pool buffers, vertex and index buffers are only bound again when they change.
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+    // The global set stays bound across pipelines of the same layout.
+    Pipeline* boundPipeline = nullptr;
+    VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+
+    for (size_t i = _begin; i < _end; i++)
+    {
+        const ModelComponent& modelComp = *m_drawList[i].model;
+        const TransformComponent& transform = *m_drawList[i].transform;
+        const bool textured = modelComp.textureDescriptorSet != VK_NULL_HANDLE;
+        const VkPipelineLayout layout = textured ? m_pipelineLayoutTextured : m_pipelineLayout;
+
+        SimplePushConstantData push{};
+        push.modelMatrix = transform.Mat4() * modelComp.model->GetDequantization();
+        push.normalMatrix = transform.NormalMatrix();
+        push.color = modelComp.color;
+        if (m_drawList[i].pipeline != boundPipeline)
+        {
+            m_drawList[i].pipeline->Bind(_commandBuffer);
+            boundPipeline = m_drawList[i].pipeline;
+            _stats.pipelineBindCount++;
+        }
+        if (layout != boundLayout)
+        {
+            vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &_frameInfo.globalDescriptorSet, 0, nullptr);
+            boundLayout = layout;
+        }
+        if (textured) 
+        {
+            vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &modelComp.textureDescriptorSet, 0, nullptr);
+        }
+        vkCmdPushConstants(_commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+
+        if (modelComp.model->GetVertexBuffer() != boundVertexBuffer || modelComp.model->GetIndexBuffer() != boundIndexBuffer)
+        {
+            modelComp.model->Bind(_commandBuffer);
+            boundVertexBuffer = modelComp.model->GetVertexBuffer();
+            boundIndexBuffer = modelComp.model->GetIndexBuffer();
+            _stats.geometryBindCount++;
+        }
+
+        uint32_t lod = 0;
+        auto meshletDraw = m_meshletDraws.find(m_drawList[i].entity);
+        if (meshletDraw != m_meshletDraws.end())
+        {
+            m_meshletCulling->Draw(_commandBuffer, meshletDraw->second);
+            boundIndexBuffer = VK_NULL_HANDLE;
+            _stats.meshletDrawCount++;
+            _stats.meshletCount += modelComp.model->GetMeshletCount();
+        }
+        else
+        {
+            lod = SelectLod(_frameInfo, *modelComp.model, transform);
+            modelComp.model->Draw(_commandBuffer, lod);
+        }
+
+        _stats.drawCount++;
+        _stats.triangleCount += modelComp.model->GetTriangleCount(lod);
+        _stats.fullDetailTriangleCount += modelComp.model->GetTriangleCount(0);
+        _stats.lodDrawCounts[lod]++;
+    }
+}
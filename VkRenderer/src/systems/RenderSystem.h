@@ -1,37 +1,151 @@
 #pragma once
 #include "core/Device.h"
+#include "core/Renderer.h"
 #include "core/FrameInfo.h"
 #include "model/GameObject.h"
 #include "core/Pipeline.h"
+#include "core/PipelineBuildQueue.h"
+#include "core/PipelineLibrary.h"
+#include "core/GeometryPool.h"
 #include <vulkan/vulkan.h>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include "camera/Camera.h"
+#include "systems/MeshletCullingSystem.h"
+#include "components/TransformComponent.h"
+#include "components/ModelComponent.h"
+#include <unordered_map>
+
+struct RenderStats
+{
+    uint32_t drawCount = 0;
+    uint32_t triangleCount = 0;
+    uint32_t fullDetailTriangleCount = 0;
+    uint32_t lodDrawCounts[Model::MAX_LODS] = {};
+    // Lod 0 draws culled per meshlet on the GPU, their triangle counts above are before culling.
+    uint32_t meshletDrawCount = 0;
+    uint32_t meshletCount = 0;
+    // Vertex and index buffer binds, one per change of vertex format or index type.
+    uint32_t geometryBindCount = 0;
+    // Pipeline binds, the draw list is sorted so there is about one per distinct pipeline and recording thread.
+    uint32_t pipelineBindCount = 0;
+    // Draws whose pipeline and its fallback are both still being built.
+    uint32_t skippedDrawCount = 0;
+    uint32_t pendingPipelineCount = 0;
+    // Slowest pipeline creation since startup, in milliseconds.
+    double longestPipelineBuildTime = 0.0;
+    GeometryPool::Stats geometryPool{};
+    PipelineLibrary::Stats pipelineLibrary{};
+};
+
+// One pipeline of the render system. Compact and textured pick the shaders, the rest is baked into them through
+// specialization constants, so the compiler unrolls the light loop and strips the terms a variant does not use.
+struct PipelinePermutation
+{
+    bool compact = false;
+    bool textured = false;
+    bool cullBackFaces = false;
+    SpecularModel specularModel = SpecularModel::BlinnPhong;
+    // Lights the fragment shader loops over, at least as many as the scene has.
+    uint32_t maxLights = MAX_LIGHTS;
+
+    uint32_t GetKey() const;
+    // Startup permutation of the same shaders, for any scene.
+    PipelinePermutation GetFallback() const;
+
+    // Rounds up to a power of two so a few lights coming and going does not build a pipeline each time.
+    static uint32_t GetLightCap(int _lightCount);
+};
 
 class RenderSystem
 {
 public:
-    RenderSystem(Device& _device, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkDescriptorSetLayout _textureSetLayout, VkSampleCountFlagBits _msaaSamples);
+    // The pipelines are added to _buildQueue, build it before the first frame.
+    RenderSystem(Device& _device, PipelineBuildQueue& _buildQueue, VkRenderPass _renderPass, VkDescriptorSetLayout _globalSetLayout, VkDescriptorSetLayout _textureSetLayout, VkSampleCountFlagBits _msaaSamples);
     ~RenderSystem();
 
     RenderSystem(const RenderSystem&) = delete;
     RenderSystem& operator=(const RenderSystem&) = delete;
 
-    void RenderGameObjects(FrameInfo& _frameInfo);
+    // Records the meshlet culling dispatches, call before the render pass begins.
+    void CullMeshlets(FrameInfo& _frameInfo);
+    // Splits the draws across the workers of the shared thread pool, each records a secondary command buffer that the
+    // frame command buffer then executes in order. The render pass must begin with secondary command buffer contents.
+    void RenderGameObjects(FrameInfo& _frameInfo, Renderer& _renderer);
+
+    const RenderStats& GetStats() const { return m_stats; }
+
+    // Largest error, in pixels, a lod may show on screen before a finer one is picked.
+    void SetLodPixelThreshold(float _pixels) { m_lodPixelThreshold = _pixels; }
+
+    // The compact shaders ship as separate files, models only use Model::VertexFormat::Compact when they are present.
+    static bool HasCompactShaders();
+
+    // Null when the culling shader has not been compiled.
+    MeshletCullingSystem* GetMeshletCulling() { return m_meshletCulling.get(); }
 
 private:
     void CreatePipelineLayout(VkDescriptorSetLayout _globalSetLayout);
-    void CreatePipeline(VkRenderPass renderPass);
     void CreatePipelineLayoutTextured(VkDescriptorSetLayout _globalSetLayout, VkDescriptorSetLayout _textureSetLayout);
-    void CreatePipelineTextured(VkRenderPass _renderPass);
+    // The fallback of every shader pair, built with the other startup pipelines.
+    void CreatePipelines(PipelineBuildQueue& _buildQueue);
+    void AddPipeline(PipelineBuildQueue& _buildQueue, const PipelinePermutation& _permutation, Pipeline* _fallback);
+    uint32_t SelectLod(const FrameInfo& _frameInfo, const Model& _model, const TransformComponent& _transform) const;
+
+    struct DrawItem
+    {
+        Entity entity;
+        const ModelComponent* model;
+        const TransformComponent* transform;
+        uint32_t pipelineKey;
+        // Resolved once on the render thread, a build finishing while the workers record must not change it.
+        Pipeline* pipeline;
+    };
+
+    struct PipelineRetry
+    {
+        uint32_t attemptCount = 0;
+        std::chrono::steady_clock::time_point nextAttempt{};
+    };
+
+    // Below this a chunk costs more to hand over than to record.
+    static constexpr size_t MIN_DRAWS_PER_CHUNK = 32;
+    // A permutation whose build failed is built again after a delay doubling from the first one, a shader edited
+    // back to a compiling state is picked up without rebuilding a broken one every frame.
+    static constexpr uint32_t MAX_PIPELINE_BUILD_ATTEMPTS = 5;
+    static constexpr std::chrono::milliseconds PIPELINE_RETRY_DELAY{ 1000 };
+
+    // Starts building the permutation on the first request, its draws use the fallback meanwhile. The pipeline is
+    // assigned once the runtime queue is built.
+    void RequestPipeline(const PipelinePermutation& _permutation);
+
+    // Thread safe, only reads the draw list and the systems.
+    void RecordDraws(const FrameInfo& _frameInfo, VkCommandBuffer _commandBuffer, size_t _begin, size_t _end, RenderStats& _stats) const;
 
     Device& m_device;
 
-    std::unique_ptr<Pipeline> m_pipeline;
+    // Owned by the pipeline library.
     VkPipelineLayout m_pipelineLayout;
-
-    std::unique_ptr<Pipeline> m_pipelineTextured;
     VkPipelineLayout m_pipelineLayoutTextured;
     VkSampleCountFlagBits m_msaaSamples;
+    bool m_hasCompactPipelines = false;
+
+    // Pipelines needed once frames run are built in the background.
+    PipelineBuildQueue m_runtimeBuildQueue;
+    VkRenderPass m_renderPass;
+    // Keyed by PipelinePermutation::GetKey and shared through the pipeline library. Never erased, the build queues
+    // assign the values in place.
+    std::unordered_map<uint32_t, std::shared_ptr<Pipeline>> m_pipelines{};
+    // Permutations whose runtime build failed, by key.
+    std::unordered_map<uint32_t, PipelineRetry> m_pipelineRetries{};
+
+    std::unique_ptr<MeshletCullingSystem> m_meshletCulling;
+    std::unordered_map<Entity, uint32_t> m_meshletDraws{};
+    std::vector<DrawItem> m_drawList{};
+
+    float m_lodPixelThreshold = 1.0f;
+    RenderStats m_stats{};
 };
 
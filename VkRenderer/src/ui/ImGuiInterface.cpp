@@ -4,7 +4,12 @@
 #include "components/PointLightComponent.h"
 #include "components/ParticleSystemComponent.h"
 #include "model/Model.h"
+#include "model/GltfImporter.h"
 #include "core/Descriptors.h"
+#include "core/StagingRing.h"
+#include "core/DeletionQueue.h"
+#include "core/GeometryPool.h"
+#include "core/PipelineCache.h"
 #include <imgui.h>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_vulkan.h>
@@ -39,7 +44,7 @@ void ImGuiInterface::Initialize()
     info.MinImageCount = 2;
     info.ImageCount = 2;
     info.MSAASamples = m_renderer.GetMsaaSamples();
-    info.PipelineCache = VK_NULL_HANDLE;
+    info.PipelineCache = m_device.GetPipelineCache().GetCache();
     info.Subpass = 0;
 
     ImGui_ImplVulkan_Init(&info);
@@ -72,7 +77,7 @@ void ImGuiInterface::ShowDebugWindow()
 
     ImGui::Begin("Debug Info", nullptr, ImGuiWindowFlags_None);
 
-    ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+    ImGui::Text("FPS: %.1f (%.2f ms)", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
     ImGui::Text("Objects: %zu", m_ec.GetEntityCount());
 
     ImGui::Separator();
@@ -86,6 +91,43 @@ void ImGuiInterface::ShowDebugWindow()
         ImGui::Text("  Z: %.2f", transform.translation.z);
     }
 
+    if (m_renderStats)
+    {
+        ImGui::Separator();
+        ImGui::Text("Draws: %u", m_renderStats->drawCount);
+        ImGui::Text("Triangles: %u / %u", m_renderStats->triangleCount, m_renderStats->fullDetailTriangleCount);
+        for (uint32_t i = 0; i < Model::MAX_LODS; i++)
+        {
+            ImGui::Text("  LOD %u: %u", i, m_renderStats->lodDrawCounts[i]);
+        }
+        ImGui::Text("Meshlet draws: %u (%u meshlets)", m_renderStats->meshletDrawCount, m_renderStats->meshletCount);
+        ImGui::Text("Geometry binds: %u", m_renderStats->geometryBindCount);
+        ImGui::Text("Pipeline binds: %u", m_renderStats->pipelineBindCount);
+        const PipelineLibrary::Stats& pipelines = m_renderStats->pipelineLibrary;
+        ImGui::Text("Pipelines: %u (%u shared), %u shader modules, %u layouts", pipelines.pipelineCount, pipelines.sharedCount, pipelines.shaderModuleCount, pipelines.pipelineLayoutCount);
+        ImGui::Text("Pipelines building: %u (longest %.1f ms)", m_renderStats->pendingPipelineCount, m_renderStats->longestPipelineBuildTime);
+        if (m_renderStats->skippedDrawCount > 0)
+            ImGui::Text("Draws skipped: %u", m_renderStats->skippedDrawCount);
+        if (m_assetLoader)
+        {
+            ImGui::Text("Pending loads: %u", m_assetLoader->GetPendingCount());
+            AssetCache<Model>::Stats models = m_assetLoader->GetModelCacheStats();
+            AssetCache<Texture>::Stats textures = m_assetLoader->GetTextureCacheStats();
+            ImGui::Text("Model cache: %u resident, %.1f MB, %u hits / %u misses", models.residentCount, models.residentSize / (1024.0f * 1024.0f), models.hitCount, models.missCount);
+            ImGui::Text("Texture cache: %u resident, %.1f MB, %u hits / %u misses", textures.residentCount, textures.residentSize / (1024.0f * 1024.0f), textures.hitCount, textures.missCount);
+        }
+        const GeometryPool::Stats& pool = m_renderStats->geometryPool;
+        ImGui::Text("Geometry pool: %.1f / %.1f MB (%u ranges, %u free blocks)", pool.usedSize / (1024.0f * 1024.0f), pool.capacity / (1024.0f * 1024.0f), pool.allocationCount, pool.freeBlockCount);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Compact"))
+            m_device.GetGeometryPool().Defragment(true);
+        MemoryAllocator::Stats memory = m_device.GetMemoryAllocator().GetStats();
+        ImGui::Text("Device memory: %.1f / %.1f MB (%u blocks, %u dedicated, %u allocations)", memory.usedSize / (1024.0f * 1024.0f), memory.reservedSize / (1024.0f * 1024.0f), memory.blockCount, memory.dedicatedCount, memory.allocationCount);
+        StagingRing& stagingRing = m_device.GetStagingRing();
+        ImGui::Text("Staging ring: %.1f / %.1f MB in use", stagingRing.GetUsedSize() / (1024.0f * 1024.0f), stagingRing.GetSize() / (1024.0f * 1024.0f));
+        ImGui::Text("Pending deletions: %zu", m_device.GetDeletionQueue().GetPendingCount());
+    }
+
     ImGui::End();
 }
 
@@ -214,18 +256,24 @@ void ImGuiInterface::ShowInspector()
     {
         ImGui::Text("Model Component");
         ImGui::Separator();
-        ImGui::Text("Model is loaded and rendering.");
+        if (m_assetLoader && m_assetLoader->IsPlaceholder(m_ec.GetComponent<ModelComponent>(m_selectedEntity).model))
+            ImGui::Text("Model is loading...");
+        else
+            ImGui::Text("Model is loaded and rendering.");
 
         if (ImGui::ColorEdit3("Model Color", m_editColor))
         {
             auto& modelComponent = m_ec.GetComponent<ModelComponent>(m_selectedEntity);
             modelComponent.color = glm::vec3(m_editColor[0], m_editColor[1], m_editColor[2]);
         }
+        ImGui::Checkbox("Cull back faces", &m_ec.GetComponent<ModelComponent>(m_selectedEntity).cullBackFaces);
+        bool specular = m_ec.GetComponent<ModelComponent>(m_selectedEntity).specularModel == SpecularModel::BlinnPhong;
+        if (ImGui::Checkbox("Specular highlights", &specular))
+            m_ec.GetComponent<ModelComponent>(m_selectedEntity).specularModel = specular ? SpecularModel::BlinnPhong : SpecularModel::None;
 
         if (ImGui::Button("Remove Model Component"))
         {
-            vkDeviceWaitIdle(m_device.GetDevice());
-
+            // No wait for the GPU, the deletion queue keeps released models alive while frames in flight use them.
             if (m_ec.HasComponent<ModelComponent>(m_selectedEntity))
             {
                 auto& modelComponent = m_ec.GetComponent<ModelComponent>(m_selectedEntity);
@@ -270,9 +318,14 @@ void ImGuiInterface::ShowInspector()
         ImGui::Separator();
         ImGui::Text("Particle system is active.");
 
+        auto& particles = m_ec.GetComponent<ParticleSystemComponent>(m_selectedEntity);
+        if (m_device.HasAsyncComputeQueue())
+            ImGui::Checkbox("Async compute", &particles.asyncCompute);
+        else
+            ImGui::TextDisabled("Async compute: no compute queue");
+
         if (ImGui::Button("Remove Particle System"))
         {
-            vkDeviceWaitIdle(m_device.GetDevice());
             m_ec.RemoveComponent<ParticleSystemComponent>(m_selectedEntity);
         }
 
@@ -297,9 +350,14 @@ void ImGuiInterface::ShowInspector()
         {
             if (ImGui::Button("Add Model Component"))
             {
-                if (m_editSelectedModel >= 0 && m_editSelectedModel < m_availableModels.size())
+                if (m_editSelectedModel >= 0 && m_editSelectedModel < m_availableModels.size() && GltfImporter::IsGltfFile(m_availableModels[m_editSelectedModel]))
+                {
+                    // A glTF file holds a whole scene, it becomes new objects instead of a component of this one.
+                    ImportScene("models/" + m_availableModels[m_editSelectedModel]);
+                    m_showAddComponent = false;
+                }
+                else if (m_editSelectedModel >= 0 && m_editSelectedModel < m_availableModels.size())
                 {
-                    vkDeviceWaitIdle(m_device.GetDevice());
                     std::string modelPath = "models/" + m_availableModels[m_editSelectedModel];
                     std::string texturePath = "";
 
@@ -308,32 +366,36 @@ void ImGuiInterface::ShowInspector()
                         texturePath = "textures/viking_room.png";
                     }
 
-                    static std::unique_ptr<DescriptorSetLayout> textureSetLayout = DescriptorSetLayout::Builder(m_device)
-                        .AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-                        .Build();
-                    static std::unique_ptr<DescriptorPool> texturePool = DescriptorPool::Builder(m_device)
-                        .SetMaxSets(100)
-                        .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
-                        .Build();
-
-                    std::shared_ptr<Model> model;
-                    if (!texturePath.empty())
-                    {
-                        model = Model::CreateModelWithTexture(m_device, modelPath, texturePath, *textureSetLayout, *texturePool);
-                    }
-                    else
-                    {
-                        model = Model::CreateModelFromFile(m_device, modelPath);
-                    }
-
+                    // The placeholder shows until the loader has decoded and uploaded the model.
                     ModelComponent modelComp{};
-                    modelComp.model = model;
+                    modelComp.model = m_assetLoader->GetPlaceholderModel();
                     modelComp.color = glm::vec3(m_editColor[0], m_editColor[1], m_editColor[2]); // Set initial color
                     if (!texturePath.empty())
                     {
-                        modelComp.textureDescriptorSet = model->GetTextureDescriptorSet();
+                        modelComp.textureDescriptorSet = m_assetLoader->GetPlaceholderTextureDescriptorSet();
                     }
                     m_ec.AddComponent(m_selectedEntity, modelComp);
+
+                    Entity entity = m_selectedEntity;
+                    m_assetLoader->LoadModelAsync(modelPath, texturePath, [this, entity](std::shared_ptr<Model> _model)
+                        {
+                            // The component may have been removed or replaced while loading.
+                            if (!m_ec.HasComponent<ModelComponent>(entity))
+                                return;
+
+                            auto& component = m_ec.GetComponent<ModelComponent>(entity);
+                            if (!m_assetLoader->IsPlaceholder(component.model))
+                                return;
+
+                            if (!_model)
+                            {
+                                m_ec.RemoveComponent<ModelComponent>(entity);
+                                return;
+                            }
+
+                            component.model = _model;
+                            component.textureDescriptorSet = _model->GetTextureDescriptorSet();
+                        });
                     m_showAddComponent = false;
                 }
             }
@@ -397,7 +459,6 @@ void ImGuiInterface::ShowInspector()
     {
         if (m_selectedEntity != m_viewerEntity)
         {
-            vkDeviceWaitIdle(m_device.GetDevice());
             m_ec.DestroyEntity(m_selectedEntity);
             m_showInspector = false;
             m_selectedEntity = UINT32_MAX;
@@ -422,10 +483,36 @@ void ImGuiInterface::ShowInspector()
     ImGui::End();
 }
 
-void ImGuiInterface::CreateNewEntity()
+void ImGuiInterface::ImportScene(const std::string& _filePath)
 {
-    vkDeviceWaitIdle(m_device.GetDevice());
+    std::vector<AssetLoader::SceneInstance> instances{};
+    try
+    {
+        instances = m_assetLoader->LoadScene(_filePath);
+    }
+    catch (const std::exception& _exception)
+    {
+        std::cout << "Failed to import " << _filePath << ": " << _exception.what() << std::endl;
+        return;
+    }
 
+    // Entities have no parent, node transforms are flattened under the selected object.
+    glm::mat4 root = m_ec.GetComponent<TransformComponent>(m_selectedEntity).Mat4();
+    for (const AssetLoader::SceneInstance& instance : instances)
+    {
+        Entity entity = m_ec.CreateEntity();
+        m_ec.AddComponent(entity, TransformComponent::FromMatrix(root * instance.transform));
+
+        ModelComponent modelComp{};
+        modelComp.model = instance.model;
+        modelComp.textureDescriptorSet = instance.model->GetTextureDescriptorSet();
+        modelComp.color = instance.color;
+        m_ec.AddComponent(entity, modelComp);
+    }
+}
+
+void ImGuiInterface::CreateNewEntity()
+{
     Entity newEntity = m_ec.CreateEntity();
 
     TransformComponent transform{};
@@ -461,7 +548,7 @@ void ImGuiInterface::ScanAvailableModels()
     {
         for (const auto& entry : std::filesystem::directory_iterator("models/"))
         {
-            if (entry.is_regular_file() && entry.path().extension() == ".obj")
+            if (entry.is_regular_file() && (entry.path().extension() == ".obj" || GltfImporter::IsGltfFile(entry.path().string())))
             {
                 m_availableModels.push_back(entry.path().filename().string());
             }
@@ -2,6 +2,8 @@
 #include "core/Device.h"
 #include "core/Renderer.h"
 #include "systems/EntityComponentSystem.h"
+#include "systems/RenderSystem.h"
+#include "model/AssetLoader.h"
 #include "window/Window.h"
 #include <vector>
 #include <string>
@@ -34,11 +36,23 @@ public:
         m_particleEntity = entity;
     }
 
+    void SetRenderStats(const RenderStats* _stats)
+    {
+        m_renderStats = _stats;
+    }
+
+    void SetAssetLoader(AssetLoader* _assetLoader)
+    {
+        m_assetLoader = _assetLoader;
+    }
+
 private:
     void ShowDebugWindow();
     void ShowSceneHierarchy();
     void ShowInspector();
     void CreateNewEntity();
+    // One new object per instance of the glTF scene, placed relative to the selected object.
+    void ImportScene(const std::string& _filePath);
     void ScanAvailableModels();
 
     Device& m_device;
@@ -48,6 +62,8 @@ private:
     Entity m_viewerEntity = UINT32_MAX;
     Entity m_particleEntity = UINT32_MAX;
     Entity m_selectedEntity = UINT32_MAX;
+    const RenderStats* m_renderStats = nullptr;
+    AssetLoader* m_assetLoader = nullptr;
 
     bool m_showInspector = false;
 